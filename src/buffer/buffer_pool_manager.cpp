@@ -1,3 +1,5 @@
+//===----------------------------------------------------------------------===//
+//
 //                         BusTub
 //
 // buffer_pool_manager.cpp
@@ -11,312 +13,348 @@
 #include "buffer/buffer_pool_manager.h"
 
 #include <algorithm>
-#include <cstddef>
-#include <cstdint>
-#include <list>
-#include <unordered_map>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include "common/config.h"
 #include "common/exception.h"
 #include "common/logger.h"
-#include "storage/page/b_plus_tree_page.h"
 #include "storage/page/page.h"
 
 namespace bustub {
-namespace {
-auto debug_msg = false;
-}
 
-BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
-  // We allocate a consecutive memory space for the buffer pool.
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
+BufferPoolManager::BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager,
+                                     ReplacerType replacer_type, size_t replacer_k)
+    : BufferPoolManager(1, pool_size, disk_manager, log_manager, replacer_type, replacer_k) {}
+
+BufferPoolManager::BufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
+                                     LogManager *log_manager, ReplacerType replacer_type, size_t replacer_k)
+    : BufferPoolManager(num_instances, std::array<size_t, NUM_PAGE_SIZE_CLASSES>{pool_size}, disk_manager, log_manager,
+                        replacer_type, replacer_k) {}
+
+BufferPoolManager::BufferPoolManager(size_t num_instances, const std::array<size_t, NUM_PAGE_SIZE_CLASSES> &pool_sizes,
+                                     DiskManager *disk_manager, LogManager *log_manager, ReplacerType replacer_type,
+                                     size_t replacer_k)
+    : num_instances_(num_instances), disk_manager_(disk_manager), log_manager_(log_manager) {
+  if (num_instances == 0) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "buffer pool needs at least one instance");
+  }
 
-  // Initially, every page is in the free list.
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(static_cast<int>(i));
+  // We allocate a consecutive memory space for the frames of each size class; each instance owns one slice of it.
+  for (size_t c = 0; c < NUM_PAGE_SIZE_CLASSES; ++c) {
+    pool_sizes_[c] = num_instances * pool_sizes[c];
+    first_instance_[c] = instances_.size();
+    if (pool_sizes[c] == 0) {
+      continue;
+    }
+    frames_[c] = new FrameArray(pool_sizes_[c], num_instances, frame_page_size, frame_numa_policy,
+                                PageSizeOfClass(static_cast<PageSizeClass>(c)));
+    Page *pages = frames_[c]->GetPages();
+    for (size_t i = 0; i < num_instances; ++i) {
+      instances_.emplace_back(std::make_unique<BufferPoolManagerInstance>(
+          pages + i * pool_sizes[c], pool_sizes[c], disk_manager, log_manager, replacer_type, replacer_k));
+    }
   }
 }
 
 BufferPoolManager::~BufferPoolManager() {
-  delete[] pages_;
-  delete replacer_;
+  StopStatsLogger();
+  StopFlushThread();
+  StopPrefetchThread();
+  for (FrameArray *frames : frames_) {
+    if (frames_registered_ && frames != nullptr) {
+      disk_manager_->UnregisterBuffers(frames->GetData());
+    }
+  }
+  instances_.clear();
+  for (FrameArray *frames : frames_) {
+    delete frames;
+  }
 }
 
 Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
-  // 1.     Search the page table for the requested page (P).
-  // 1.1    If P exists, pin it and return it immediately.
-  // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
-  //        Note that pages are always found from the free list first.
-  // 2.     If R is dirty, write it back to the disk.
-  // 3.     Delete R from the page table and insert P.
-  // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-
-  std::scoped_lock<std::mutex> lock(latch_);
-
-  // 1.1
-  if (page_table_.find(page_id) != page_table_.end()) {
-    frame_id_t frame_id = page_table_[page_id];
+  BufferPoolManagerInstance *instance = GetInstance(page_id);
+  return instance == nullptr ? nullptr : instance->FetchPage(page_id);
+}
 
-    // if (pages_[frame_id].GetPageId() != page_id) {
-    //   LOG_ERROR("FetchPageImpl fatal - %d - %d - %d - page_table_ is not up-to-date", pages_[frame_id].GetPageId(),
-    //             page_id, pages_[frame_id].GetPinCount());
-    // }
-    replacer_->Pin(frame_id);
-    pages_[frame_id].pin_count_ += 1;
+bool BufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
+  BufferPoolManagerInstance *instance = GetInstance(page_id);
+  return instance != nullptr && instance->UnpinPage(page_id, is_dirty);
+}
 
-    return &pages_[frame_id];
-  }
+bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
+  BufferPoolManagerInstance *instance = GetInstance(page_id);
+  return instance != nullptr && instance->FlushPage(page_id);
+}
 
-  // if all pinned, cannot find replacement
-  if (is_all_pin()) {
-    // LOG_INFO("all pin");
-    // LOG_INFO("all pin %ld - %ld", pool_size_, page_table_.size());
+Page *BufferPoolManager::NewPageImpl(page_id_t *page_id, PageSizeClass size_class) {
+  if (GetPoolSize(size_class) == 0) {
     return nullptr;
   }
-
-  // 1.2
-  auto frame_id = Find_replacementL();
-
-  // 2.
-  if (pages_[frame_id].IsDirty()) {
-    disk_manager_->WritePage(pages_[frame_id].GetPageId(), pages_[frame_id].GetData());
-  }
-
-  // 3.
-  auto old_page_id = pages_[frame_id].GetPageId();
-  if (page_table_.find(old_page_id) != page_table_.end()) {
-    page_table_.erase(old_page_id);
+  // The page id decides the instance, so if that instance has every frame pinned, try a fresh id until every instance
+  // of the size class has been given a chance. Ids that were turned down are held back until the end: the free space
+  // map would hand the same id out again, which would land on the same full instance.
+  std::vector<page_id_t> rejected;
+  std::vector<bool> tried(num_instances_, false);
+  size_t num_tried = 0;
+  Page *page = nullptr;
+  while (page == nullptr && num_tried < num_instances_) {
+    page_id_t new_page_id = disk_manager_->AllocatePage(size_class);
+    size_t instance = static_cast<size_t>(GetPageSlot(new_page_id) / SlotsOfClass(size_class)) % num_instances_;
+    if (!tried[instance]) {
+      tried[instance] = true;
+      ++num_tried;
+      page = GetInstance(new_page_id)->NewPage(new_page_id);
+    }
+    if (page != nullptr) {
+      *page_id = new_page_id;
+    } else {
+      rejected.push_back(new_page_id);
+    }
   }
-  page_table_[page_id] = frame_id;
-
-  // 4.
-  pages_[frame_id].ResetMemory();
-  pages_[frame_id].page_id_ = page_id;
-  pages_[frame_id].is_dirty_ = false;
-  pages_[frame_id].pin_count_ = 1;
-  replacer_->Pin(frame_id);
-  disk_manager_->ReadPage(page_id, pages_[frame_id].GetData());
-
-  if (debug_msg) {
-    LOG_INFO("FetchPageImpl - not found - page_id: %d", page_id);
+  for (page_id_t rejected_page_id : rejected) {
+    disk_manager_->DeallocatePage(rejected_page_id);
   }
-
-  return &pages_[frame_id];
+  return page;
 }
 
-bool BufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
-  std::scoped_lock<std::mutex> lock(latch_);
+bool BufferPoolManager::DeletePageImpl(page_id_t page_id) {
+  BufferPoolManagerInstance *instance = GetInstance(page_id);
+  return instance == nullptr || instance->DeletePage(page_id);
+}
 
-  // does not exist
-  if (page_table_.find(page_id) == page_table_.end()) {
-    LOG_ERROR("unpin page_id: %d", page_id);
-    return true;
+void BufferPoolManager::FlushAllPagesImpl() {
+  // adjacent page ids live in different instances, so the pages of all instances are written together; that way they
+  // coalesce into long sequential writes and the file is synced once
+  std::vector<std::pair<page_id_t, const char *>> pages;
+  std::vector<std::unordered_set<page_id_t>> pending(instances_.size());
+  std::vector<std::unique_lock<std::mutex>> locks;
+  locks.reserve(instances_.size());
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    locks.push_back(instances_[i]->BeginFlushAll(&pages, &pending[i]));
   }
-  if (pages_[page_table_[page_id]].GetPinCount() <= 0) {
-    LOG_INFO("over-unpin page_id: %d - pid: %d - pin count %d  ", page_id, pages_[page_table_[page_id]].GetPageId(),
-             pages_[page_table_[page_id]].pin_count_);
-    return false;
+  StatsTimer write_timer;
+  disk_manager_->WritePages(&pages);
+  if (!pages.empty()) {
+    stats_.RecordWrite(write_timer.ElapsedNs());
+    stats_.RecordFlushes(pages.size());
   }
-
-  // if (pages_[page_table_[page_id]].GetPageId() != page_id) {
-  //  LOG_ERROR("unpin %d -  %d", page_id, pages_[page_table_[page_id]].GetPageId());
-  //  return false;
-  //}
-
-  pages_[page_table_[page_id]].is_dirty_ |= is_dirty;
-  pages_[page_table_[page_id]].pin_count_ -= 1;
-
-  if (pages_[page_table_[page_id]].GetPinCount() == 0) {
-    replacer_->Unpin(page_table_[page_id]);
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    instances_[i]->EndFlushAll(&locks[i], pending[i]);
   }
-
-  return true;
 }
 
-bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
-  // Make sure you call DiskManager::WritePage!
-  std::scoped_lock<std::mutex> lock(latch_);
-
-  if (page_id == INVALID_PAGE_ID) {
-    // LOG_ERROR("flush page INVALID_PAGE_ID");
-    return false;
-  }
-  if (page_id != pages_[page_table_[page_id]].GetPageId()) {
-    // LOG_ERROR("flush page not equal; maybe race");
-    return false;
-  }
-  if (page_table_.find(page_id) == page_table_.end()) {
-    return false;
+void BufferPoolManager::RunFlushThread() {
+  std::scoped_lock<std::mutex> lock(flush_latch_);
+  if (flush_thread_ != nullptr) {
+    return;
   }
+  enable_flushing_ = true;
+  flush_thread_ = new std::thread([this] {
+    while (enable_flushing_) {
+      auto start = std::chrono::steady_clock::now();
+      uint64_t written = 0;
+      for (auto &instance : instances_) {
+        // keep the quarter of each instance that is closest to eviction clean
+        written += instance->FlushEvictionCandidates(std::max<size_t>(1, instance->GetPoolSize() / 4));
+      }
+      if (written > 0) {
+        background_writes_ += written;
+        background_write_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count();
+      }
+
+      std::unique_lock<std::mutex> wait_lock(flush_latch_);
+      cv_.wait_for(wait_lock, page_flush_interval, [this] { return !enable_flushing_; });
+    }
+  });
+}
 
-  if (debug_msg) {
-    LOG_INFO("flush page_id: %d, pin count: %d", page_id, pages_[page_table_[page_id]].GetPinCount());
+void BufferPoolManager::StopFlushThread() {
+  std::thread *flush_thread;
+  {
+    std::scoped_lock<std::mutex> lock(flush_latch_);
+    if (flush_thread_ == nullptr) {
+      return;
+    }
+    enable_flushing_ = false;
+    flush_thread = flush_thread_;
+    flush_thread_ = nullptr;
   }
-  disk_manager_->WritePage(page_id, pages_[page_table_[page_id]].GetData());
-
-  // after flush, dirty = false
-  pages_[page_table_[page_id]].is_dirty_ = false;
-  return true;
+  cv_.notify_all();
+  flush_thread->join();
+  delete flush_thread;
 }
 
-Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
-  // 0.   Make sure you call DiskManager::AllocatePage!
-  // 1.   If all the pages in the buffer pool are pinned, return nullptr.
-  // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
-  // 3.   Update P's metadata, zero out memory and add P to the page table.
-  // 4.   Set the page ID output parameter. Return a pointer to P.
-
-  std::scoped_lock<std::mutex> lock(latch_);
-
-  // 0.
-  page_id_t new_page_id = disk_manager_->AllocatePage();
-
-  // 1.
-  if (is_all_pin()) {
-    // LOG_INFO("all pin");
-    // LOG_INFO("all pin %ld - %ld", pool_size_, page_table_.size());
-    return nullptr;
+void BufferPoolManager::RegisterFrames() {
+  if (!frames_registered_) {
+    for (FrameArray *frames : frames_) {
+      if (frames != nullptr) {
+        disk_manager_->RegisterBuffers(frames->GetData(), frames->GetFrameSize() * frames->GetNumFrames());
+      }
+    }
+    frames_registered_ = true;
   }
+}
 
-  // 2. (now must have unpinned pages)
-  if (debug_msg) {
-    LOG_INFO("NewPageImpl - new page_id: %d", new_page_id);
+void BufferPoolManager::PrefetchPages(page_id_t first, size_t n) {
+  if (n == 0 || GetInstance(first) == nullptr) {
+    return;
   }
-  frame_id_t new_frame_id = Find_replacementL();
-
-  // delete from page table
-  page_id_t old_pid = pages_[new_frame_id].GetPageId();
-  if (page_table_.find(old_pid) != page_table_.end()) {
-    page_table_.erase(old_pid);
+  PageSizeClass size_class = GetPageSizeClass(first);
+  auto num_slots = static_cast<page_id_t>(disk_manager_->GetNumDiskPages());
+
+  std::scoped_lock<std::mutex> lock(prefetch_latch_);
+  page_id_t page_id = first;
+  for (size_t i = 0; i < n && GetPageSlot(page_id) + SlotsOfClass(size_class) <= num_slots &&
+                     prefetch_queue_.size() < GetPoolSize(size_class);
+       ++i, page_id = NextPageId(page_id)) {
+    if (!GetInstance(page_id)->IsResident(page_id)) {
+      prefetch_queue_.push_back(page_id);
+    }
   }
-
-  // flush if dirty
-  if (pages_[new_frame_id].IsDirty()) {
-    disk_manager_->WritePage(old_pid, pages_[new_frame_id].GetData());
+  if (prefetch_queue_.empty()) {
+    return;
   }
-
-  // 3.
-  pages_[new_frame_id].ResetMemory();
-  pages_[new_frame_id].is_dirty_ = false;
-  pages_[new_frame_id].page_id_ = new_page_id;
-  pages_[new_frame_id].pin_count_ = 1;
-  replacer_->Pin(new_frame_id);
-
-  // register in page table
-  page_table_[new_page_id] = new_frame_id;
-
-  // 4.
-  *page_id = new_page_id;
-
-  return &pages_[new_frame_id];
-}
-
-bool BufferPoolManager::DeletePageImpl(page_id_t page_id) {
-  // 0.   Make sure you call DiskManager::DeallocatePage!
-  // 1.   Search the page table for the requested page (P).
-  // 1.   If P does not exist, return true.
-  // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
-  // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-
-  std::scoped_lock<std::mutex> lock(latch_);
-
-  // 0.
-  disk_manager_->DeallocatePage(page_id);
-
-  // 1.
-  if (page_table_.find(page_id) == page_table_.end()) {
-    // LOG_INFO("bpm - not find - %d", page_id);
-    return true;
+  if (prefetch_thread_ == nullptr) {
+    enable_prefetching_ = true;
+    prefetch_thread_ = new std::thread([this] {
+      std::unique_lock<std::mutex> wait_lock(prefetch_latch_);
+      while (true) {
+        prefetch_cv_.wait(wait_lock, [this] { return !enable_prefetching_ || !prefetch_queue_.empty(); });
+        if (!enable_prefetching_) {
+          return;
+        }
+        std::deque<page_id_t> page_ids;
+        page_ids.swap(prefetch_queue_);
+        wait_lock.unlock();
+
+        std::vector<DiskRequest> requests;
+        for (page_id_t page_id : page_ids) {
+          BufferPoolManagerInstance *instance = GetInstance(page_id);
+          page_id_t old_page_id;
+          Page *page = instance->BeginPrefetch(page_id, &old_page_id);
+          if (page == nullptr) {
+            continue;
+          }
+          requests.emplace_back(false, page_id, page->GetData(), [this, instance, page, old_page_id](bool ok) {
+            instance->EndPrefetch(page, old_page_id);
+            if (ok) {
+              prefetches_++;
+            }
+            // the last completion may let StopPrefetchThread and the destructor proceed, so it notifies under the latch
+            std::scoped_lock<std::mutex> lock(prefetch_latch_);
+            prefetches_in_flight_--;
+            prefetch_cv_.notify_all();
+          });
+        }
+
+        wait_lock.lock();
+        prefetches_in_flight_ += requests.size();
+        wait_lock.unlock();
+        disk_manager_->SubmitRequests(std::move(requests));
+        wait_lock.lock();
+      }
+    });
   }
+  prefetch_cv_.notify_one();
+}
 
-  // 2.
-  if (pages_[page_table_[page_id]].GetPinCount() > 0) {
-    // LOG_DEBUG("try to del page id: %d - but pin_count: %d", page_id, pages_[page_table_[page_id]].pin_count_);
-    return false;
+void BufferPoolManager::StopPrefetchThread() {
+  std::thread *prefetch_thread;
+  {
+    std::scoped_lock<std::mutex> lock(prefetch_latch_);
+    if (prefetch_thread_ == nullptr) {
+      return;
+    }
+    enable_prefetching_ = false;
+    prefetch_queue_.clear();
+    prefetch_thread = prefetch_thread_;
+    prefetch_thread_ = nullptr;
   }
+  prefetch_cv_.notify_all();
+  prefetch_thread->join();
+  delete prefetch_thread;
 
-  // 3.
-  frame_id_t free_frame_id = page_table_[page_id];
-  page_id_t pid = page_id;
-  page_table_.erase(pid);
+  // reads the thread submitted asynchronously still publish their frames when they complete
+  std::unique_lock<std::mutex> lock(prefetch_latch_);
+  prefetch_cv_.wait(lock, [this] { return prefetches_in_flight_ == 0; });
+}
 
-  // reset meta data, flush if dirty
-  if (pages_[free_frame_id].IsDirty()) {
-    disk_manager_->WritePage(page_id, pages_[free_frame_id].GetData());
+double BufferPoolManager::GetDirtyRatio() {
+  size_t dirty = 0;
+  for (auto &instance : instances_) {
+    dirty += instance->GetNumDirtyFrames();
   }
-
-  if (debug_msg) {
-    LOG_INFO("DeletePageImpl - page_id: %d", page_id);
+  size_t frames = 0;
+  for (size_t pool_size : pool_sizes_) {
+    frames += pool_size;
   }
-  Reset_meta_dataL(free_frame_id);
-
-  // LOG_INFO("bpm - after update %d - %d - %d", page_id, pages_[free_frame_id].GetPageId(),
-  //         pages_[free_frame_id].GetPinCount());
-
-  // return to free list
-  free_list_.push_back(free_frame_id);
-
-  return true;
+  return static_cast<double>(dirty) / frames;
 }
 
-void BufferPoolManager::FlushAllPagesImpl() {
-  // You can do it!
-  // LOG_DEBUG("FlushAllPagesImpl");
-
-  std::scoped_lock<std::mutex> lock(latch_);
-  for (size_t i = 0; i < pool_size_; i++) {
-    if (pages_[i].GetPageId() == INVALID_PAGE_ID) {
-      continue;
-    }
-    disk_manager_->WritePage(pages_[i].GetPageId(), pages_[i].GetData());
-    pages_[i].is_dirty_ = false;
-  }
+double BufferPoolManager::GetBackgroundWriteThroughput() const {
+  uint64_t ns = background_write_ns_;
+  return ns == 0 ? 0.0 : background_writes_ * 1e9 / ns;
 }
 
-bool BufferPoolManager::is_all_pin() {
-  if (!free_list_.empty()) {
-    return false;
-  }
-
-  bool all_pin = true;
-  for (size_t i = 0; i < pool_size_; i++) {
-    if (pages_[i].GetPinCount() < 1) {
-      all_pin = false;
-      break;
-    }
+uint64_t BufferPoolManager::GetNumForegroundWrites() const {
+  uint64_t writes = 0;
+  for (const auto &instance : instances_) {
+    writes += instance->GetNumForegroundWrites();
   }
-  return all_pin;
+  return writes;
 }
 
-void BufferPoolManager::Reset_meta_dataL(frame_id_t frame_id) {
-  pages_[frame_id].ResetMemory();
-  pages_[frame_id].is_dirty_ = false;
-  pages_[frame_id].pin_count_ = 0;
-  pages_[frame_id].page_id_ = INVALID_PAGE_ID;
+BufferPoolStatsSnapshot BufferPoolManager::GetStats() const {
+  BufferPoolStatsSnapshot stats = stats_.Snapshot();
+  for (const auto &instance : instances_) {
+    stats.Merge(instance->GetStats());
+  }
+  stats.background_flushes_ = background_writes_;
+  stats.prefetches_ = prefetches_;
+  return stats;
 }
 
-frame_id_t BufferPoolManager::Find_replacementL() {
-  frame_id_t fid;
-
-  // always find in free list first
-  if (!free_list_.empty()) {
-    fid = free_list_.front();
-    free_list_.pop_front();
-  } else {
-    // then find in lru
-    auto ok = replacer_->Victim(&fid);
-    if (!ok) {
-      LOG_ERROR("find replacement replacer not ok");  // XXX
-      throw Exception(ExceptionType::INVALID, "fatal - find replacement");
+void BufferPoolManager::RunStatsLogger() {
+  std::scoped_lock<std::mutex> lock(stats_latch_);
+  if (stats_thread_ != nullptr) {
+    return;
+  }
+  enable_stats_logging_ = true;
+  stats_thread_ = new std::thread([this] {
+    BufferPoolStatsSnapshot last = GetStats();
+    std::unique_lock<std::mutex> wait_lock(stats_latch_);
+    while (!stats_cv_.wait_for(wait_lock, bpm_stats_log_interval, [this] { return !enable_stats_logging_; })) {
+      BufferPoolStatsSnapshot now = GetStats();
+      BufferPoolStatsSnapshot delta = now.Since(last);
+      // an idle pool is not worth a log line
+      if (delta.fetch_hits_ + delta.fetch_misses_ + delta.new_pages_ + delta.flushes_ + delta.background_flushes_ > 0) {
+        LOG_INFO("buffer pool: %s", delta.ToString().c_str());
+      }
+      last = now;
     }
+  });
+}
 
-    if (debug_msg) {
-      LOG_INFO("Victim - page_id: %d", pages_[fid].GetPageId());
+void BufferPoolManager::StopStatsLogger() {
+  std::thread *stats_thread;
+  {
+    std::scoped_lock<std::mutex> lock(stats_latch_);
+    if (stats_thread_ == nullptr) {
+      return;
     }
+    enable_stats_logging_ = false;
+    stats_thread = stats_thread_;
+    stats_thread_ = nullptr;
   }
-  return fid;
+  stats_cv_.notify_all();
+  stats_thread->join();
+  delete stats_thread;
 }
 
 }  // namespace bustub
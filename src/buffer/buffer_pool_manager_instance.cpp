@@ -0,0 +1,524 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_instance.cpp
+//
+// Identification: src/buffer/buffer_pool_manager_instance.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_manager_instance.h"
+
+#include <list>
+#include <unordered_set>
+#include <vector>
+
+#include "common/config.h"
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+namespace {
+auto debug_msg = false;
+}
+
+BufferPoolManagerInstance::BufferPoolManagerInstance(Page *pages, size_t pool_size, DiskManager *disk_manager,
+                                                     LogManager *log_manager, ReplacerType replacer_type,
+                                                     size_t replacer_k)
+    : pool_size_(pool_size),
+      pages_(pages),
+      disk_manager_(disk_manager),
+      log_manager_(log_manager),
+      page_table_(pool_size) {
+  switch (replacer_type) {
+    case ReplacerType::CLOCK:
+      replacer_ = new ClockReplacer(pool_size);
+      break;
+    case ReplacerType::LRU_K:
+      replacer_ = new LRUKReplacer(pool_size, replacer_k);
+      break;
+    default:
+      replacer_ = new LRUReplacer(pool_size);
+      break;
+  }
+
+  io_in_progress_.resize(pool_size_, false);
+
+  // Initially, every page is in the free list.
+  for (size_t i = 0; i < pool_size_; ++i) {
+    pages_[i].pin_count_ = -1;
+    free_list_.emplace_back(static_cast<int>(i));
+  }
+}
+
+BufferPoolManagerInstance::~BufferPoolManagerInstance() { delete replacer_; }
+
+Page *BufferPoolManagerInstance::FetchPage(page_id_t page_id) {
+  // 1.     Search the page table for the requested page (P).
+  // 1.1    If P exists, pin it and return it immediately.
+  // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
+  //        Note that pages are always found from the free list first.
+  // 2.     Delete R from the page table and insert P, marking the frame as "I/O in progress".
+  // 3.     Without the latch: if R is dirty, write it back to the disk, then read in the content of P.
+  // 4.     Clear "I/O in progress", wake up waiters and return a pointer to P.
+
+  // 1.1    hit: no latch
+  frame_id_t frame_id;
+  if (page_table_.Find(page_id, &frame_id) && TryPin(frame_id, page_id)) {
+    stats_.RecordHit();
+    return &pages_[frame_id];
+  }
+
+  auto lock = LockLatch();
+
+  // 1.1    the unlatched lookup may have raced with a reassignment; the table is exact under the latch
+  while (true) {
+    if (page_table_.Find(page_id, &frame_id)) {
+      if (!io_in_progress_[frame_id]) {
+        PinL(frame_id);
+        stats_.RecordHit();
+        return &pages_[frame_id];
+      }
+      // another thread is reading P in; wait for it instead of reading P twice
+      io_cv_.wait(lock);
+      continue;
+    }
+    if (evicting_.count(page_id) == 0) {
+      break;
+    }
+    // P is being evicted; its write-back has to land before P can be read back
+    io_cv_.wait(lock);
+  }
+
+  // 1.2
+  if (!Find_replacementL(&frame_id)) {
+    return nullptr;
+  }
+
+  // 2.
+  page_id_t old_page_id = BeginIOL(frame_id, page_id);
+  lock.unlock();
+
+  // 3.
+  Page &page = pages_[frame_id];
+  page.WLatch();
+  WriteBackVictim(old_page_id, &page);
+  page.ResetMemory();
+  StatsTimer read_timer;
+  disk_manager_->ReadPage(page_id, page.GetData());
+  stats_.RecordRead(read_timer.ElapsedNs());
+  stats_.RecordMiss();
+  page.WUnlatch();
+
+  if (debug_msg) {
+    LOG_INFO("FetchPage - not found - page_id: %d", page_id);
+  }
+
+  // 4.
+  RelockLatch(&lock);
+  EndIOL(frame_id, old_page_id);
+  return &page;
+}
+
+bool BufferPoolManagerInstance::UnpinPage(page_id_t page_id, bool is_dirty) {
+  // the caller holds a pin, so the frame cannot be reassigned under us; a miss is either a bogus page id or a
+  // lookup that raced with a backward shift in the page table, which the latched retry tells apart
+  frame_id_t frame_id;
+  if (!page_table_.Find(page_id, &frame_id)) {
+    auto lock = LockLatch();
+    if (!page_table_.Find(page_id, &frame_id)) {
+      LOG_ERROR("unpin page_id: %d", page_id);
+      return true;
+    }
+  }
+
+  Page &page = pages_[frame_id];
+  if (is_dirty) {
+    page.is_dirty_ = true;
+  }
+  if (!UnpinFrame(frame_id)) {
+    LOG_INFO("over-unpin page_id: %d - pid: %d - pin count %d  ", page_id, page.GetPageId(), page.GetPinCount());
+    return false;
+  }
+
+  return true;
+}
+
+bool BufferPoolManagerInstance::FlushPage(page_id_t page_id) {
+  // Make sure you call DiskManager::WritePage!
+  auto lock = LockLatch();
+
+  if (page_id == INVALID_PAGE_ID) {
+    return false;
+  }
+  frame_id_t frame_id;
+  while (true) {
+    if (!page_table_.Find(page_id, &frame_id)) {
+      return false;
+    }
+    if (!io_in_progress_[frame_id]) {
+      break;
+    }
+    // the frame does not hold the page's content until its read completes
+    io_cv_.wait(lock);
+  }
+
+  if (debug_msg) {
+    LOG_INFO("flush page_id: %d, pin count: %d", page_id, pages_[frame_id].GetPinCount());
+  }
+  // clear the flag first, so that a concurrent UnpinPage(dirty) is not lost
+  pages_[frame_id].is_dirty_ = false;
+  StatsTimer write_timer;
+  disk_manager_->WritePage(page_id, pages_[frame_id].GetData());
+  stats_.RecordWrite(write_timer.ElapsedNs());
+  stats_.RecordFlushes(1);
+  return true;
+}
+
+Page *BufferPoolManagerInstance::NewPage(page_id_t page_id) {
+  // 1.   If all the pages in the buffer pool are pinned, return nullptr.
+  // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
+  // 3.   Add the new page to the page table, then write back P (if dirty) and zero out memory without the latch.
+  // 4.   Return a pointer to the new page.
+
+  auto lock = LockLatch();
+
+  stats_.RecordNewPage();
+
+  // a prefetch may have read the page id in between its allocation and now; take its frame over
+  frame_id_t new_frame_id;
+  while (page_table_.Find(page_id, &new_frame_id)) {
+    int unpinned = 0;
+    if (!io_in_progress_[new_frame_id] && pages_[new_frame_id].pin_count_.compare_exchange_strong(unpinned, -1)) {
+      replacer_->Pin(new_frame_id);
+      Page &page = pages_[new_frame_id];
+      page.WLatch();
+      page.ResetMemory();
+      page.is_dirty_ = false;
+      page.WUnlatch();
+      page.pin_count_.store(1, std::memory_order_release);
+      return &page;
+    }
+    io_cv_.wait(lock);
+  }
+
+  // 1. & 2.
+  if (!Find_replacementL(&new_frame_id)) {
+    return nullptr;
+  }
+  if (debug_msg) {
+    LOG_INFO("NewPage - new page_id: %d", page_id);
+  }
+
+  // 3.
+  page_id_t old_pid = BeginIOL(new_frame_id, page_id);
+  lock.unlock();
+
+  Page &page = pages_[new_frame_id];
+  page.WLatch();
+  WriteBackVictim(old_pid, &page);
+  page.ResetMemory();
+  page.WUnlatch();
+
+  // 4.
+  RelockLatch(&lock);
+  EndIOL(new_frame_id, old_pid);
+  return &page;
+}
+
+Page *BufferPoolManagerInstance::BeginPrefetch(page_id_t page_id, page_id_t *old_page_id) {
+  auto lock = LockLatch();
+
+  frame_id_t frame_id;
+  if (page_table_.Find(page_id, &frame_id) || evicting_.count(page_id) != 0) {
+    return nullptr;
+  }
+  if (!Find_replacementL(&frame_id)) {
+    return nullptr;
+  }
+  *old_page_id = BeginIOL(frame_id, page_id);
+  lock.unlock();
+
+  // nobody else touches the frame until EndPrefetch: pins fail on its pin count of -1 and fetches wait for the I/O
+  Page &page = pages_[frame_id];
+  page.WLatch();
+  WriteBackVictim(*old_page_id, &page);
+  page.ResetMemory();
+  page.WUnlatch();
+  return &page;
+}
+
+void BufferPoolManagerInstance::EndPrefetch(Page *page, page_id_t old_page_id) {
+  auto lock = LockLatch();
+  EndIOL(static_cast<frame_id_t>(page - pages_), old_page_id, false);
+}
+
+bool BufferPoolManagerInstance::DeletePage(page_id_t page_id) {
+  // 0.   Make sure you call DiskManager::DeallocatePage!
+  // 1.   Search the page table for the requested page (P).
+  // 1.   If P does not exist, return true.
+  // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
+  // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
+  // The page is deallocated only once it is certain to be deleted, since the disk manager hands it out again.
+
+  auto lock = LockLatch();
+
+  // a write-back of P as a victim must land before P is reused, or it would overwrite the new contents
+  io_cv_.wait(lock, [this, page_id] { return evicting_.count(page_id) == 0; });
+
+  // 1.
+  frame_id_t free_frame_id;
+  if (!page_table_.Find(page_id, &free_frame_id)) {
+    // 0.
+    disk_manager_->DeallocatePage(page_id);
+    return true;
+  }
+
+  // 2.   claiming the frame also fences off lock-free pins racing with us
+  int unpinned = 0;
+  if (!pages_[free_frame_id].pin_count_.compare_exchange_strong(unpinned, -1)) {
+    return false;
+  }
+
+  // 3.
+  page_table_.Erase(page_id);
+  // 0.
+  disk_manager_->DeallocatePage(page_id);
+
+  // reset meta data; the contents of a deleted page need not reach the disk
+  pages_[free_frame_id].WLatch();
+
+  if (debug_msg) {
+    LOG_INFO("DeletePage - page_id: %d", page_id);
+  }
+  Reset_meta_dataL(free_frame_id);
+  pages_[free_frame_id].WUnlatch();
+
+  return true;
+}
+
+void BufferPoolManagerInstance::FlushAllPages() {
+  std::vector<std::pair<page_id_t, const char *>> pages;
+  std::unordered_set<page_id_t> pending;
+  std::unique_lock<std::mutex> lock = BeginFlushAll(&pages, &pending);
+  StatsTimer write_timer;
+  disk_manager_->WritePages(&pages);
+  if (!pages.empty()) {
+    stats_.RecordWrite(write_timer.ElapsedNs());
+    stats_.RecordFlushes(pages.size());
+  }
+  EndFlushAll(&lock, pending);
+}
+
+std::unique_lock<std::mutex> BufferPoolManagerInstance::BeginFlushAll(
+    std::vector<std::pair<page_id_t, const char *>> *pages, std::unordered_set<page_id_t> *pending) {
+  auto lock = LockLatch();
+  for (size_t i = 0; i < pool_size_; i++) {
+    page_id_t page_id = pages_[i].page_id_;
+    // frames with I/O in progress hold either nothing yet or a victim whose write-back is pending below
+    if (page_id == INVALID_PAGE_ID || io_in_progress_[i]) {
+      continue;
+    }
+    pages_[i].is_dirty_ = false;
+    pages->emplace_back(page_id, pages_[i].GetData());
+  }
+  pending->insert(evicting_.begin(), evicting_.end());
+  return lock;
+}
+
+void BufferPoolManagerInstance::EndFlushAll(std::unique_lock<std::mutex> *lock,
+                                            const std::unordered_set<page_id_t> &pending) {
+  // wait for the write-backs of victims that were in flight when the flush started
+  io_cv_.wait(*lock, [this, &pending] {
+    for (auto page_id : pending) {
+      if (evicting_.count(page_id) != 0) {
+        return false;
+      }
+    }
+    return true;
+  });
+  lock->unlock();
+}
+
+page_id_t BufferPoolManagerInstance::BeginIOL(frame_id_t frame_id, page_id_t page_id) {
+  Page &page = pages_[frame_id];
+  page_id_t old_page_id = page.page_id_;
+  if (old_page_id != INVALID_PAGE_ID) {
+    page_table_.Erase(old_page_id);
+    evicting_.insert(old_page_id);
+    stats_.RecordEviction();
+  }
+  page.page_id_ = page_id;
+  io_in_progress_[frame_id] = true;
+  page_table_.Insert(page_id, frame_id);
+  return old_page_id;
+}
+
+void BufferPoolManagerInstance::WriteBackVictim(page_id_t old_page_id, Page *page) {
+  // the write latch also waits out a background write-back of this frame that is still in flight
+  if (page->is_dirty_.exchange(false)) {
+    StatsTimer write_timer;
+    disk_manager_->WritePage(old_page_id, page->GetData());
+    stats_.RecordWrite(write_timer.ElapsedNs());
+    foreground_writes_++;
+  }
+}
+
+void BufferPoolManagerInstance::EndIOL(frame_id_t frame_id, page_id_t old_page_id, bool pin) {
+  if (old_page_id != INVALID_PAGE_ID) {
+    evicting_.erase(old_page_id);
+  }
+  io_in_progress_[frame_id] = false;
+  if (pin) {
+    pages_[frame_id].pin_count_.store(1, std::memory_order_release);
+  } else {
+    pages_[frame_id].pin_count_.store(0, std::memory_order_release);
+    replacer_->Unpin(frame_id);
+  }
+  io_cv_.notify_all();
+}
+
+size_t BufferPoolManagerInstance::FlushEvictionCandidates(size_t lookahead) {
+  std::vector<frame_id_t> candidates(lookahead);
+  size_t num_candidates = replacer_->Peek(candidates.data(), lookahead);
+
+  size_t written = 0;
+  for (size_t i = 0; i < num_candidates; i++) {
+    Page &page = pages_[candidates[i]];
+    if (!page.IsDirty()) {
+      continue;
+    }
+    // A frame claimed for another page (pin count -1) is write latched by its claimer until it is reassigned, so
+    // under the read latch a non-negative pin count means page_id_ and the data belong together. Clearing the flag
+    // before the write keeps an UnpinPage(dirty) that races with us from being lost.
+    page.RLatch();
+    page_id_t page_id = page.page_id_;
+    if (page.GetPinCount() >= 0 && page_id != INVALID_PAGE_ID && page.is_dirty_.exchange(false)) {
+      StatsTimer write_timer;
+      disk_manager_->WritePage(page_id, page.GetData());
+      stats_.RecordWrite(write_timer.ElapsedNs());
+      written++;
+    }
+    page.RUnlatch();
+  }
+  return written;
+}
+
+size_t BufferPoolManagerInstance::GetNumDirtyFrames() {
+  size_t dirty = 0;
+  for (size_t i = 0; i < pool_size_; i++) {
+    if (pages_[i].IsDirty()) {
+      dirty++;
+    }
+  }
+  return dirty;
+}
+
+BufferPoolStatsSnapshot BufferPoolManagerInstance::GetStats() const {
+  BufferPoolStatsSnapshot stats = stats_.Snapshot();
+  stats.dirty_evictions_ = foreground_writes_;
+  return stats;
+}
+
+std::unique_lock<std::mutex> BufferPoolManagerInstance::LockLatch() {
+  std::unique_lock<std::mutex> lock(latch_, std::defer_lock);
+  RelockLatch(&lock);
+  return lock;
+}
+
+void BufferPoolManagerInstance::RelockLatch(std::unique_lock<std::mutex> *lock) {
+  if constexpr (BPM_STATS_ENABLED) {
+    // an uncontended latch is taken without reading the clock
+    if (lock->try_lock()) {
+      stats_.RecordLatchWait(0);
+      return;
+    }
+    StatsTimer wait_timer;
+    lock->lock();
+    stats_.RecordLatchWait(wait_timer.ElapsedNs());
+  } else {
+    lock->lock();
+  }
+}
+
+bool BufferPoolManagerInstance::TryPin(frame_id_t frame_id, page_id_t page_id) {
+  Page &page = pages_[frame_id];
+  int pins = page.pin_count_.load(std::memory_order_acquire);
+  do {
+    if (pins < 0) {
+      return false;
+    }
+  } while (!page.pin_count_.compare_exchange_weak(pins, pins + 1, std::memory_order_acq_rel));
+
+  // the frame may have been reassigned between the page table lookup and the pin
+  if (page.page_id_.load(std::memory_order_acquire) != page_id) {
+    UnpinFrame(frame_id);
+    return false;
+  }
+  if (pins == 0) {
+    replacer_->Pin(frame_id);
+  }
+  return true;
+}
+
+void BufferPoolManagerInstance::PinL(frame_id_t frame_id) {
+  // under the latch nobody holds the frame at -1, so a plain increment is enough
+  if (pages_[frame_id].pin_count_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+    replacer_->Pin(frame_id);
+  }
+}
+
+bool BufferPoolManagerInstance::UnpinFrame(frame_id_t frame_id) {
+  Page &page = pages_[frame_id];
+  int pins = page.pin_count_.load(std::memory_order_acquire);
+  do {
+    if (pins <= 0) {
+      return false;
+    }
+  } while (!page.pin_count_.compare_exchange_weak(pins, pins - 1, std::memory_order_acq_rel));
+
+  // the replacer may briefly hold a pinned frame when this races with a 0 -> 1 pin; Find_replacementL skips those
+  if (pins == 1) {
+    replacer_->Unpin(frame_id);
+  }
+  return true;
+}
+
+void BufferPoolManagerInstance::Reset_meta_dataL(frame_id_t frame_id) {
+  pages_[frame_id].ResetMemory();
+  pages_[frame_id].is_dirty_ = false;
+  pages_[frame_id].page_id_ = INVALID_PAGE_ID;
+
+  // free frames stay at pin count -1 and out of the replacer
+  replacer_->Remove(frame_id);
+  free_list_.push_back(frame_id);
+}
+
+bool BufferPoolManagerInstance::Find_replacementL(frame_id_t *frame_id) {
+  // always find in free list first
+  if (!free_list_.empty()) {
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+    return true;
+  }
+
+  // then find in lru; a victim that got pinned lock-free since it was unpinned is dropped, it re-enters the
+  // replacer on its next unpin
+  frame_id_t fid;
+  while (replacer_->Victim(&fid)) {
+    int unpinned = 0;
+    if (pages_[fid].pin_count_.compare_exchange_strong(unpinned, -1)) {
+      if (debug_msg) {
+        LOG_INFO("Victim - page_id: %d", pages_[fid].GetPageId());
+      }
+      *frame_id = fid;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace bustub
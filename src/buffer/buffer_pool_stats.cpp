@@ -0,0 +1,144 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.cpp
+//
+// Identification: src/buffer/buffer_pool_stats.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+namespace bustub {
+
+uint64_t LatencyHistogramSnapshot::Count() const {
+  uint64_t count = 0;
+  for (uint64_t bucket : buckets_) {
+    count += bucket;
+  }
+  return count;
+}
+
+double LatencyHistogramSnapshot::MeanNs() const {
+  uint64_t count = Count();
+  return count == 0 ? 0.0 : static_cast<double>(sum_ns_) / count;
+}
+
+uint64_t LatencyHistogramSnapshot::QuantileNs(double quantile) const {
+  uint64_t count = Count();
+  if (count == 0) {
+    return 0;
+  }
+  auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * count)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return i == 0 ? 0 : (uint64_t{1} << i) - 1;
+    }
+  }
+  return (uint64_t{1} << (buckets_.size() - 1)) - 1;
+}
+
+void LatencyHistogramSnapshot::Merge(const LatencyHistogramSnapshot &other) {
+  sum_ns_ += other.sum_ns_;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+}
+
+LatencyHistogramSnapshot LatencyHistogramSnapshot::Since(const LatencyHistogramSnapshot &earlier) const {
+  LatencyHistogramSnapshot delta;
+  delta.sum_ns_ = sum_ns_ - earlier.sum_ns_;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    delta.buckets_[i] = buckets_[i] - earlier.buckets_[i];
+  }
+  return delta;
+}
+
+LatencyHistogramSnapshot LatencyHistogram::Snapshot() const {
+  LatencyHistogramSnapshot snapshot;
+  snapshot.sum_ns_ = sum_ns_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    snapshot.buckets_[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+void LatencyHistogram::Reset() {
+  sum_ns_.store(0, std::memory_order_relaxed);
+  for (auto &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+double BufferPoolStatsSnapshot::HitRatio() const {
+  uint64_t fetches = fetch_hits_ + fetch_misses_;
+  return fetches == 0 ? 0.0 : static_cast<double>(fetch_hits_) / fetches;
+}
+
+void BufferPoolStatsSnapshot::Merge(const BufferPoolStatsSnapshot &other) {
+  fetch_hits_ += other.fetch_hits_;
+  fetch_misses_ += other.fetch_misses_;
+  new_pages_ += other.new_pages_;
+  evictions_ += other.evictions_;
+  dirty_evictions_ += other.dirty_evictions_;
+  flushes_ += other.flushes_;
+  background_flushes_ += other.background_flushes_;
+  prefetches_ += other.prefetches_;
+  latch_wait_.Merge(other.latch_wait_);
+  read_io_.Merge(other.read_io_);
+  write_io_.Merge(other.write_io_);
+}
+
+BufferPoolStatsSnapshot BufferPoolStatsSnapshot::Since(const BufferPoolStatsSnapshot &earlier) const {
+  BufferPoolStatsSnapshot delta;
+  delta.fetch_hits_ = fetch_hits_ - earlier.fetch_hits_;
+  delta.fetch_misses_ = fetch_misses_ - earlier.fetch_misses_;
+  delta.new_pages_ = new_pages_ - earlier.new_pages_;
+  delta.evictions_ = evictions_ - earlier.evictions_;
+  delta.dirty_evictions_ = dirty_evictions_ - earlier.dirty_evictions_;
+  delta.flushes_ = flushes_ - earlier.flushes_;
+  delta.background_flushes_ = background_flushes_ - earlier.background_flushes_;
+  delta.prefetches_ = prefetches_ - earlier.prefetches_;
+  delta.latch_wait_ = latch_wait_.Since(earlier.latch_wait_);
+  delta.read_io_ = read_io_.Since(earlier.read_io_);
+  delta.write_io_ = write_io_.Since(earlier.write_io_);
+  return delta;
+}
+
+std::string BufferPoolStatsSnapshot::ToString() const {
+  char buf[512];
+  snprintf(buf, sizeof(buf),
+           "hits %" PRIu64 " misses %" PRIu64 " (hit ratio %.3f) new %" PRIu64 " evictions %" PRIu64
+           " dirty evictions %" PRIu64 " flushes %" PRIu64 " background flushes %" PRIu64 " prefetches %" PRIu64
+           " | latch wait mean %.0fns p99 <%" PRIu64 "ns | read mean %.0fns p99 <%" PRIu64
+           "ns | write mean %.0fns p99 <%" PRIu64 "ns",
+           fetch_hits_, fetch_misses_, HitRatio(), new_pages_, evictions_, dirty_evictions_, flushes_,
+           background_flushes_, prefetches_, latch_wait_.MeanNs(), latch_wait_.QuantileNs(0.99), read_io_.MeanNs(),
+           read_io_.QuantileNs(0.99), write_io_.MeanNs(), write_io_.QuantileNs(0.99));
+  return buf;
+}
+
+BufferPoolStatsSnapshot BufferPoolStats::Snapshot() const {
+  BufferPoolStatsSnapshot snapshot;
+  snapshot.fetch_hits_ = fetch_hits_.load(std::memory_order_relaxed);
+  snapshot.fetch_misses_ = fetch_misses_.load(std::memory_order_relaxed);
+  snapshot.new_pages_ = new_pages_.load(std::memory_order_relaxed);
+  snapshot.evictions_ = evictions_.load(std::memory_order_relaxed);
+  snapshot.flushes_ = flushes_.load(std::memory_order_relaxed);
+  snapshot.latch_wait_ = latch_wait_.Snapshot();
+  snapshot.read_io_ = read_io_.Snapshot();
+  snapshot.write_io_ = write_io_.Snapshot();
+  return snapshot;
+}
+
+}  // namespace bustub
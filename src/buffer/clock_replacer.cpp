@@ -12,18 +12,71 @@
 
 #include "buffer/clock_replacer.h"
 
+#include <initializer_list>
+
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages)
+    : num_pages_(num_pages), state_(std::make_unique<std::atomic<uint8_t>[]>(num_pages)) {
+  for (size_t i = 0; i < num_pages_; i++) {
+    state_[i].store(0, std::memory_order_relaxed);
+  }
+}
 
 ClockReplacer::~ClockReplacer() = default;
 
-bool ClockReplacer::Victim(frame_id_t *frame_id) { return false; }
+bool ClockReplacer::Victim(frame_id_t *frame_id) {
+  // two full sweeps clear every reference bit and then find a frame, unless Unpins keep racing with us
+  for (size_t step = 0; step < 3 * num_pages_; step++) {
+    if (size_.load(std::memory_order_acquire) == 0) {
+      break;
+    }
+    size_t pos = hand_.fetch_add(1, std::memory_order_relaxed) % num_pages_;
+    uint8_t state = state_[pos].load(std::memory_order_acquire);
+    if ((state & IN_REPLACER) == 0) {
+      continue;
+    }
+    if ((state & REFERENCED) != 0) {
+      // second chance
+      state_[pos].compare_exchange_strong(state, IN_REPLACER, std::memory_order_acq_rel);
+      continue;
+    }
+    if (state_[pos].compare_exchange_strong(state, 0, std::memory_order_acq_rel)) {
+      size_.fetch_sub(1, std::memory_order_acq_rel);
+      *frame_id = static_cast<frame_id_t>(pos);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  if ((state_[frame_id].exchange(0, std::memory_order_acq_rel) & IN_REPLACER) != 0) {
+    size_.fetch_sub(1, std::memory_order_acq_rel);
+  }
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  if ((state_[frame_id].exchange(IN_REPLACER | REFERENCED, std::memory_order_acq_rel) & IN_REPLACER) == 0) {
+    size_.fetch_add(1, std::memory_order_acq_rel);
+  }
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+size_t ClockReplacer::Peek(frame_id_t *frame_ids, size_t max_frames) {
+  // the hand takes unreferenced frames on its first pass and referenced ones on the second
+  size_t n = 0;
+  size_t hand = hand_.load(std::memory_order_relaxed);
+  for (uint8_t want : {IN_REPLACER, static_cast<uint8_t>(IN_REPLACER | REFERENCED)}) {
+    for (size_t i = 0; i < num_pages_ && n < max_frames; i++) {
+      size_t pos = (hand + i) % num_pages_;
+      if (state_[pos].load(std::memory_order_relaxed) == want) {
+        frame_ids[n++] = static_cast<frame_id_t>(pos);
+      }
+    }
+  }
+  return n;
+}
 
-size_t ClockReplacer::Size() { return 0; }
+size_t ClockReplacer::Size() { return size_.load(std::memory_order_acquire); }
 
 }  // namespace bustub
@@ -0,0 +1,172 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_array.cpp
+//
+// Identification: src/buffer/frame_array.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_array.h"
+
+#include <linux/mman.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#ifdef BUSTUB_HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+namespace {
+
+constexpr size_t HUGE_2MB_BYTES = size_t{1} << 21;
+constexpr size_t HUGE_1GB_BYTES = size_t{1} << 30;
+
+/** @return n rounded up to a multiple of m */
+size_t RoundUp(size_t n, size_t m) { return (n + m - 1) / m * m; }
+
+/** @return size in bytes of the pages of a kind */
+size_t PageBytes(FramePageSize page_size) {
+  switch (page_size) {
+    case FramePageSize::TRANSPARENT_HUGE:
+    case FramePageSize::HUGE_2MB:
+      return HUGE_2MB_BYTES;
+    case FramePageSize::HUGE_1GB:
+      return HUGE_1GB_BYTES;
+    default:
+      return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  }
+}
+
+}  // namespace
+
+FrameArray::FrameArray(size_t num_frames, size_t num_partitions, FramePageSize page_size, FrameNumaPolicy numa_policy,
+                       size_t frame_size)
+    : num_frames_(num_frames), frame_size_(frame_size) {
+  Map(page_size);
+  Place(numa_policy, num_partitions);
+
+  // constructing the frames zeroes them, which is the first touch that commits the memory on its nodes
+  pages_ = reinterpret_cast<Page *>(static_cast<char *>(memory_) + num_frames_ * frame_size_);
+  for (size_t i = 0; i < num_frames_; ++i) {
+    Page *page = new (pages_ + i) Page();
+    page->data_ = static_cast<char *>(memory_) + i * frame_size_;
+    page->size_ = static_cast<int>(frame_size_);
+    page->ResetMemory();
+  }
+}
+
+FrameArray::~FrameArray() {
+  for (size_t i = 0; i < num_frames_; ++i) {
+    pages_[i].~Page();
+  }
+  munmap(memory_, mapped_size_);
+}
+
+void FrameArray::Map(FramePageSize page_size) {
+  const int prot = PROT_READ | PROT_WRITE;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  static_assert(PAGE_SIZE % alignof(Page) == 0, "the Page objects follow the page data");
+  size_t bytes = std::max<size_t>(num_frames_ * (frame_size_ + sizeof(Page)), 1);
+
+  if (page_size == FramePageSize::HUGE_2MB || page_size == FramePageSize::HUGE_1GB) {
+    size_t size = RoundUp(bytes, PageBytes(page_size));
+    int huge_flags = MAP_HUGETLB | (page_size == FramePageSize::HUGE_1GB ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+    void *memory = mmap(nullptr, size, prot, flags | huge_flags, -1, 0);
+    if (memory != MAP_FAILED) {
+      memory_ = memory;
+      mapped_size_ = size;
+      page_size_ = page_size;
+      return;
+    }
+    LOG_DEBUG("not enough huge pages reserved for %zu bytes of frames, falling back to transparent huge pages", size);
+    page_size = FramePageSize::TRANSPARENT_HUGE;
+  }
+
+  // a mapping smaller than a huge page cannot use one anyway
+  if (page_size == FramePageSize::TRANSPARENT_HUGE && bytes >= HUGE_2MB_BYTES) {
+    // over-map by a huge page and trim, so that the frames start on a huge page boundary
+    size_t size = RoundUp(bytes, HUGE_2MB_BYTES);
+    void *raw = mmap(nullptr, size + HUGE_2MB_BYTES, prot, flags, -1, 0);
+    if (raw == MAP_FAILED) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "can't map buffer pool frames");
+    }
+    auto raw_start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t start = RoundUp(raw_start, HUGE_2MB_BYTES);
+    if (start > raw_start) {
+      munmap(raw, start - raw_start);
+    }
+    if (start < raw_start + HUGE_2MB_BYTES) {
+      munmap(reinterpret_cast<void *>(start + size), raw_start + HUGE_2MB_BYTES - start);
+    }
+    memory_ = reinterpret_cast<void *>(start);
+    mapped_size_ = size;
+    // fails on kernels built without transparent huge pages
+    page_size_ = madvise(memory_, mapped_size_, MADV_HUGEPAGE) == 0 ? FramePageSize::TRANSPARENT_HUGE
+                                                                    : FramePageSize::DEFAULT;
+    return;
+  }
+
+  mapped_size_ = RoundUp(bytes, PageBytes(FramePageSize::DEFAULT));
+  memory_ = mmap(nullptr, mapped_size_, prot, flags, -1, 0);
+  if (memory_ == MAP_FAILED) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "can't map buffer pool frames");
+  }
+  page_size_ = FramePageSize::DEFAULT;
+}
+
+void FrameArray::Place(FrameNumaPolicy numa_policy, size_t num_partitions) {
+  numa_policy_ = FrameNumaPolicy::LOCAL;
+  if (numa_policy == FrameNumaPolicy::LOCAL) {
+    return;
+  }
+#ifdef BUSTUB_HAVE_LIBNUMA
+  if (numa_available() < 0 || numa_num_configured_nodes() < 2) {
+    LOG_DEBUG("no NUMA nodes to spread the frames over, placing them on first touch");
+    return;
+  }
+  if (numa_policy == FrameNumaPolicy::INTERLEAVE) {
+    numa_interleave_memory(memory_, mapped_size_, numa_all_nodes_ptr);
+  } else {
+    // the data and the Page objects of a partition go to the same node; boundaries are rounded to whole pages, so a
+    // page straddling one goes with the partition it starts in
+    const size_t granularity = PageBytes(page_size_);
+    const size_t frames_per_partition = num_frames_ / num_partitions;
+    const size_t data_bytes = num_frames_ * frame_size_;
+    const int num_nodes = numa_num_configured_nodes();
+    auto bind = [&](size_t begin, size_t end, int node) {
+      begin = RoundUp(begin, granularity);
+      end = std::min(RoundUp(end, granularity), mapped_size_);
+      if (begin < end) {
+        numa_tonode_memory(static_cast<char *>(memory_) + begin, end - begin, node);
+      }
+    };
+    for (size_t i = 0; i < num_partitions; ++i) {
+      size_t first = i * frames_per_partition;
+      size_t last = i + 1 == num_partitions ? num_frames_ : (i + 1) * frames_per_partition;
+      auto node = static_cast<int>(i % num_nodes);
+      bind(first * frame_size_, last * frame_size_, node);
+      bind(data_bytes + first * sizeof(Page), i + 1 == num_partitions ? mapped_size_ : data_bytes + last * sizeof(Page),
+           node);
+    }
+  }
+  numa_policy_ = numa_policy;
+#else
+  (void)num_partitions;
+  LOG_DEBUG("built without libnuma, placing the frames on first touch");
+#endif
+}
+
+}  // namespace bustub
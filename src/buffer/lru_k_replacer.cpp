@@ -0,0 +1,105 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include <initializer_list>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k) : k_(k), history_(num_pages), evictable_(num_pages, false) {
+  if (k_ == 0) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "LRU-K needs k >= 1");
+  }
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+bool LRUKReplacer::Victim(frame_id_t *frame_id) {
+  std::scoped_lock<std::mutex> lock(mu);
+
+  std::set<Entry> *from = !infinite_.empty() ? &infinite_ : &finite_;
+  if (from->empty()) {
+    return false;
+  }
+  *frame_id = from->begin()->second;
+  from->erase(from->begin());
+  evictable_[*frame_id] = false;
+
+  // the next page in this frame starts with a clean history
+  history_[*frame_id].clear();
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::scoped_lock<std::mutex> lock(mu);
+  EraseL(frame_id);
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::scoped_lock<std::mutex> lock(mu);
+  EraseL(frame_id);
+
+  auto &history = history_[frame_id];
+  history.push_back(current_timestamp_++);
+  if (history.size() > k_) {
+    history.pop_front();
+  }
+
+  bool full;
+  Entry key = KeyOfL(frame_id, &full);
+  (full ? finite_ : infinite_).insert(key);
+  evictable_[frame_id] = true;
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::scoped_lock<std::mutex> lock(mu);
+  EraseL(frame_id);
+  history_[frame_id].clear();
+}
+
+size_t LRUKReplacer::Peek(frame_id_t *frame_ids, size_t max_frames) {
+  std::scoped_lock<std::mutex> lock(mu);
+  size_t n = 0;
+  for (const auto *order : {&infinite_, &finite_}) {
+    for (auto it = order->begin(); it != order->end() && n < max_frames; ++it) {
+      frame_ids[n++] = it->second;
+    }
+  }
+  return n;
+}
+
+size_t LRUKReplacer::Size() {
+  std::scoped_lock<std::mutex> lock(mu);
+  return infinite_.size() + finite_.size();
+}
+
+void LRUKReplacer::EraseL(frame_id_t frame_id) {
+  if (!evictable_[frame_id]) {
+    return;
+  }
+  bool full;
+  Entry key = KeyOfL(frame_id, &full);
+  (full ? finite_ : infinite_).erase(key);
+  evictable_[frame_id] = false;
+}
+
+LRUKReplacer::Entry LRUKReplacer::KeyOfL(frame_id_t frame_id, bool *full) const {
+  // with a full history the front is the k-th most recent access; otherwise it is the first access
+  const auto &history = history_[frame_id];
+  *full = history.size() >= k_;
+  return {history.front(), frame_id};
+}
+
+}  // namespace bustub
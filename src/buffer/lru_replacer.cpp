@@ -65,6 +65,15 @@ void LRUReplacer::Unpin(frame_id_t frame_id) {
   }
 }
 
+size_t LRUReplacer::Peek(frame_id_t *frame_ids, size_t max_frames) {
+  std::scoped_lock<std::mutex> lock(mu);
+  size_t n = 0;
+  for (auto it = lst.begin(); it != lst.end() && n < max_frames; ++it) {
+    frame_ids[n++] = *it;
+  }
+  return n;
+}
+
 size_t LRUReplacer::Size() {
   std::scoped_lock<std::mutex> lock(mu);
   size_t res = static_cast<size_t>(lst.size());
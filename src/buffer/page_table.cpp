@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.cpp
+//
+// Identification: src/buffer/page_table.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_table.h"
+
+#include "common/exception.h"
+
+namespace bustub {
+
+PageTable::PageTable(size_t num_frames) : capacity_(2), shift_(63) {
+  // keep the load factor at or below 1/2
+  while (capacity_ < num_frames * 2) {
+    capacity_ <<= 1;
+    shift_--;
+  }
+  mask_ = capacity_ - 1;
+  slots_ = std::make_unique<std::atomic<uint64_t>[]>(capacity_);
+  for (size_t i = 0; i < capacity_; i++) {
+    slots_[i].store(EMPTY_SLOT, std::memory_order_relaxed);
+  }
+}
+
+bool PageTable::Find(page_id_t page_id, frame_id_t *frame_id) const {
+  size_t pos = Home(page_id);
+  for (size_t probes = 0; probes < capacity_; probes++) {
+    uint64_t slot = slots_[pos].load(std::memory_order_acquire);
+    if (slot == EMPTY_SLOT) {
+      return false;
+    }
+    if (KeyOf(slot) == page_id) {
+      *frame_id = ValueOf(slot);
+      return true;
+    }
+    pos = (pos + 1) & mask_;
+  }
+  return false;
+}
+
+void PageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  if (size_ * 2 >= capacity_) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "page table is full");
+  }
+  size_t pos = Home(page_id);
+  while (slots_[pos].load(std::memory_order_relaxed) != EMPTY_SLOT) {
+    pos = (pos + 1) & mask_;
+  }
+  slots_[pos].store(Pack(page_id, frame_id), std::memory_order_release);
+  size_++;
+}
+
+bool PageTable::Erase(page_id_t page_id) {
+  size_t hole = Home(page_id);
+  while (true) {
+    uint64_t slot = slots_[hole].load(std::memory_order_relaxed);
+    if (slot == EMPTY_SLOT) {
+      return false;
+    }
+    if (KeyOf(slot) == page_id) {
+      break;
+    }
+    hole = (hole + 1) & mask_;
+  }
+
+  // Backward-shift deletion: pull later entries of the probe run into the hole unless that would move them before
+  // their home slot. Each entry is copied before its old slot is overwritten, so readers never see a wrong mapping.
+  size_t pos = hole;
+  while (true) {
+    pos = (pos + 1) & mask_;
+    uint64_t slot = slots_[pos].load(std::memory_order_relaxed);
+    if (slot == EMPTY_SLOT) {
+      break;
+    }
+    size_t home = Home(KeyOf(slot));
+    // the entry may move to hole iff its home is not cyclically within (hole, pos]
+    bool stays = hole <= pos ? (hole < home && home <= pos) : (hole < home || home <= pos);
+    if (!stays) {
+      slots_[hole].store(slot, std::memory_order_release);
+      hole = pos;
+    }
+  }
+  slots_[hole].store(EMPTY_SLOT, std::memory_order_release);
+  size_--;
+  return true;
+}
+
+}  // namespace bustub
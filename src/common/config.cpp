@@ -18,6 +18,26 @@ std::atomic<bool> enable_logging(false);
 
 std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
 
+std::chrono::milliseconds page_flush_interval = std::chrono::milliseconds(10);
+
+std::chrono::milliseconds bpm_stats_log_interval = std::chrono::seconds(10);
+
+std::atomic<size_t> table_scan_read_ahead(8);
+
+std::atomic<bool> btree_optimistic_reads(true);
+
+std::atomic<bool> btree_optimistic_writes(true);
+
+std::atomic<BTreeLatchProtocol> btree_latch_protocol(BTreeLatchProtocol::CRABBING);
+
+double btree_bulk_load_fill_factor = 0.9;
+
+std::atomic<bool> btree_key_prefix_search(true);
+
+std::atomic<FramePageSize> frame_page_size(FramePageSize::DEFAULT);
+
+std::atomic<FrameNumaPolicy> frame_numa_policy(FrameNumaPolicy::LOCAL);
+
 std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
 
 }  // namespace bustub
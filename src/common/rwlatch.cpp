@@ -0,0 +1,112 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// rwlatch.cpp
+//
+// Identification: src/common/rwlatch.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/rwlatch.h"
+
+#include <climits>
+#include <thread>  // NOLINT
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bustub {
+
+namespace {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex(2) works on plain 32-bit words");
+
+/** Tells the CPU that this is a spin loop, so that it backs off and leaves the core to its sibling thread. */
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+/** Sleeps until word is woken, unless it no longer holds expected. */
+void FutexWait(std::atomic<uint32_t> *word, uint32_t expected) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+  std::this_thread::yield();
+#endif
+}
+
+/** Wakes every thread sleeping on word. */
+void FutexWakeAll(std::atomic<uint32_t> *word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+}  // namespace
+
+void ReaderWriterLatch::WLockSlow() {
+  uint32_t state = state_.load(std::memory_order_relaxed);
+  int spins = 0;
+  for (;;) {
+    if ((state & (WRITER | READER_MASK)) == 0) {
+      // taking the latch withdraws the claim; other writers that still wait renew it
+      if (state_.compare_exchange_weak(state, (state & PARKED) | WRITER, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return;
+      }
+      continue;
+    }
+    if ((state & WRITER_PENDING) == 0) {
+      if (!state_.compare_exchange_weak(state, state | WRITER_PENDING, std::memory_order_relaxed,
+                                        std::memory_order_relaxed)) {
+        continue;
+      }
+      state |= WRITER_PENDING;
+    }
+    state = Wait(state, &spins);
+  }
+}
+
+void ReaderWriterLatch::RLockSlow() {
+  uint32_t state = state_.load(std::memory_order_relaxed);
+  int spins = 0;
+  for (;;) {
+    if ((state & (WRITER | WRITER_PENDING)) == 0 && (state & READER_MASK) != READER_MASK) {
+      if (state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return;
+      }
+      continue;
+    }
+    state = Wait(state, &spins);
+  }
+}
+
+uint32_t ReaderWriterLatch::Wait(uint32_t state, int *spins) {
+  if (*spins < SPIN_LIMIT) {
+    ++*spins;
+    CpuRelax();
+    return state_.load(std::memory_order_relaxed);
+  }
+  // Announce the sleeper in the word itself. The exchange only succeeds if the latch is still held the way the caller
+  // saw it, so the release that lets it in is still to come, and that release sees the flag and wakes it.
+  if ((state & PARKED) == 0 &&
+      !state_.compare_exchange_weak(state, state | PARKED, std::memory_order_relaxed, std::memory_order_relaxed)) {
+    return state;
+  }
+  FutexWait(&state_, state | PARKED);
+  return state_.load(std::memory_order_relaxed);
+}
+
+void ReaderWriterLatch::WakeAll() { FutexWakeAll(&state_); }
+
+}  // namespace bustub
@@ -9,6 +9,8 @@
 // Copyright (c) 2015-19, Carnegie Mellon University Database Group
 //
 //===----------------------------------------------------------------------===//
+#include <memory>
+
 #include "execution/executors/index_scan_executor.h"
 #include "common/exception.h"
 #include "common/logger.h"
@@ -23,13 +25,33 @@ IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanP
 void IndexScanExecutor::Init() {
   auto *tree_index = dynamic_cast<BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>> *>(
       GetExecutorContext()->GetCatalog()->GetIndex(plan_->GetIndexOid())->index_.get());
-  itr_ = tree_index->GetBeginIterator();
+  // bounds are key tuples of the index's key schema
+  const Schema &key_schema = GetExecutorContext()->GetCatalog()->GetIndex(plan_->GetIndexOid())->key_schema_;
+  if (!plan_->GetLowKey().empty() || !plan_->GetHighKey().empty() || plan_->IsReverse()) {
+    std::unique_ptr<Tuple> low;
+    std::unique_ptr<Tuple> high;
+    if (!plan_->GetLowKey().empty()) {
+      low = std::make_unique<Tuple>(plan_->GetLowKey(), &key_schema);
+    }
+    if (!plan_->GetHighKey().empty()) {
+      high = std::make_unique<Tuple>(plan_->GetHighKey(), &key_schema);
+    }
+    itr_ = tree_index->GetRangeIterator(low.get(), high.get(), plan_->IsReverse());
+  } else {
+    itr_ = tree_index->GetBeginIterator();
+  }
   itr_end_ = tree_index->GetEndIterator();
+  batch_rids_.clear();
+  batch_tuples_.clear();
+  batch_pos_ = 0;
   LOG_INFO("%s", tbl_name_.c_str());
   LOG_INFO("%s", GetExecutorContext()->GetCatalog()->GetTable(tbl_name_)->schema_.ToString().c_str());
 }
 
 bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
+  if (plan_->GetRidBatchSize() > 0) {
+    return NextInBatch(tuple, rid);
+  }
   while (itr_ != itr_end_) {
     // get rid
     auto mapping_type = *itr_;
@@ -57,4 +79,33 @@ bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
   return false;
 }
 
+bool IndexScanExecutor::NextInBatch(Tuple *tuple, RID *rid) {
+  auto *p = plan_->GetPredicate();  // could be nullptr
+  while (true) {
+    for (; batch_pos_ < batch_rids_.size(); batch_pos_++) {
+      if (p == nullptr || p->Evaluate(&batch_tuples_[batch_pos_], GetOutputSchema()).GetAs<bool>()) {
+        *tuple = batch_tuples_[batch_pos_];
+        *rid = batch_rids_[batch_pos_++];
+        return true;
+      }
+    }
+    if (itr_ == itr_end_) {
+      return false;
+    }
+
+    // the rids of the next keys, whose tuples are read in page order and returned in key order
+    batch_rids_.clear();
+    batch_pos_ = 0;
+    for (; itr_ != itr_end_ && batch_rids_.size() < plan_->GetRidBatchSize(); ++itr_) {
+      batch_rids_.push_back((*itr_).second);
+    }
+    auto ok = GetExecutorContext()->GetCatalog()->GetTable(tbl_name_)->table_->GetTuples(
+        batch_rids_, &batch_tuples_, GetExecutorContext()->GetTransaction());
+    if (!ok) {
+      LOG_DEBUG("fatal index scan");
+      throw Exception(ExceptionType::INVALID, "index scan");
+    }
+  }
+}
+
 }  // namespace bustub
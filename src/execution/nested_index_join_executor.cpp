@@ -36,25 +36,41 @@ void NestIndexJoinExecutor::Init() {
   try {
     Tuple tuple;
     RID rid;
-    while (child_executor_->Next(&tuple, &rid)) {
-      // make key
-      std::vector<RID> rids;
-      auto index_key = tuple.KeyFromTuple(*child_executor_->GetOutputSchema(), inner_index_info->key_schema_,
-                                          inner_index_info->index_->GetKeyAttrs());
-      inner_index_info->index_->ScanKey(index_key, &rids, GetExecutorContext()->GetTransaction());
-
-      // if cannot find in index, then it does not match
-      if (rids.empty()) {
-        continue;
+    if (plan_->GetKeyBatchSize() > 0) {
+      std::vector<Tuple> outer_tuples;
+      std::vector<Tuple> keys;
+      while (child_executor_->Next(&tuple, &rid)) {
+        keys.push_back(tuple.KeyFromTuple(*child_executor_->GetOutputSchema(), inner_index_info->key_schema_,
+                                          inner_index_info->index_->GetKeyAttrs()));
+        outer_tuples.push_back(tuple);
+        if (outer_tuples.size() == plan_->GetKeyBatchSize()) {
+          JoinBatch(outer_tuples, keys);
+          outer_tuples.clear();
+          keys.clear();
+        }
       }
+      JoinBatch(outer_tuples, keys);
+    } else {
+      while (child_executor_->Next(&tuple, &rid)) {
+        // make key
+        std::vector<RID> rids;
+        auto index_key = tuple.KeyFromTuple(*child_executor_->GetOutputSchema(), inner_index_info->key_schema_,
+                                            inner_index_info->index_->GetKeyAttrs());
+        inner_index_info->index_->ScanKey(index_key, &rids, GetExecutorContext()->GetTransaction());
 
-      // get outter
-      outter_table_tuple_.push_back(tuple);
+        // if cannot find in index, then it does not match
+        if (rids.empty()) {
+          continue;
+        }
 
-      // get inner tuple
-      Tuple inner_tuple;
-      inner_table_info->table_->GetTuple(rids[0], &inner_tuple, GetExecutorContext()->GetTransaction());
-      inner_table_tuple_.push_back(inner_tuple);
+        // get outter
+        outter_table_tuple_.push_back(tuple);
+
+        // get inner tuple
+        Tuple inner_tuple;
+        inner_table_info->table_->GetTuple(rids[0], &inner_tuple, GetExecutorContext()->GetTransaction());
+        inner_table_tuple_.push_back(inner_tuple);
+      }
     }
   } catch (Exception &e) {
     LOG_DEBUG("NestIndexJoinExecutor %s", e.what());
@@ -62,6 +78,28 @@ void NestIndexJoinExecutor::Init() {
   LOG_INFO("outter tuple: %ld - inner tuple: %ld", outter_table_tuple_.size(), inner_table_tuple_.size());
 }
 
+void NestIndexJoinExecutor::JoinBatch(const std::vector<Tuple> &outer_tuples, const std::vector<Tuple> &keys) {
+  if (keys.empty()) {
+    return;
+  }
+  auto inner_table_info = GetExecutorContext()->GetCatalog()->GetTable(plan_->GetInnerTableOid());
+  auto inner_index_info = GetExecutorContext()->GetCatalog()->GetIndex(plan_->GetIndexName(), inner_table_info->name_);
+  std::vector<std::vector<RID>> results;
+  inner_index_info->index_->ScanKeys(keys, &results, GetExecutorContext()->GetTransaction());
+
+  // if cannot find in index, then it does not match; the inner tuples of the matches are read in page order
+  std::vector<RID> inner_rids;
+  for (size_t i = 0; i < outer_tuples.size(); i++) {
+    if (!results[i].empty()) {
+      outter_table_tuple_.push_back(outer_tuples[i]);
+      inner_rids.push_back(results[i][0]);
+    }
+  }
+  std::vector<Tuple> inner_tuples;
+  inner_table_info->table_->GetTuples(inner_rids, &inner_tuples, GetExecutorContext()->GetTransaction());
+  inner_table_tuple_.insert(inner_table_tuple_.end(), inner_tuples.begin(), inner_tuples.end());
+}
+
 bool NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) {
   // get schema
   const auto *out_schema = plan_->OuterTableSchema();
@@ -12,38 +12,78 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>  // NOLINT
-#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
 
-#include "buffer/lru_replacer.h"
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/frame_array.h"
 #include "common/config.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * The pool is partitioned into num_instances BufferPoolManagerInstances, each owning pool_size frames with their own
+ * page table, replacer and latch. A page always lives in instance (page_id % num_instances), so operations on pages of
+ * different instances proceed in parallel.
+ *
+ * Pages of the larger size classes (see PageSizeClass) live in frame pools of their own: every size class that is
+ * given frames gets num_instances instances whose frames have its page size, and a page goes to instance
+ * (n % num_instances) of its class, n being its position in the file counted in pages of its size.
  */
 class BufferPoolManager {
  public:
   enum class CallbackType { BEFORE, AFTER };
   using bufferpool_callback_fn = void (*)(enum CallbackType, const page_id_t page_id);
 
-  void check();
-  void info();
-  void gc();
-  void init_gc();
-
   /**
    * Creates a new BufferPoolManager.
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy
+   * @param replacer_k history depth, only used by ReplacerType::LRU_K
+   */
+  BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                    ReplacerType replacer_type = ReplacerType::LRU, size_t replacer_k = LRUK_REPLACER_K);
+
+  /**
+   * Creates a new partitioned BufferPoolManager.
+   * @param num_instances the number of buffer pool instances
+   * @param pool_size the size of each buffer pool instance
+   * @param disk_manager the disk manager
+   * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy of every instance
+   * @param replacer_k history depth, only used by ReplacerType::LRU_K
    */
-  BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
+                    LogManager *log_manager = nullptr, ReplacerType replacer_type = ReplacerType::LRU,
+                    size_t replacer_k = LRUK_REPLACER_K);
+
+  /**
+   * Creates a new partitioned BufferPoolManager with frames of several page sizes.
+   * @param num_instances the number of buffer pool instances of each size class
+   * @param pool_sizes the size of each buffer pool instance, per size class; pages of a class given 0 frames can
+   * neither be created nor fetched
+   * @param disk_manager the disk manager
+   * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy of every instance
+   * @param replacer_k history depth, only used by ReplacerType::LRU_K
+   */
+  BufferPoolManager(size_t num_instances, const std::array<size_t, NUM_PAGE_SIZE_CLASSES> &pool_sizes,
+                    DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                    ReplacerType replacer_type = ReplacerType::LRU, size_t replacer_k = LRUK_REPLACER_K);
 
   /**
    * Destroys an existing BufferPoolManager.
@@ -82,6 +122,14 @@ class BufferPoolManager {
     return result;
   }
 
+  /**
+   * Creates a new page of a size class in the buffer pool.
+   * @param[out] page_id id of created page
+   * @param size_class size of the page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  Page *NewPage(page_id_t *page_id, PageSizeClass size_class) { return NewPageImpl(page_id, size_class); }
+
   /** Grading function. Do not modify! */
   bool DeletePage(page_id_t page_id, bufferpool_callback_fn callback = nullptr) {
     GradingCallback(callback, CallbackType::BEFORE, page_id);
@@ -97,11 +145,122 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
-  /** @return pointer to all the pages in the buffer pool */
-  Page *GetPages() { return pages_; }
+  /**
+   * Fetches a page and wraps the pin in a guard that releases it.
+   * @param page_id id of the page to fetch
+   * @return a guard holding the page pinned, invalid if the page could not be brought into the pool
+   */
+  BasicPageGuard FetchPageBasic(page_id_t page_id) { return {this, FetchPage(page_id)}; }
 
-  /** @return size of the buffer pool */
-  size_t GetPoolSize() { return pool_size_; }
+  /**
+   * Fetches and read latches a page, wrapping both in a guard that releases them.
+   * @param page_id id of the page to fetch
+   * @return a guard holding the page pinned and read latched, invalid if the page could not be brought into the pool
+   */
+  ReadPageGuard FetchPageRead(page_id_t page_id) { return FetchPageBasic(page_id).UpgradeRead(); }
+
+  /**
+   * Fetches and write latches a page, wrapping both in a guard that releases them.
+   * @param page_id id of the page to fetch
+   * @return a guard holding the page pinned and write latched, invalid if the page could not be brought into the pool
+   */
+  WritePageGuard FetchPageWrite(page_id_t page_id) { return FetchPageBasic(page_id).UpgradeWrite(); }
+
+  /**
+   * Creates a new page and wraps the pin in a guard that releases it. The new page is unpinned dirty.
+   * @param[out] page_id id of the created page
+   * @param size_class size of the page
+   * @return a guard holding the new page pinned, invalid if all the frames of the size class are pinned
+   */
+  BasicPageGuard NewPageGuarded(page_id_t *page_id, PageSizeClass size_class = PageSizeClass::PAGE_4K) {
+    BasicPageGuard guard(this, NewPage(page_id, size_class));
+    if (guard.IsValid()) {
+      guard.SetDirty();
+    }
+    return guard;
+  }
+
+  /** @return pointer to all the frames of a size class in the buffer pool, nullptr if it has none */
+  Page *GetPages(PageSizeClass size_class = PageSizeClass::PAGE_4K) {
+    FrameArray *frames = frames_[static_cast<size_t>(size_class)];
+    return frames == nullptr ? nullptr : frames->GetPages();
+  }
+
+  /** @return the memory backing the frames of a size class in the buffer pool, nullptr if it has none */
+  const FrameArray *GetFrameArray(PageSizeClass size_class = PageSizeClass::PAGE_4K) const {
+    return frames_[static_cast<size_t>(size_class)];
+  }
+
+  /** @return number of frames of a size class in the buffer pool, summed over all instances */
+  size_t GetPoolSize(PageSizeClass size_class = PageSizeClass::PAGE_4K) const {
+    return pool_sizes_[static_cast<size_t>(size_class)];
+  }
+
+  /** @return number of buffer pool instances of each size class */
+  size_t GetNumInstances() const { return num_instances_; }
+
+  /**
+   * Starts the background flush thread. Every page_flush_interval it writes back the dirty pages among the next
+   * eviction candidates of each instance, so that misses mostly find clean victims and only have to read.
+   */
+  void RunFlushThread();
+
+  /**
+   * Stops and joins the background flush thread, if running.
+   */
+  void StopFlushThread();
+
+  /** @return fraction of frames that are dirty, racy while the pool is in use */
+  double GetDirtyRatio();
+
+  /** @return the number of pages written back by the flush thread */
+  uint64_t GetNumBackgroundWrites() const { return background_writes_; }
+
+  /** @return pages per second written back by the flush thread, measured over the time it spent writing */
+  double GetBackgroundWriteThroughput() const;
+
+  /** @return the number of dirty victims that FetchPage and NewPage had to write back synchronously */
+  uint64_t GetNumForegroundWrites() const;
+
+  /**
+   * Announces the frames to the disk manager as the memory page I/O is performed on, which lets backends such as
+   * DiskManagerUring register them with the kernel once. The disk manager must then outlive the buffer pool, whose
+   * destructor withdraws them again.
+   */
+  void RegisterFrames();
+
+  /**
+   * Asynchronously reads pages [first, first + n) into the buffer pool, unpinned, so that a later FetchPage of them
+   * hits. Pages past the end of the database file and pages already resident are skipped; requests beyond what the
+   * pool can hold are dropped. The prefetch thread is started on first use and hands the queued pages to the disk
+   * manager as one batch.
+   * @param first id of the first page to read
+   * @param n number of pages to read
+   */
+  void PrefetchPages(page_id_t first, size_t n);
+
+  /** @return the number of pages read in by the prefetch thread */
+  uint64_t GetNumPrefetches() const { return prefetches_; }
+
+  /**
+   * @return the statistics of the whole pool: the sum over its instances, plus the pages written by FlushAllPages,
+   * the flush thread and the prefetch thread. Counters are read one by one, so a snapshot taken while the pool is
+   * in use may be slightly torn.
+   */
+  BufferPoolStatsSnapshot GetStats() const;
+
+  /** @return the statistics of one instance */
+  BufferPoolStatsSnapshot GetInstanceStats(size_t instance) const { return instances_[instance]->GetStats(); }
+
+  /**
+   * Starts the stats logger thread. Every bpm_stats_log_interval it logs what the pool did since its previous dump.
+   */
+  void RunStatsLogger();
+
+  /**
+   * Stops and joins the stats logger thread, if running.
+   */
+  void StopStatsLogger();
 
  protected:
   /**
@@ -142,9 +301,10 @@ class BufferPoolManager {
   /**
    * Creates a new page in the buffer pool.
    * @param[out] page_id id of created page
+   * @param size_class size of the page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  Page *NewPageImpl(page_id_t *page_id);
+  Page *NewPageImpl(page_id_t *page_id, PageSizeClass size_class = PageSizeClass::PAGE_4K);
 
   /**
    * Deletes a page from the buffer pool.
@@ -159,35 +319,78 @@ class BufferPoolManager {
   void FlushAllPagesImpl();
 
   /**
-   * reset page meta data, caller must hold lock
-   */
-  void Reset_meta_dataL(frame_id_t frame_id);
-
-  /**
-   * find replacement pages
+   * @return the instance responsible for page_id, nullptr if the page id is invalid or its size class has no frames
    */
-  frame_id_t Find_replacementL();
+  BufferPoolManagerInstance *GetInstance(page_id_t page_id) {
+    auto size_class = static_cast<size_t>(GetPageSizeClass(page_id));
+    if (page_id < 0 || size_class >= NUM_PAGE_SIZE_CLASSES || pool_sizes_[size_class] == 0) {
+      return nullptr;
+    }
+    auto page_number = static_cast<size_t>(GetPageSlot(page_id) / SlotsOfClass(GetPageSizeClass(page_id)));
+    return instances_[first_instance_[size_class] + page_number % num_instances_].get();
+  }
 
+  /** Number of buffer pool instances of each size class. */
+  size_t num_instances_;
+  /** Number of frames of each size class, summed over its instances. */
+  std::array<size_t, NUM_PAGE_SIZE_CLASSES> pool_sizes_{};
   /**
-   * check if all frames in the buffer pool are pinned
+   * Memory of the frames of each size class, backed and placed according to frame_page_size and frame_numa_policy;
+   * nullptr for classes without frames. Instance i of a class owns the i-th slice of its frames.
    */
-  bool is_all_pin();
-
-  /** Number of pages in the buffer pool. */
-  size_t pool_size_;
-  /** Array of buffer pool pages. */
-  Page *pages_;
+  std::array<FrameArray *, NUM_PAGE_SIZE_CLASSES> frames_{};
   /** Pointer to the disk manager. */
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
-  /** Replacer to find unpinned pages for replacement. */
-  Replacer *replacer_;
-  /** List of free pages. */
-  std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
-  std::mutex latch_;
+  /** Buffer pool instances of all size classes, those of one class next to each other. */
+  std::vector<std::unique_ptr<BufferPoolManagerInstance>> instances_;
+  /** Index into instances_ of the first instance of each size class. */
+  std::array<size_t, NUM_PAGE_SIZE_CLASSES> first_instance_{};
+
+  /** Background flush thread, nullptr when not running. */
+  std::thread *flush_thread_{nullptr};
+  /** True while the flush thread should keep running. */
+  std::atomic<bool> enable_flushing_{false};
+  /** Protects enable_flushing_ transitions for cv_. */
+  std::mutex flush_latch_;
+  /** Wakes the flush thread up early when it is being stopped. */
+  std::condition_variable cv_;
+  /** Pages written back by the flush thread. */
+  std::atomic<uint64_t> background_writes_{0};
+  /** Nanoseconds the flush thread spent in rounds that wrote at least one page. */
+  std::atomic<uint64_t> background_write_ns_{0};
+
+  /** Stops and joins the prefetch thread, if running. */
+  void StopPrefetchThread();
+
+  /** Prefetch thread, started by the first PrefetchPages call; nullptr when not running. */
+  std::thread *prefetch_thread_{nullptr};
+  /** True while the prefetch thread should keep running. */
+  bool enable_prefetching_{false};
+  /** Pages waiting to be read by the prefetch thread. */
+  std::deque<page_id_t> prefetch_queue_;
+  /** Protects prefetch_queue_, prefetch_thread_ and enable_prefetching_. */
+  std::mutex prefetch_latch_;
+  /** Wakes the prefetch thread up when pages are queued or it is being stopped. */
+  std::condition_variable prefetch_cv_;
+  /** True if the frames have been announced to the disk manager by RegisterFrames. */
+  bool frames_registered_{false};
+
+  /** Pages read in by the prefetch thread. */
+  std::atomic<uint64_t> prefetches_{0};
+  /** Prefetch reads submitted to the disk manager that have not completed yet, guarded by prefetch_latch_. */
+  size_t prefetches_in_flight_{0};
+
+  /** Writes of FlushAllPages, which covers all instances at once. */
+  BufferPoolStats stats_;
+  /** Stats logger thread, nullptr when not running. */
+  std::thread *stats_thread_{nullptr};
+  /** True while the stats logger thread should keep running, guarded by stats_latch_. */
+  bool enable_stats_logging_{false};
+  /** Protects stats_thread_ and enable_stats_logging_. */
+  std::mutex stats_latch_;
+  /** Wakes the stats logger thread up early when it is being stopped. */
+  std::condition_variable stats_cv_;
 };
 }  // namespace bustub
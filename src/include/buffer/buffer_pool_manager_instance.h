@@ -0,0 +1,258 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_instance.h
+//
+// Identification: src/include/buffer/buffer_pool_manager_instance.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <list>
+#include <mutex>  // NOLINT
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_stats.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "buffer/page_table.h"
+#include "common/config.h"
+#include "common/macros.h"
+#include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * BufferPoolManagerInstance manages one shard of the buffer pool: a contiguous slice of frames together with its own
+ * page table, free list, replacer and latch. BufferPoolManager routes every page id to exactly one instance, so
+ * threads working on pages of different instances never contend on the same latch.
+ *
+ * Hits do not take the latch at all: the page table supports lock-free lookups and a frame is pinned with a CAS on
+ * its atomic pin count. Only misses, evictions and deletions take the latch; they claim a frame by swinging its pin
+ * count from 0 to -1, which makes concurrent lock-free pins fail over to the latched path.
+ *
+ * Disk I/O on misses happens outside the latch: the frame is reassigned under the latch and flagged "I/O in progress",
+ * then the victim write-back and the read run unlatched. Requests for a page whose frame is still being filled, or
+ * whose write-back as a victim has not landed yet, wait on io_cv_ instead of issuing their own I/O.
+ */
+class BufferPoolManagerInstance {
+ public:
+  /**
+   * Creates a new BufferPoolManagerInstance.
+   * @param pages the frames owned by this instance, allocated (and freed) by the BufferPoolManager
+   * @param pool_size the number of frames owned by this instance
+   * @param disk_manager the disk manager
+   * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy of this instance
+   * @param replacer_k history depth, only used by ReplacerType::LRU_K
+   */
+  BufferPoolManagerInstance(Page *pages, size_t pool_size, DiskManager *disk_manager, LogManager *log_manager,
+                            ReplacerType replacer_type = ReplacerType::LRU, size_t replacer_k = LRUK_REPLACER_K);
+
+  /**
+   * Destroys an existing BufferPoolManagerInstance. The frames are not freed.
+   */
+  ~BufferPoolManagerInstance();
+
+  DISALLOW_COPY_AND_MOVE(BufferPoolManagerInstance);
+
+  /**
+   * Fetch the requested page from this instance.
+   * @param page_id id of page to be fetched
+   * @return the requested page, nullptr if every frame is pinned
+   */
+  Page *FetchPage(page_id_t page_id);
+
+  /**
+   * Unpin the target page.
+   * @param page_id id of page to be unpinned
+   * @param is_dirty true if the page should be marked as dirty, false otherwise
+   * @return false if the page pin count is <= 0 before this call, true otherwise
+   */
+  bool UnpinPage(page_id_t page_id, bool is_dirty);
+
+  /**
+   * Flushes the target page to disk.
+   * @param page_id id of page to be flushed, cannot be INVALID_PAGE_ID
+   * @return false if the page could not be found in the page table, true otherwise
+   */
+  bool FlushPage(page_id_t page_id);
+
+  /**
+   * Brings a freshly allocated page into this instance.
+   * @param page_id id of the page, already allocated by the disk manager
+   * @return nullptr if every frame is pinned, otherwise pointer to the new (zeroed and pinned) page
+   */
+  Page *NewPage(page_id_t page_id);
+
+  /**
+   * Claims a frame to read page_id into ahead of use and writes its victim back. The frame stays "I/O in progress"
+   * until EndPrefetch, so the caller may fill it asynchronously.
+   * @param page_id id of page to be read
+   * @param[out] old_page_id the victim, to be passed to EndPrefetch
+   * @return the frame to read into, nullptr if the page is resident already or every frame is pinned
+   */
+  Page *BeginPrefetch(page_id_t page_id, page_id_t *old_page_id);
+
+  /**
+   * Publishes a frame filled after BeginPrefetch, unpinned.
+   * @param page the frame returned by BeginPrefetch
+   * @param old_page_id the victim returned by BeginPrefetch
+   */
+  void EndPrefetch(Page *page, page_id_t old_page_id);
+
+  /** @return true if the page is resident or being read in; lock-free and possibly stale */
+  bool IsResident(page_id_t page_id) const {
+    frame_id_t frame_id;
+    return page_table_.Find(page_id, &frame_id);
+  }
+
+  /**
+   * Deletes a page from this instance.
+   * @param page_id id of page to be deleted
+   * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
+   */
+  bool DeletePage(page_id_t page_id);
+
+  /**
+   * Flushes all the pages of this instance to disk, with one vectored write per run of adjacent page ids.
+   */
+  void FlushAllPages();
+
+  /**
+   * First half of FlushAllPages, split off so that BufferPoolManager can write the pages of all instances at once:
+   * takes the latch, marks every resident page clean and collects it. The latch keeps the frames from being
+   * reassigned until the pages have been written.
+   * @param[out] pages receives the page ids and data to write
+   * @param[out] pending receives the victims whose write-back is in flight
+   * @return the held latch
+   */
+  std::unique_lock<std::mutex> BeginFlushAll(std::vector<std::pair<page_id_t, const char *>> *pages,
+                                             std::unordered_set<page_id_t> *pending);
+
+  /**
+   * Second half of FlushAllPages, once the collected pages are written: waits for the pending victims, then releases
+   * the latch.
+   * @param lock the latch returned by BeginFlushAll
+   * @param pending the victims returned by BeginFlushAll
+   */
+  void EndFlushAll(std::unique_lock<std::mutex> *lock, const std::unordered_set<page_id_t> &pending);
+
+  /**
+   * Writes back the dirty pages among the next lookahead eviction candidates, so that later misses find clean
+   * victims. Takes the read latch of each page it writes, but never the instance latch.
+   * @param lookahead the number of eviction candidates to look at
+   * @return the number of pages written
+   */
+  size_t FlushEvictionCandidates(size_t lookahead);
+
+  /** @return the number of dirty frames, racy while the instance is in use */
+  size_t GetNumDirtyFrames();
+
+  /** @return the number of dirty victims FetchPage and NewPage had to write back themselves */
+  uint64_t GetNumForegroundWrites() const { return foreground_writes_; }
+
+  /** @return the hit, miss, eviction and write-back counts and the latch and I/O latencies of this instance */
+  BufferPoolStatsSnapshot GetStats() const;
+
+  /** @return size of this instance */
+  size_t GetPoolSize() const { return pool_size_; }
+
+ private:
+  /**
+   * Takes the latch, recording how long that took.
+   * @return the held latch
+   */
+  std::unique_lock<std::mutex> LockLatch();
+
+  /**
+   * Takes the latch again after it was released, recording how long that took.
+   */
+  void RelockLatch(std::unique_lock<std::mutex> *lock);
+
+  /**
+   * Pins the frame without taking the latch, provided it still holds page_id and is not being reassigned.
+   * @return true if the frame was pinned
+   */
+  bool TryPin(frame_id_t frame_id, page_id_t page_id);
+
+  /**
+   * pin a frame found in the page table, caller must hold lock
+   */
+  void PinL(frame_id_t frame_id);
+
+  /**
+   * drop one pin of the frame, handing it to the replacer when it reaches zero
+   * @return false if the frame was not pinned
+   */
+  bool UnpinFrame(frame_id_t frame_id);
+
+  /**
+   * Hands a claimed frame over to page_id: the victim's mapping moves to evicting_, the new mapping is published and
+   * the frame is flagged "I/O in progress". Caller must hold lock.
+   * @return the page id of the victim, INVALID_PAGE_ID for a free frame
+   */
+  page_id_t BeginIOL(frame_id_t frame_id, page_id_t page_id);
+
+  /**
+   * writes the victim back if it is dirty, caller must hold the page write latch but not lock
+   */
+  void WriteBackVictim(page_id_t old_page_id, Page *page);
+
+  /**
+   * clears "I/O in progress" and wakes up waiters, caller must hold lock
+   * @param pin true to hand the frame to the requester pinned, false to leave it unpinned in the replacer
+   */
+  void EndIOL(frame_id_t frame_id, page_id_t old_page_id, bool pin = true);
+
+  /**
+   * reset page meta data and return the frame to the free list, caller must hold lock
+   */
+  void Reset_meta_dataL(frame_id_t frame_id);
+
+  /**
+   * find a replacement frame and claim it (pin count -1), caller must hold lock
+   * @return false if every frame is pinned
+   */
+  bool Find_replacementL(frame_id_t *frame_id);
+
+  /** Number of frames in this instance. */
+  size_t pool_size_;
+  /** Frames of this instance; frame_id_t is an index into this array. */
+  Page *pages_;
+  /** Pointer to the disk manager. */
+  DiskManager *disk_manager_;
+  /** Pointer to the log manager. */
+  LogManager *log_manager_ __attribute__((__unused__));
+  /** Page table for keeping track of the pages of this instance; lookups are lock-free, updates hold latch_. */
+  PageTable page_table_;
+  /** Replacer to find unpinned pages for replacement. */
+  Replacer *replacer_;
+  /** List of free frames. */
+  std::list<frame_id_t> free_list_;
+  /** Per frame: the frame has been handed to a new page whose I/O has not completed yet. */
+  std::vector<bool> io_in_progress_;
+  /** Victim pages whose frame has been handed over but whose write-back may not have landed yet. */
+  std::unordered_set<page_id_t> evicting_;
+  /** Signalled under latch_ whenever an I/O in progress completes. */
+  std::condition_variable io_cv_;
+  /** Dirty victims written back on the FetchPage/NewPage path. */
+  std::atomic<uint64_t> foreground_writes_{0};
+  /** Counters and latency histograms, reported by GetStats. */
+  BufferPoolStats stats_;
+  /** Serializes page table updates, free_list_, io_in_progress_, evicting_ and the reassignment of frames. */
+  std::mutex latch_;
+};
+
+}  // namespace bustub
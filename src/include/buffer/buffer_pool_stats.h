@@ -0,0 +1,201 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+
+namespace bustub {
+
+/** False when the buffer pool statistics are compiled out (cmake -DBUSTUB_BPM_STATS=OFF). */
+#ifdef BUSTUB_DISABLE_BPM_STATS
+static constexpr bool BPM_STATS_ENABLED = false;
+#else
+static constexpr bool BPM_STATS_ENABLED = true;
+#endif
+
+/** Number of buckets of a latency histogram: bucket 0 counts 0 ns, bucket i counts [2^(i-1), 2^i) ns. */
+static constexpr size_t LATENCY_HISTOGRAM_BUCKETS = 40;
+
+/**
+ * A copy of a LatencyHistogram taken at one point in time.
+ */
+struct LatencyHistogramSnapshot {
+  /** @return the number of recorded latencies */
+  uint64_t Count() const;
+
+  /** @return the mean latency in nanoseconds, 0 if nothing was recorded */
+  double MeanNs() const;
+
+  /**
+   * @param quantile a fraction in (0, 1]
+   * @return the upper bound in nanoseconds of the bucket that holds the quantile, 0 if nothing was recorded
+   */
+  uint64_t QuantileNs(double quantile) const;
+
+  /** Adds the latencies of another snapshot to this one. */
+  void Merge(const LatencyHistogramSnapshot &other);
+
+  /** @return the latencies recorded after earlier was taken */
+  LatencyHistogramSnapshot Since(const LatencyHistogramSnapshot &earlier) const;
+
+  /** Total of the recorded latencies. */
+  uint64_t sum_ns_{0};
+  /** Number of latencies per power-of-two bucket. */
+  std::array<uint64_t, LATENCY_HISTOGRAM_BUCKETS> buckets_{};
+};
+
+/**
+ * LatencyHistogram counts latencies in power-of-two buckets. Recording is two relaxed atomic increments, so it can sit
+ * on hot paths that many threads share; snapshots taken while latencies are being recorded may be slightly torn.
+ */
+class LatencyHistogram {
+ public:
+  LatencyHistogram() { Reset(); }
+
+  /** Records one latency. */
+  void Record(uint64_t ns) {
+    size_t bucket = ns == 0 ? 0 : std::min<size_t>(64 - __builtin_clzll(ns), LATENCY_HISTOGRAM_BUCKETS - 1);
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  /** @return a copy of the histogram */
+  LatencyHistogramSnapshot Snapshot() const;
+
+  /** Forgets every recorded latency. */
+  void Reset();
+
+ private:
+  std::array<std::atomic<uint64_t>, LATENCY_HISTOGRAM_BUCKETS> buckets_;
+  std::atomic<uint64_t> sum_ns_;
+};
+
+/**
+ * Measures how long an operation took, for the buffer pool statistics. Does not read the clock when they are compiled
+ * out.
+ */
+class StatsTimer {
+ public:
+  StatsTimer() : start_(Now()) {}
+
+  /** @return nanoseconds since the timer was created */
+  uint64_t ElapsedNs() const { return Now() - start_; }
+
+ private:
+  static uint64_t Now() {
+    if constexpr (BPM_STATS_ENABLED) {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+    } else {
+      return 0;
+    }
+  }
+
+  uint64_t start_;
+};
+
+/**
+ * The statistics of a buffer pool, or of one of its instances, at one point in time.
+ */
+struct BufferPoolStatsSnapshot {
+  /** @return the fraction of fetches that found their page in the pool, 0 if there were none */
+  double HitRatio() const;
+
+  /** Adds the counts of another snapshot to this one. */
+  void Merge(const BufferPoolStatsSnapshot &other);
+
+  /** @return the activity after earlier was taken */
+  BufferPoolStatsSnapshot Since(const BufferPoolStatsSnapshot &earlier) const;
+
+  /** @return a one-line summary, for the log */
+  std::string ToString() const;
+
+  /** Fetches that found the page resident, including those that waited for another thread to read it in. */
+  uint64_t fetch_hits_{0};
+  /** Fetches that had to read the page from disk. */
+  uint64_t fetch_misses_{0};
+  /** Pages created by NewPage. */
+  uint64_t new_pages_{0};
+  /** Frames taken away from a resident page to hold another one. */
+  uint64_t evictions_{0};
+  /** Dirty victims that fetches and new pages had to write back themselves. */
+  uint64_t dirty_evictions_{0};
+  /** Dirty pages written back by FlushPage and FlushAllPages. */
+  uint64_t flushes_{0};
+  /** Dirty pages written back by the background flush thread. */
+  uint64_t background_flushes_{0};
+  /** Pages read in ahead of use by the prefetch thread. */
+  uint64_t prefetches_{0};
+  /** Time spent acquiring the instance latch, per acquisition. */
+  LatencyHistogramSnapshot latch_wait_;
+  /** Time spent in synchronous page reads. */
+  LatencyHistogramSnapshot read_io_;
+  /** Time spent in synchronous page writes, per disk manager call. */
+  LatencyHistogramSnapshot write_io_;
+};
+
+/**
+ * BufferPoolStats collects the counters and latency histograms of one buffer pool instance. Each Record call is a
+ * relaxed atomic increment, and compiles to nothing when the statistics are compiled out.
+ */
+class BufferPoolStats {
+ public:
+  void RecordHit() { Add(&fetch_hits_); }
+  void RecordMiss() { Add(&fetch_misses_); }
+  void RecordNewPage() { Add(&new_pages_); }
+  void RecordEviction() { Add(&evictions_); }
+  void RecordFlushes(uint64_t pages) { Add(&flushes_, pages); }
+
+  void RecordLatchWait(uint64_t ns) {
+    if constexpr (BPM_STATS_ENABLED) {
+      latch_wait_.Record(ns);
+    }
+  }
+  void RecordRead(uint64_t ns) {
+    if constexpr (BPM_STATS_ENABLED) {
+      read_io_.Record(ns);
+    }
+  }
+  void RecordWrite(uint64_t ns) {
+    if constexpr (BPM_STATS_ENABLED) {
+      write_io_.Record(ns);
+    }
+  }
+
+  /** @return a copy of the counters and histograms */
+  BufferPoolStatsSnapshot Snapshot() const;
+
+ private:
+  static void Add(std::atomic<uint64_t> *counter, uint64_t n = 1) {
+    if constexpr (BPM_STATS_ENABLED) {
+      counter->fetch_add(n, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<uint64_t> fetch_hits_{0};
+  std::atomic<uint64_t> fetch_misses_{0};
+  std::atomic<uint64_t> new_pages_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> flushes_{0};
+  LatencyHistogram latch_wait_;
+  LatencyHistogram read_io_;
+  LatencyHistogram write_io_;
+};
+
+}  // namespace bustub
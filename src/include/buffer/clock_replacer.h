@@ -12,9 +12,9 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>  // NOLINT
-#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 
 #include "buffer/replacer.h"
 #include "common/config.h"
@@ -23,6 +23,10 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * Every frame has one atomic state byte holding an "in replacer" flag and a reference bit, so Pin and Unpin are a
+ * single atomic exchange and never block. Victim sweeps an atomic clock hand over the frames, clearing reference bits
+ * and claiming the first unreferenced frame with a CAS; concurrent victims therefore never return the same frame.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -43,10 +47,25 @@ class ClockReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  size_t Peek(frame_id_t *frame_ids, size_t max_frames) override;
+
   size_t Size() override;
 
  private:
-  // TODO(student): implement me!
+  static constexpr uint8_t IN_REPLACER = 0x1;
+  static constexpr uint8_t REFERENCED = 0x2;
+
+  // number of frames tracked
+  size_t num_pages_;
+
+  // per frame IN_REPLACER | REFERENCED flags
+  std::unique_ptr<std::atomic<uint8_t>[]> state_;
+
+  // next frame the clock hand looks at, taken modulo num_pages_
+  std::atomic<size_t> hand_{0};
+
+  // number of frames with IN_REPLACER set
+  std::atomic<size_t> size_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,91 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_array.h
+//
+// Identification: src/include/buffer/frame_array.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/config.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * FrameArray owns the memory of the buffer pool frames.
+ *
+ * The frames are mapped anonymously rather than taken from the heap, so that the pages backing them can be chosen:
+ * reserved huge pages (MAP_HUGETLB) cut the TLB misses of large pools, and when none are reserved the mapping falls
+ * back to base pages that the kernel is asked to collapse into transparent huge pages. Before the frames are first
+ * touched, their memory is placed on NUMA nodes according to the policy: interleaved page by page over all nodes, or
+ * with each partition (buffer pool instance) bound to one node, round robin. NUMA placement needs libnuma and is
+ * skipped without it or on machines with a single node.
+ *
+ * The mapping holds the page data of all frames first, frame_size bytes each, followed by the Page objects that point
+ * into it. Keeping the data contiguous lets it be registered with the disk manager as one range.
+ */
+class FrameArray {
+ public:
+  /**
+   * Maps and constructs the frames.
+   * @param num_frames number of frames
+   * @param num_partitions number of equally sized partitions the frames are split into
+   * @param page_size pages to back the frames with
+   * @param numa_policy placement of the frames across NUMA nodes
+   * @param frame_size size in bytes of the data of each frame, a multiple of PAGE_SIZE
+   */
+  FrameArray(size_t num_frames, size_t num_partitions, FramePageSize page_size = frame_page_size,
+             FrameNumaPolicy numa_policy = frame_numa_policy, size_t frame_size = PAGE_SIZE);
+
+  /** Destroys the frames and unmaps their memory. */
+  ~FrameArray();
+
+  FrameArray(const FrameArray &) = delete;
+  FrameArray &operator=(const FrameArray &) = delete;
+
+  /** @return the frames */
+  Page *GetPages() { return pages_; }
+
+  /** @return the number of frames */
+  size_t GetNumFrames() const { return num_frames_; }
+
+  /** @return the size in bytes of the data of each frame */
+  size_t GetFrameSize() const { return frame_size_; }
+
+  /** @return the start of the page data of all frames, GetFrameSize() * GetNumFrames() bytes */
+  char *GetData() { return static_cast<char *>(memory_); }
+
+  /** @return the pages the frames are actually backed with, after any fallback */
+  FramePageSize GetPageSize() const { return page_size_; }
+
+  /** @return the NUMA placement actually applied to the frames, LOCAL if none could be */
+  FrameNumaPolicy GetNumaPolicy() const { return numa_policy_; }
+
+ private:
+  /** Maps mapped_size_ bytes with the requested pages, falling back to smaller ones; sets page_size_. */
+  void Map(FramePageSize page_size);
+
+  /** Places the mapping on NUMA nodes; sets numa_policy_. */
+  void Place(FrameNumaPolicy numa_policy, size_t num_partitions);
+
+  /** Start of the mapping. */
+  void *memory_{nullptr};
+  /** Length of the mapping, a multiple of the size of the pages backing it. */
+  size_t mapped_size_{0};
+  /** The frames, after their data in the mapping. */
+  Page *pages_{nullptr};
+  size_t num_frames_;
+  size_t frame_size_;
+  FramePageSize page_size_{FramePageSize::DEFAULT};
+  FrameNumaPolicy numa_policy_{FrameNumaPolicy::LOCAL};
+};
+
+}  // namespace bustub
@@ -0,0 +1,91 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * Every time a frame becomes evictable (Unpin) counts as one access. The victim is the evictable frame whose K-th most
+ * recent access lies furthest in the past; frames with fewer than K recorded accesses have an infinite backward
+ * K-distance and are evicted first, oldest first. Pages touched once by a sequential scan therefore leave the pool
+ * before pages that are referenced repeatedly, such as B+ tree inner pages.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of accesses remembered per frame
+   */
+  explicit LRUKReplacer(size_t num_pages, size_t k = LRUK_REPLACER_K);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  size_t Peek(frame_id_t *frame_ids, size_t max_frames) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  size_t Size() override;
+
+ private:
+  using Entry = std::pair<uint64_t, frame_id_t>;
+
+  /** removes the frame from the eviction order, caller must hold lock */
+  void EraseL(frame_id_t frame_id);
+
+  /** @return the eviction key of the frame and whether it has a full history, caller must hold lock */
+  Entry KeyOfL(frame_id_t frame_id, bool *full) const;
+
+  // history depth
+  size_t k_;
+
+  // logical clock, advanced on every access
+  uint64_t current_timestamp_{0};
+
+  // per frame: up to k_ most recent access timestamps, oldest first
+  std::vector<std::deque<uint64_t>> history_;
+
+  // per frame: whether it is currently in one of the two sets below
+  std::vector<bool> evictable_;
+
+  // evictable frames with fewer than k_ accesses, ordered by their oldest access
+  std::set<Entry> infinite_;
+
+  // evictable frames with k_ accesses, ordered by their k-th most recent access
+  std::set<Entry> finite_;
+
+  mutable std::mutex mu;
+};
+
+}  // namespace bustub
@@ -44,6 +44,8 @@ class LRUReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  size_t Peek(frame_id_t *frame_ids, size_t max_frames) override;
+
   size_t Size() override;
 
  private:
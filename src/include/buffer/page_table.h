@@ -0,0 +1,88 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.h
+//
+// Identification: src/include/buffer/page_table.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * PageTable maps page ids to frame ids for one buffer pool instance.
+ *
+ * It is a fixed-capacity, linear-probing hash table whose slots are single 64-bit atomics, sized so that the load
+ * factor never exceeds 1/2. Find() never blocks. Insert() and Erase() must be serialized by the caller (the buffer
+ * pool instance latch). Erase() uses backward-shift deletion, so a concurrent Find() may miss an entry that is being
+ * moved; callers treat a miss as "take the latch and look again".
+ */
+class PageTable {
+ public:
+  /**
+   * Creates a new PageTable.
+   * @param num_frames the maximum number of entries the table must hold
+   */
+  explicit PageTable(size_t num_frames);
+
+  ~PageTable() = default;
+
+  DISALLOW_COPY_AND_MOVE(PageTable);
+
+  /**
+   * Lock-free lookup.
+   * @param page_id the page to look up
+   * @param[out] frame_id the frame holding the page, if found
+   * @return true if the page was found
+   */
+  bool Find(page_id_t page_id, frame_id_t *frame_id) const;
+
+  /**
+   * Inserts a mapping; the page must not be present already. Caller serializes writers.
+   */
+  void Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * Removes the mapping of page_id, if present. Caller serializes writers.
+   * @return true if the page was present
+   */
+  bool Erase(page_id_t page_id);
+
+  /** @return number of entries, exact only while writers are excluded */
+  size_t Size() const { return size_; }
+
+ private:
+  static constexpr uint64_t EMPTY_SLOT = UINT64_MAX;
+
+  static uint64_t Pack(page_id_t page_id, frame_id_t frame_id) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32) | static_cast<uint32_t>(frame_id);
+  }
+  static page_id_t KeyOf(uint64_t slot) { return static_cast<page_id_t>(slot >> 32); }
+  static frame_id_t ValueOf(uint64_t slot) { return static_cast<frame_id_t>(slot & 0xFFFFFFFF); }
+
+  /** @return home slot of page_id (Fibonacci hashing, so that strided page ids of a shard still spread out) */
+  size_t Home(page_id_t page_id) const {
+    return static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(page_id)) * 0x9E3779B97F4A7C15ULL) >>
+                               shift_);
+  }
+
+  size_t capacity_;
+  size_t mask_;
+  int shift_;
+  size_t size_{0};
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+
+}  // namespace bustub
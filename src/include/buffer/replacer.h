@@ -16,6 +16,9 @@
 
 namespace bustub {
 
+/** Replacement policies a BufferPoolManager can be constructed with. */
+enum class ReplacerType { LRU, CLOCK, LRU_K };
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -43,6 +46,21 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Looks at the frames that would be victimized next, without removing them. Concurrent Pin/Unpin calls may make
+   * the answer stale immediately.
+   * @param[out] frame_ids array of at least max_frames entries, filled in eviction order
+   * @param max_frames the number of frames to look at
+   * @return the number of frames written to frame_ids
+   */
+  virtual size_t Peek(frame_id_t *frame_ids, size_t max_frames) = 0;
+
+  /**
+   * Forgets a frame whose page was deleted: it is no longer evictable and any access history it had is dropped.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual size_t Size() = 0;
 };
@@ -75,14 +75,17 @@ class Catalog {
    * @param txn the transaction in which the table is being created
    * @param table_name the name of the new table
    * @param schema the schema of the new table
+   * @param page_size_class size of the pages of the new table
    * @return a pointer to the metadata of the new table
    */
-  TableMetadata *CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema) {
+  TableMetadata *CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema,
+                             PageSizeClass page_size_class = PageSizeClass::PAGE_4K) {
     BUSTUB_ASSERT(names_.count(table_name) == 0, "Table names should be unique!");
 
     // construct table
     auto tbl_oid = next_table_oid_.fetch_add(1) + 1;
-    std::unique_ptr<TableHeap> tbl = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn);
+    std::unique_ptr<TableHeap> tbl =
+        std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn, page_size_class);
 
     // register
     tables_[tbl_oid] = std::make_unique<TableMetadata>(schema, table_name, std::move(tbl), tbl_oid);
@@ -117,32 +120,37 @@ class Catalog {
    * @param key_schema the schema of the key
    * @param key_attrs key attributes
    * @param keysize size of the key
+   * @param page_size_class size of the pages of the index's nodes
+   * @param page_layout whether the index's nodes store their keys prefix-compressed
    * @return a pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
-                         size_t keysize) {
+                         size_t keysize, PageSizeClass page_size_class = PageSizeClass::PAGE_4K,
+                         BTreePageLayout page_layout = BTreePageLayout::PLAIN) {
     // construct index oid
     auto idx_oid = next_index_oid_.fetch_add(1) + 1;
 
     // construct index meta data + index - not sure about hash index
     IndexMetadata *index_metadata = new IndexMetadata(index_name, table_name, &schema, key_attrs);
-    std::unique_ptr<BPLUSTREE_INDEX_TYPE> idx = std::make_unique<BPLUSTREE_INDEX_TYPE>(index_metadata, bpm_);
+    std::unique_ptr<BPLUSTREE_INDEX_TYPE> idx =
+        std::make_unique<BPLUSTREE_INDEX_TYPE>(index_metadata, bpm_, page_size_class, page_layout);
 
-    // populate tree index
+    // populate tree index - bulk loaded bottom-up from the sorted keys rather than inserted key by key
     auto *tbl_meta = GetTable(table_name);
     LOG_INFO("tbl name: %s", tbl_meta->name_.c_str());
+    auto builder = idx->GetBuilder();
     auto itr = tbl_meta->table_->Begin(txn);
     auto end = tbl_meta->table_->End();
     while (itr != end) {
-      auto tmp_rid = itr->GetRid();
-      auto tmp_tuple = *itr;
-      // idx->InsertEntry(tmp_tuple, tmp_rid, txn);  // insert to index
-      auto index_K_tmp = tmp_tuple.KeyFromTuple(schema, key_schema, key_attrs);
-      idx->InsertEntry(index_K_tmp, tmp_rid, txn);  // insert to index
-      ++itr;                                        // incr
+      auto index_K_tmp = itr->KeyFromTuple(schema, key_schema, key_attrs);
+      KeyType index_key;
+      index_key.SetFromKey(index_K_tmp, idx->GetKeySchema());
+      builder.Add(index_key, itr->GetRid());
+      ++itr;  // incr
     }
+    builder.Finish();
 
     // register
     indexes_[idx_oid] =
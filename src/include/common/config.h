@@ -27,14 +27,73 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** The buffer pool flush thread writes back dirty eviction candidates every PAGE_FLUSH_INTERVAL. */
+extern std::chrono::milliseconds page_flush_interval;
+
+/** The buffer pool stats logger logs the activity of the pool every BPM_STATS_LOG_INTERVAL. */
+extern std::chrono::milliseconds bpm_stats_log_interval;
+
+/** Number of pages a table scan keeps prefetched ahead of the page it is on; 0 disables read-ahead. */
+extern std::atomic<size_t> table_scan_read_ahead;
+
+/**
+ * True if B+ tree lookups descend with optimistic lock coupling: they read pages without latching them and validate
+ * the page versions afterwards, restarting if a writer got in the way.
+ */
+extern std::atomic<bool> btree_optimistic_reads;
+
+/**
+ * True if crabbing B+ tree inserts and removes first descend with read latches and write latch only the leaf. If the
+ * leaf could split or merge, they restart with a descent that write latches the ancestors.
+ */
+extern std::atomic<bool> btree_optimistic_writes;
+
+/**
+ * How B+ tree writers synchronize. CRABBING latches pages top-down, holding the ancestors a split or merge may change
+ * behind the root mutex. BLINK holds one latch at a time on the way down: splits publish the new page through a
+ * right-sibling link before its parent knows of it, and descents that land on a page that split move right; pages
+ * are not merged.
+ */
+enum class BTreeLatchProtocol { CRABBING, BLINK };
+
+/** Latch protocol of the B+ trees created from now on. */
+extern std::atomic<BTreeLatchProtocol> btree_latch_protocol;
+
+/**
+ * Fraction of a B+ tree node's capacity that a bulk load fills. Nodes filled to capacity split on the next insert;
+ * leaving room keeps the tree from splitting everywhere once inserts into a freshly built index start.
+ */
+extern double btree_bulk_load_fill_factor;
+
+/**
+ * True if the key comparators created from now on give B+ tree page searches a key prefix to compare: the first key
+ * column, if it is an integer. Searches then call into the typed comparison only where the prefixes tie.
+ */
+extern std::atomic<bool> btree_key_prefix_search;
+
+/** Pages backing the buffer pool frames: base pages, transparent huge pages or reserved 2 MB / 1 GB huge pages. */
+enum class FramePageSize { DEFAULT, TRANSPARENT_HUGE, HUGE_2MB, HUGE_1GB };
+
+/** Placement of the buffer pool frames across NUMA nodes: first touch, interleaved, or each instance on one node. */
+enum class FrameNumaPolicy { LOCAL, INTERLEAVE, BIND };
+
+/** Pages that buffer pools created from now on back their frames with. */
+extern std::atomic<FramePageSize> frame_page_size;
+
+/** NUMA placement of the frames of buffer pools created from now on. */
+extern std::atomic<FrameNumaPolicy> frame_numa_policy;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
+static constexpr int DIRECT_IO_ALIGNMENT = 512;  // alignment of page buffers and offsets for O_DIRECT I/O
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr size_t LRUK_REPLACER_K = 2;  // default K of the LRU-K replacer (history depth per frame)
+static constexpr unsigned DISK_URING_QUEUE_DEPTH = 64;  // default submission queue size of DiskManagerUring
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
@@ -43,4 +102,43 @@ using lsn_t = int32_t;         // log sequence number type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
 
+/**
+ * Pages come in three sizes, each a power-of-four multiple of PAGE_SIZE. The database file is addressed in slots of
+ * PAGE_SIZE bytes, and a page of a larger class takes a run of adjacent slots aligned to its length. A page id holds
+ * the page's first slot in its low bits and its size class above them, so the ids of PAGE_4K pages are their slots.
+ */
+enum class PageSizeClass : uint8_t { PAGE_4K = 0, PAGE_16K = 1, PAGE_64K = 2 };
+
+static constexpr size_t NUM_PAGE_SIZE_CLASSES = 3;                             // number of page size classes
+static constexpr int PAGE_SIZE_CLASS_SHIFT = 28;                               // position of the class in a page id
+static constexpr page_id_t PAGE_SLOT_MASK = (1 << PAGE_SIZE_CLASS_SHIFT) - 1;  // bits of a page id holding its slot
+static constexpr int MAX_PAGE_SIZE = PAGE_SIZE << 4;                           // size of a PAGE_64K page in byte
+
+/** @return the size in bytes of the pages of a size class */
+constexpr int PageSizeOfClass(PageSizeClass size_class) { return PAGE_SIZE << (2 * static_cast<int>(size_class)); }
+
+/** @return the number of slots a page of the size class takes */
+constexpr page_id_t SlotsOfClass(PageSizeClass size_class) { return 1 << (2 * static_cast<int>(size_class)); }
+
+/** @return the size class of a valid page id */
+constexpr PageSizeClass GetPageSizeClass(page_id_t page_id) {
+  return static_cast<PageSizeClass>(page_id >> PAGE_SIZE_CLASS_SHIFT);
+}
+
+/** @return the size in bytes of the page with a valid page id */
+constexpr int PageSizeOf(page_id_t page_id) { return PageSizeOfClass(GetPageSizeClass(page_id)); }
+
+/** @return the first slot of the page with a valid page id */
+constexpr page_id_t GetPageSlot(page_id_t page_id) { return page_id & PAGE_SLOT_MASK; }
+
+/** @return the id of the page of the size class that starts at slot */
+constexpr page_id_t MakePageId(PageSizeClass size_class, page_id_t slot) {
+  return static_cast<page_id_t>(size_class) << PAGE_SIZE_CLASS_SHIFT | slot;
+}
+
+/** @return the id of the page of the same size class n pages further into the file */
+constexpr page_id_t NextPageId(page_id_t page_id, page_id_t n = 1) {
+  return page_id + n * SlotsOfClass(GetPageSizeClass(page_id));
+}
+
 }  // namespace bustub
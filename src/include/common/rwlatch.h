@@ -12,27 +12,130 @@
 
 #pragma once
 
+#include <atomic>
 #include <climits>
 #include <condition_variable>  // NOLINT
-#include <mutex>               // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
 
 #include "common/macros.h"
 
 namespace bustub {
 
 /**
- * Reader-Writer latch backed by std::mutex.
+ * Reader-Writer latch built on a single atomic word.
+ *
+ * Taking or releasing an uncontended latch is one atomic read-modify-write. A thread that cannot get the latch spins
+ * for a while and then sleeps on the word with futex(2), so short critical sections never cost a system call and long
+ * ones do not burn a core. Writers are preferred: once a writer waits, new readers hold back until it has had its
+ * turn.
  */
 class ReaderWriterLatch {
+ public:
+  ReaderWriterLatch() = default;
+  ~ReaderWriterLatch() = default;
+
+  DISALLOW_COPY(ReaderWriterLatch);
+
+  /**
+   * Acquire a write latch.
+   */
+  void WLock() {
+    uint32_t state = 0;
+    if (!state_.compare_exchange_strong(state, WRITER, std::memory_order_acquire, std::memory_order_relaxed)) {
+      WLockSlow();
+    }
+  }
+
+  /**
+   * Release a write latch.
+   */
+  void WUnlock() {
+    // a pending writer keeps its claim, so it goes before the readers that wait
+    if ((state_.fetch_and(~(WRITER | PARKED), std::memory_order_release) & PARKED) != 0) {
+      WakeAll();
+    }
+  }
+
+  /**
+   * Acquire a read latch.
+   */
+  void RLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    if ((state & (WRITER | WRITER_PENDING)) != 0 || (state & READER_MASK) == READER_MASK ||
+        !state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+      RLockSlow();
+    }
+  }
+
+  /**
+   * Acquire a read latch if that does not take waiting.
+   * @return true if the latch was acquired
+   */
+  bool TryRLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & (WRITER | WRITER_PENDING)) == 0 && (state & READER_MASK) != READER_MASK) {
+      if (state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Release a read latch.
+   */
+  void RUnlock() {
+    uint32_t state = state_.fetch_sub(1, std::memory_order_release);
+    // only the last reader can let a waiting writer in; readers that wait are waiting for that writer
+    if ((state & READER_MASK) == 1 && (state & PARKED) != 0 &&
+        (state_.fetch_and(~PARKED, std::memory_order_relaxed) & PARKED) != 0) {
+      WakeAll();
+    }
+  }
+
+ private:
+  /** A writer holds the latch. */
+  static constexpr uint32_t WRITER = 1U << 31;
+  /** A writer waits for the latch; readers do not enter until it had it. */
+  static constexpr uint32_t WRITER_PENDING = 1U << 30;
+  /** At least one thread sleeps on the word; whoever releases the latch wakes them. */
+  static constexpr uint32_t PARKED = 1U << 29;
+  /** The number of readers holding the latch. */
+  static constexpr uint32_t READER_MASK = PARKED - 1;
+  /** Rounds a waiting thread spins before it goes to sleep. */
+  static constexpr int SPIN_LIMIT = 64;
+
+  void WLockSlow();
+  void RLockSlow();
+
+  /**
+   * Waits for state_ to change, spinning for the first SPIN_LIMIT rounds and sleeping afterwards.
+   * @param state the value the caller saw, under which it cannot get the latch
+   * @param spins rounds spun so far, updated
+   * @return the current value of state_
+   */
+  uint32_t Wait(uint32_t state, int *spins);
+
+  void WakeAll();
+
+  std::atomic<uint32_t> state_{0};
+};
+
+/**
+ * Reader-Writer latch backed by std::mutex. This was the latch of the pages before ReaderWriterLatch; it is kept to
+ * compare against.
+ */
+class MutexReaderWriterLatch {
   using mutex_t = std::mutex;
   using cond_t = std::condition_variable;
   static const uint32_t MAX_READERS = UINT_MAX;
 
  public:
-  ReaderWriterLatch() = default;
-  ~ReaderWriterLatch() { std::lock_guard<mutex_t> guard(mutex_); }
+  MutexReaderWriterLatch() = default;
+  ~MutexReaderWriterLatch() { std::lock_guard<mutex_t> guard(mutex_); }
 
-  DISALLOW_COPY(ReaderWriterLatch);
+  DISALLOW_COPY(MutexReaderWriterLatch);
 
   /**
    * Acquire a write latch.
@@ -68,6 +171,19 @@ class ReaderWriterLatch {
     reader_count_++;
   }
 
+  /**
+   * Acquire a read latch if that does not take waiting.
+   * @return true if the latch was acquired
+   */
+  bool TryRLock() {
+    std::lock_guard<mutex_t> guard(mutex_);
+    if (writer_entered_ || reader_count_ == MAX_READERS) {
+      return false;
+    }
+    reader_count_++;
+    return true;
+  }
+
   /**
    * Release a read latch.
    */
@@ -44,6 +44,9 @@ class IndexScanExecutor : public AbstractExecutor {
   bool Next(Tuple *tuple, RID *rid) override;
 
  private:
+  /** Next for plans with a rid batch size: returns the tuples of the current batch, reading the next one as needed. */
+  bool NextInBatch(Tuple *tuple, RID *rid);
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
 
@@ -53,5 +56,9 @@ class IndexScanExecutor : public AbstractExecutor {
   // BPLUSTREE_INDEX_TYPE itr_;
   // BPLUSTREE_INDEX_TYPE itr_end_;
   std::string tbl_name_;
+  /** The rids of the current batch, their tuples, and the position of the next one to return. */
+  std::vector<RID> batch_rids_;
+  std::vector<Tuple> batch_tuples_;
+  size_t batch_pos_{0};
 };
 }  // namespace bustub
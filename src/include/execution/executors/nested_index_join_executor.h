@@ -50,6 +50,9 @@ class NestIndexJoinExecutor : public AbstractExecutor {
   Tuple format_schema(Tuple *tuple, const Schema *original_schema, const Schema *desire_schema);
 
  private:
+  /** Look up the keys of a batch of outer tuples together, and keep the outer and inner tuples that match. */
+  void JoinBatch(const std::vector<Tuple> &outer_tuples, const std::vector<Tuple> &keys);
+
   /** The nested index join plan node. */
   const NestedIndexJoinPlanNode *plan_;
   std::unique_ptr<AbstractExecutor> child_executor_;
@@ -12,13 +12,18 @@
 
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include "catalog/catalog.h"
 #include "execution/expressions/abstract_expression.h"
 #include "execution/plans/abstract_plan.h"
 
 namespace bustub {
 /**
- * IndexScanPlanNode identifies a table that should be scanned with an optional predicate.
+ * IndexScanPlanNode identifies a table that should be scanned with an optional predicate. The scan may be limited to
+ * the keys in [low, high), and may go in decreasing key order. With a rid batch size, the scan reads the rids of that
+ * many keys at a time and fetches their tuples in page order, so that each table page is read once per batch.
  */
 class IndexScanPlanNode : public AbstractPlanNode {
  public:
@@ -28,9 +33,21 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * @param predicate the predicate to scan with, tuples are returned if predicate(tuple) == true or predicate ==
    * nullptr
    * @param table_oid the identifier of table to be scanned
+   * @param low_key the values of the key columns of the lowest key to scan, or none to start at the first key
+   * @param high_key the values of the key columns of the first key past the scan, or none to scan to the last key
+   * @param reverse whether to scan from the high key down
+   * @param rid_batch_size the number of rids to fetch the tuples of together, or 0 to fetch them one at a time
    */
-  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid)
-      : AbstractPlanNode(output, {}), predicate_{predicate}, index_oid_(index_oid) {}
+  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid,
+                    std::vector<Value> low_key = {}, std::vector<Value> high_key = {}, bool reverse = false,
+                    size_t rid_batch_size = 0)
+      : AbstractPlanNode(output, {}),
+        predicate_{predicate},
+        index_oid_(index_oid),
+        low_key_(std::move(low_key)),
+        high_key_(std::move(high_key)),
+        reverse_(reverse),
+        rid_batch_size_(rid_batch_size) {}
 
   PlanType GetType() const override { return PlanType::IndexScan; }
 
@@ -40,11 +57,28 @@ class IndexScanPlanNode : public AbstractPlanNode {
   /** @return the identifier of the table that should be scanned */
   index_oid_t GetIndexOid() const { return index_oid_; }
 
+  /** @return the values of the key columns of the lowest key to scan; empty if the scan starts at the first key */
+  const std::vector<Value> &GetLowKey() const { return low_key_; }
+
+  /** @return the values of the key columns of the first key past the scan; empty if it goes on to the last key */
+  const std::vector<Value> &GetHighKey() const { return high_key_; }
+
+  /** @return whether the scan goes in decreasing key order */
+  bool IsReverse() const { return reverse_; }
+
+  /** @return the number of rids whose tuples are fetched together; 0 if they are fetched one at a time */
+  size_t GetRidBatchSize() const { return rid_batch_size_; }
+
  private:
   /** The predicate that all returned tuples must satisfy. */
   const AbstractExpression *predicate_;
   /** The table whose tuples should be scanned. */
   index_oid_t index_oid_;
+  /** The bounds of the keys to scan; an empty one leaves that end open. */
+  std::vector<Value> low_key_;
+  std::vector<Value> high_key_;
+  bool reverse_;
+  size_t rid_batch_size_;
 };
 
 }  // namespace bustub
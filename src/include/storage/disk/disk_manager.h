@@ -14,13 +14,31 @@
 
 #include <atomic>
 #include <fstream>
+#include <functional>
 #include <future>  // NOLINT
+#include <mutex>   // NOLINT
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 
 namespace bustub {
 
+/**
+ * A page read or write handed to DiskManager::SubmitRequests.
+ */
+struct DiskRequest {
+  DiskRequest(bool is_write, page_id_t page_id, char *data, std::function<void(bool)> callback)
+      : is_write_(is_write), page_id_(page_id), data_(data), callback_(std::move(callback)) {}
+  bool is_write_;
+  page_id_t page_id_;
+  /** PageSizeOf(page_id_) bytes to write from or read into; must stay valid until the callback ran. */
+  char *data_;
+  /** Invoked once the request completed, with true on success. May run on a thread of the disk manager. */
+  std::function<void(bool)> callback_;
+};
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
@@ -33,26 +51,55 @@ class DiskManager {
    */
   explicit DiskManager(const std::string &db_file);
 
-  ~DiskManager() = default;
+  virtual ~DiskManager() { DiskManager::ShutDown(); }
 
   /**
    * Shut down the disk manager and close all the file resources.
    */
-  void ShutDown();
+  virtual void ShutDown();
 
   /**
    * Write a page to the database file.
    * @param page_id id of the page
-   * @param page_data raw page data
+   * @param page_data raw page data, PageSizeOf(page_id) bytes
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data);
 
   /**
    * Read a page from the database file.
    * @param page_id id of the page
-   * @param[out] page_data output buffer
+   * @param[out] page_data output buffer, PageSizeOf(page_id) bytes
+   */
+  virtual void ReadPage(page_id_t page_id, char *page_data);
+
+  /**
+   * Writes a set of pages and makes them durable. The pages are sorted by their position in the file, runs of
+   * adjacent pages are coalesced into one vectored write each, and the file is synced once at the end.
+   * @param[in,out] pages page ids and their raw data; sorted by position on return
+   */
+  void WritePages(std::vector<std::pair<page_id_t, const char *>> *pages);
+
+  /**
+   * Submits a batch of page reads and writes. Requests of one batch may complete in any order; every callback runs
+   * exactly once. This implementation performs the requests one by one before returning, asynchronous backends return
+   * as soon as the batch is queued.
+   * @param requests the requests to perform
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual void SubmitRequests(std::vector<DiskRequest> requests);
+
+  /**
+   * Announces a memory range that page I/O will be performed on (the buffer pool frames), so that a backend can
+   * register it with the kernel once instead of mapping it on every request. No-op by default.
+   * @param data start of the range
+   * @param size length of the range in bytes
+   */
+  virtual void RegisterBuffers(__attribute__((unused)) char *data, __attribute__((unused)) size_t size) {}
+
+  /**
+   * Withdraws a range announced by RegisterBuffers before it is freed. No-op by default.
+   * @param data start of the range
+   */
+  virtual void UnregisterBuffers(__attribute__((unused)) char *data) {}
 
   /**
    * Flush the entire log buffer into disk.
@@ -71,17 +118,32 @@ class DiskManager {
   bool ReadLog(char *log_data, int size, int offset);
 
   /**
-   * Allocate a page on disk.
+   * Allocate a page on disk. Slots freed by DeallocatePage are reused first, lowest slot first; only when there are
+   * not enough adjacent ones the file grows.
+   * @param size_class size of the page
    * @return the id of the allocated page
    */
-  page_id_t AllocatePage();
+  page_id_t AllocatePage(PageSizeClass size_class = PageSizeClass::PAGE_4K);
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk, recording its slots in the free-space map so that AllocatePage can hand them out again.
    * @param page_id id of the page to deallocate
    */
   void DeallocatePage(page_id_t page_id);
 
+  /**
+   * Shrinks the database file by the free pages at its end. Safe to call while pages are allocated and deallocated
+   * concurrently; it gives up if an allocation races with it.
+   * @return the number of pages the file shrank by
+   */
+  size_t TruncateFreePages();
+
+  /** @return the number of free slots in the free-space map */
+  size_t GetNumFreePages() const { return num_free_pages_; }
+
+  /** @return the number of PAGE_SIZE slots the database file currently spans */
+  size_t GetNumDiskPages();
+
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
 
@@ -91,6 +153,12 @@ class DiskManager {
   /** @return the number of disk writes */
   int GetNumWrites() const;
 
+  /** @return the number of write system calls, which is lower than GetNumWrites when WritePages coalesces */
+  int GetNumWriteCalls() const;
+
+  /** @return the number of disk page reads */
+  int GetNumReads() const;
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -100,17 +168,40 @@ class DiskManager {
   /** Checks if the non-blocking flush future was set. */
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
- private:
+ protected:
   int GetFileSize(const std::string &file_name);
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // descriptor of the db file; pread/pwrite carry their own offset, so concurrent page I/O needs no latch
+  int db_fd_{-1};
   std::string file_name_;
+  /** The first slot past every allocated one. */
   std::atomic<page_id_t> next_page_id_;
   int num_flushes_;
-  int num_writes_;
+  std::atomic<int> num_writes_;
+  std::atomic<int> num_write_calls_{0};
+
+  /** Marks slots free or in use and writes their pages of the free-space map through, caller must hold fsm_latch_ */
+  void SetFreeL(page_id_t slot, bool is_free, page_id_t num_slots = 1);
+  /** @return true if the slot is marked free, caller must hold fsm_latch_ */
+  bool IsFreeL(page_id_t slot) const {
+    auto word = static_cast<size_t>(slot) / 64;
+    return word < free_map_.size() && (free_map_[word] >> (slot % 64) & 1) != 0;
+  }
+  /** @return the first slot of a run of n free slots aligned to n, or INVALID_PAGE_ID; caller must hold fsm_latch_ */
+  page_id_t FindFreeSlotsL(page_id_t n) const;
+
+  // free-space map: one bit per slot, set while the slot is free. It is kept in a file of its own next to the
+  // database file, so that it does not take page ids away; every change is written through to it.
+  std::string fsm_name_;
+  int fsm_fd_{-1};
+  std::vector<uint64_t> free_map_;
+  /** Words of free_map_ below this one are all zero. */
+  size_t free_hint_{0};
+  std::atomic<size_t> num_free_pages_{0};
+  std::mutex fsm_latch_;
+  std::atomic<int> num_reads_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
 };
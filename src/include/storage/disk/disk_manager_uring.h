@@ -0,0 +1,161 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_manager_uring.h
+//
+// Identification: src/include/storage/disk/disk_manager_uring.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * DiskManagerUring is a DiskManager whose batched page I/O goes through an io_uring instance.
+ *
+ * SubmitRequests queues a whole batch with a single io_uring_enter and returns; a completion thread reaps the
+ * completions and runs the callbacks. Page buffers that lie in a range announced through RegisterBuffers (the buffer
+ * pool frames) are registered with the ring and use the fixed-buffer opcodes, which saves pinning and mapping the
+ * user pages on every request. With direct I/O, page buffers aligned to DIRECT_IO_ALIGNMENT bypass the page cache
+ * through a second, O_DIRECT descriptor of the database file; others go through the buffered descriptor.
+ *
+ * If the kernel refuses to set up a ring (io_uring disabled, seccomp filters, pre-5.6 kernels), every request falls
+ * back to the synchronous pread/pwrite path of DiskManager.
+ */
+class DiskManagerUring : public DiskManager {
+ public:
+  /**
+   * Creates a new io_uring disk manager that writes to the specified database file.
+   * @param db_file the file name of the database file to write to
+   * @param direct_io true to bypass the page cache for aligned page buffers
+   * @param queue_depth number of submission queue entries of the ring
+   */
+  explicit DiskManagerUring(const std::string &db_file, bool direct_io = true,
+                            unsigned queue_depth = DISK_URING_QUEUE_DEPTH);
+
+  ~DiskManagerUring() override { DiskManagerUring::ShutDown(); }
+
+  /**
+   * Waits for the requests in flight, tears the ring down and closes all the file resources.
+   */
+  void ShutDown() override;
+
+  /**
+   * Write a page to the database file, through the O_DIRECT descriptor if the buffer allows it.
+   * @param page_id id of the page
+   * @param page_data raw page data
+   */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /**
+   * Read a page from the database file, through the O_DIRECT descriptor if the buffer allows it.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer
+   */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /**
+   * Queues a batch of page reads and writes on the ring and returns; callbacks run on the completion thread.
+   * Blocks while the ring has as many requests in flight as its completion queue can hold, so callbacks must not
+   * submit requests themselves.
+   * @param requests the requests to perform
+   */
+  void SubmitRequests(std::vector<DiskRequest> requests) override;
+
+  /**
+   * Registers [data, data + size) with the ring as a fixed buffer.
+   * @param data start of the range
+   * @param size length of the range in bytes
+   */
+  void RegisterBuffers(char *data, size_t size) override;
+
+  /**
+   * Unregisters the range starting at data.
+   * @param data start of the range
+   */
+  void UnregisterBuffers(char *data) override;
+
+  /** @return true if requests go through io_uring, false if the ring could not be set up */
+  bool IsUsingUring() const { return ring_fd_ >= 0; }
+
+  /** @return true if aligned page buffers bypass the page cache */
+  bool IsUsingDirectIO() const { return direct_fd_ >= 0; }
+
+ private:
+  /** A request handed to the kernel; its address is the user_data of its submission queue entry. */
+  struct InFlightRequest {
+    explicit InFlightRequest(DiskRequest request) : request_(std::move(request)) {}
+    DiskRequest request_;
+  };
+
+  /** Sets up the ring and maps its queues; leaves ring_fd_ at -1 on failure. */
+  void SetUpRing(unsigned queue_depth);
+
+  /** Registers buffers_ with the ring, caller must hold sq_latch_ with nothing in flight. */
+  void UpdateRegisteredBuffersL();
+
+  /** @return the descriptor to use for a page buffer */
+  int FileFor(const char *page_data) const {
+    return direct_fd_ >= 0 && reinterpret_cast<uintptr_t>(page_data) % DIRECT_IO_ALIGNMENT == 0 ? direct_fd_ : db_fd_;
+  }
+
+  /** Reaps completions and runs their callbacks until shut down. */
+  void RunCompletionThread();
+
+  /** Descriptor of the database file opened with O_DIRECT, -1 without direct I/O. */
+  int direct_fd_{-1};
+  /** Descriptor of the ring, -1 if there is none. */
+  int ring_fd_{-1};
+
+  /** Mapped submission queue ring, completion queue ring (possibly the same mapping) and submission queue entries. */
+  void *sq_ring_{nullptr};
+  void *cq_ring_{nullptr};
+  io_uring_sqe *sqes_{nullptr};
+  size_t sq_ring_size_{0};
+  size_t cq_ring_size_{0};
+  size_t sqes_size_{0};
+
+  /** Pointers into the mapped rings. */
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_mask_{nullptr};
+  unsigned *sq_array_{nullptr};
+  unsigned sq_entries_{0};
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned *cq_mask_{nullptr};
+  io_uring_cqe *cqes_{nullptr};
+  unsigned cq_entries_{0};
+
+  /** Ranges announced through RegisterBuffers, in the order of their fixed buffer indexes. */
+  std::vector<std::pair<char *, size_t>> buffers_;
+  /** True if buffers_ is registered with the ring. */
+  bool buffers_registered_{false};
+
+  /** Serializes submissions and buffer registration, and guards in_flight_. */
+  std::mutex sq_latch_;
+  /** Signalled whenever a request completes. */
+  std::condition_variable sq_cv_;
+  /** Requests submitted but not yet reaped. */
+  size_t in_flight_{0};
+
+  /** Reaps completions; nullptr without a ring. */
+  std::thread *completion_thread_{nullptr};
+};
+
+}  // namespace bustub
@@ -10,9 +10,12 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <mutex>  // NOLINT
 #include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "concurrency/transaction.h"
@@ -24,6 +27,9 @@ namespace bustub {
 
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
 
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTreeBuilder;
+
 /**
  * Main class providing the API for the Interactive B+ Tree.
  *
@@ -33,6 +39,15 @@ namespace bustub {
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * Writers follow the latch protocol btree_latch_protocol names when the tree is created. Pages link to their right
+ * sibling and record its lowest key, their high key, in either protocol; B-link descents that land on a page whose
+ * high key is not above the search key move right to the page that took the key in a split.
+ *
+ * The pages of a tree with the COMPRESSED layout store the keys of a page without their common prefix and without the
+ * zero bytes past key_size, and are sized by their bytes instead of the max sizes given. A page that has no room for
+ * a key that needs wider entries splits before it takes the key. Merging or rebalancing pages may leave a parent
+ * without room for a new separator; the pages then stay less than half full, which lookups do not mind.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -41,7 +56,15 @@ class BPlusTree {
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     PageSizeClass page_size_class = PageSizeClass::PAGE_4K,
+                     BTreePageLayout page_layout = BTreePageLayout::PLAIN, int key_size = sizeof(KeyType));
+
+  // Create a B+ tree whose nodes are pages of the given size class, filled to capacity. Keys of a tree with the
+  // COMPRESSED layout must not have a nonzero byte past key_size.
+  BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+            PageSizeClass page_size_class, BTreePageLayout page_layout = BTreePageLayout::PLAIN,
+            int key_size = sizeof(KeyType));
 
   void Print();
 
@@ -57,10 +80,24 @@ class BPlusTree {
   // return the value associated with a given key
   bool GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr);
 
+  // Look up many keys at once: the value of keys[i], if it is in the tree, is added to (*results)[i]; returns the
+  // number of keys found. Keys in increasing order share descents: those on the leaf of the key before them are looked
+  // up there, and the others are found from the lowest page of the last descent that holds them rather than from the
+  // root. Keys may come in any order.
+  size_t GetValues(const std::vector<KeyType> &keys, std::vector<std::vector<ValueType>> *results,
+                   Transaction *transaction = nullptr);
+
+  // Number of inserts and removes done with an optimistic descent, and number that had to restart pessimistically.
+  uint64_t GetOptimisticWrites() const { return optimistic_writes_; }
+  uint64_t GetWriteRestarts() const { return write_restarts_; }
+
   // index iterator
   INDEXITERATOR_TYPE begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
   INDEXITERATOR_TYPE end();
+  // Iterate over the keys in [low, high), in increasing order or, if reverse, in decreasing order; a null bound leaves
+  // that end open. The iterator ends at the bound without reading the leaves past it.
+  INDEXITERATOR_TYPE Range(const KeyType *low, const KeyType *high, bool reverse = false);
 
   void Print(BufferPoolManager *bpm) {
     ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(root_page_id_)->GetData()), bpm);
@@ -80,46 +117,79 @@ class BPlusTree {
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
   // expose for test purpose
-  Page *FindLeafPage(const KeyType &key, bool leftMost = false);
-  Page *READ_FindLeafPage(const KeyType &key, bool leftMost = false, Transaction *transaction = nullptr);
-  Page *WRITE_FindLeafPage(const KeyType &key, const ValueType &value, bool leftMost, WType op,
-                           Transaction *transaction);
+  BasicPageGuard FindLeafPage(const KeyType &key, bool leftMost = false);
+  ReadPageGuard READ_FindLeafPage(const KeyType &key, bool leftMost = false, Transaction *transaction = nullptr);
+  ReadPageGuard READ_FindLeafPageBefore(const KeyType *key, int *index);
 
  private:
+  // builds the tree bottom-up from its own pages, then publishes the root
+  friend class BPlusTreeBuilder<KeyType, ValueType, KeyComparator>;
+  // bounded and reverse iterators compare keys with the tree's comparator, and reverse ones descend it again
+  friend class IndexIterator<KeyType, ValueType, KeyComparator>;
+
+  // optimistic descents that run into writers this often in a row fall back to latch crabbing
+  static constexpr int OPTIMISTIC_READ_ATTEMPTS = 8;
+
+  /** Latches an insert or remove holds from its descent until it is done with the tree. */
+  struct Context {
+    /** The virtual root latch mu_, held while the root page may still change. */
+    std::unique_lock<std::mutex> root_lock_;
+    /** Write latched pages, from the topmost ancestor the operation may still change down to the current page. */
+    std::deque<WritePageGuard> write_set_;
+    /** Pages emptied by merges, deleted once their latches are released. */
+    std::vector<page_id_t> deleted_pages_;
+  };
+
   // self
-  Page *fetch_page(page_id_t pid);
-  Page *new_page(page_id_t *pid);
-  Page *new_rootL(bool new_tree);
-  Page *get_sibling(int index, InternalPage *parent_node);
-  bool isSafe(WType op, BPlusTreePage *node);
-  void free_ancestor(Transaction *transaction, bool ancestor_dirty);
-  void release_N_unPin(page_id_t pid, Page *page, Transaction *transaction, bool dirty);
-  void lock();
-  void unlock();
-  void check_txns(Transaction *transaction);
-  void check_parent(BPlusTreePage *node, Transaction *transaction);
-  bool is_pid_in_txns(Transaction *transaction, page_id_t pid);
+  BasicPageGuard fetch_page(page_id_t pid);
+  BasicPageGuard new_page(page_id_t *pid);
+  WritePageGuard new_rootL(bool new_tree);
+  bool OPTIMISTIC_FindLeafPage(const KeyType &key, bool leftMost, BasicPageGuard *leaf, uint64_t *version);
+  bool OPTIMISTIC_FindLeafPage(const KeyType &key, std::vector<std::pair<BasicPageGuard, uint64_t>> *path,
+                               BasicPageGuard *leaf, uint64_t *version);
+  WritePageGuard OPTIMISTIC_WRITE_FindLeafPage(const KeyType &key);
+  bool WRITE_FindLeafPage(const KeyType &key, const ValueType &value, bool leftMost, WType op, Context *ctx);
+  page_id_t BLINK_FindLeafPage(const KeyType &key, bool leftMost, std::vector<page_id_t> *path);
+  void BLINK_FindPath(const KeyType &key, page_id_t root_page_id, int root_level, int level,
+                      std::vector<page_id_t> *path);
+  template <typename N>
+  bool BLINK_MoveRight(const N *node, const KeyType &key) const;
+  WritePageGuard &get_parent(const BPlusTreePage *node, Context *ctx);
+  bool isSafe(WType op, const BPlusTreePage *node, const KeyType &key);
+  void free_ancestor(Context *ctx);
+  void release(Context *ctx);
   // self
 
   void StartNewTree(const KeyType &key, const ValueType &value);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
 
-  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                        Transaction *transaction = nullptr);
+  BasicPageGuard InsertIntoPage(LeafPage *leaf, const KeyType &key, const ValueType &value, KeyType *partition_key);
+
+  BasicPageGuard InsertIntoPage(InternalPage *node, page_id_t old_value, const KeyType &key, page_id_t new_value,
+                                KeyType *partition_key);
+
+  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node, Context *ctx);
+
+  bool BLINK_Insert(const KeyType &key, const ValueType &value);
+
+  void BLINK_InsertIntoParent(WritePageGuard child_guard, KeyType key, page_id_t new_page_id,
+                              std::vector<page_id_t> *path);
+
+  void BLINK_Remove(const KeyType &key);
 
   template <typename N>
-  N *Split(N *node);
+  BasicPageGuard Split(N *node);
 
   template <typename N>
-  bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
+  bool CoalesceOrRedistribute(N *node, Context *ctx);
 
   template <typename N>
   bool Coalesce(N *neighbor_node, N *node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent, int index,
-                Transaction *transaction = nullptr);
+                Context *ctx);
 
   template <typename N>
-  void Redistribute(N *neighbor_node, N *node, int index);
+  void Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index);
 
   bool AdjustRoot(BPlusTreePage *node);
 
@@ -132,14 +202,25 @@ class BPlusTree {
 
   // member variable
   std::string index_name_;
-  page_id_t root_page_id_;
+  // written under mu_, read without it by optimistic descents
+  std::atomic<page_id_t> root_page_id_;
+  // levels between the root and the leaves, written and read under mu_
+  int root_level_{0};
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  // size of the tree's nodes; the header page that records the root is always a PAGE_4K page
+  PageSizeClass page_size_class_;
+  // bytes of the keys that may be nonzero if the pages are compressed, 0 if they are not
+  int key_size_;
+  const BTreeLatchProtocol latch_protocol_;
 
   // virtual root - used as lock
   std::mutex mu_;
+
+  std::atomic<uint64_t> optimistic_writes_{0};
+  std::atomic<uint64_t> write_restarts_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/include/index/b_plus_tree_builder.h
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/index/b_plus_tree.h"
+
+namespace bustub {
+
+#define BPLUSTREE_BUILDER_TYPE BPlusTreeBuilder<KeyType, ValueType, KeyComparator>
+
+/**
+ * Bulk loader that builds a B+ tree bottom-up instead of inserting its entries one by one.
+ *
+ * Entries are added in any order. They are sorted in memory, and once more of them have been added than fit in the
+ * sort buffer, the sorted runs are spilled to temporary files and merged at the end. The sorted entries are then
+ * packed into leaves filled to the fill factor, left to right, and each level of internal pages is filled in the same
+ * pass: every page is written once, there are no splits, and only the rightmost page of each level is pinned at a
+ * time. Of several entries with the same key the one added first is kept, as inserting them one by one would.
+ *
+ * The tree must be empty and must not be used until Finish returns.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTreeBuilder {
+  using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
+ public:
+  /** Memory used by default to sort entries before they are spilled to disk. */
+  static constexpr size_t DEFAULT_SORT_BUFFER_SIZE = 64 << 20;
+
+  /**
+   * @param tree the empty tree to build
+   * @param fill_factor fraction of each node's capacity to fill, kept between half full and full
+   * @param sort_buffer_size bytes of entries sorted in memory at a time
+   */
+  explicit BPlusTreeBuilder(BPlusTree<KeyType, ValueType, KeyComparator> *tree,
+                            double fill_factor = btree_bulk_load_fill_factor,
+                            size_t sort_buffer_size = DEFAULT_SORT_BUFFER_SIZE);
+  ~BPlusTreeBuilder();
+
+  DISALLOW_COPY(BPlusTreeBuilder);
+
+  // Add an entry to load.
+  void Add(const KeyType &key, const ValueType &value);
+
+  // Sort the entries, build the tree from them and publish its root. Returns the number of entries loaded.
+  size_t Finish();
+
+  // Number of sorted runs spilled to disk so far.
+  size_t GetNumRuns() const { return runs_.size(); }
+
+ private:
+  /** A sorted run of entries in a temporary file, read back a block at a time while the runs are merged. */
+  struct Run {
+    FILE *file_;
+    std::vector<MappingType> block_;
+    size_t pos_{0};
+  };
+
+  /** The rightmost page of a level of the tree under construction. */
+  struct Level {
+    BasicPageGuard node_;
+    /** The page left of node_, or INVALID_PAGE_ID if node_ is the first page of the level. */
+    page_id_t prev_page_id_{INVALID_PAGE_ID};
+  };
+
+  void SortBuffer();
+  void SpillRun();
+  bool ReadBlock(Run *run, size_t block_size);
+
+  // Append the next entry in key order to the tree; entries with the key of the one before are dropped.
+  void Emit(const MappingType &item);
+
+  // Start a new rightmost page at the given level whose subtree begins at first_key, and link it into the level above.
+  void OpenNode(size_t level, const KeyType &first_key);
+
+  // Add child as the last child of the rightmost page at the given level; returns the page that now holds it.
+  page_id_t AddChild(size_t level, const KeyType &key, page_id_t child);
+
+  // Level and index of the key that separates the rightmost page of the given level from its left neighbour.
+  std::pair<size_t, int> SeparatorOf(size_t level);
+
+  // Merge or rebalance the rightmost page of each level with its left neighbour if it was left less than half full,
+  // and drop roots with a single child.
+  void FixRightEdge();
+
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_;
+  KeyComparator comparator_;
+  double fill_factor_;
+  size_t buffer_capacity_;
+  std::vector<MappingType> buffer_;
+  std::vector<Run> runs_;
+
+  std::vector<Level> levels_;
+  KeyType last_key_;
+  size_t num_loaded_{0};
+};
+
+}  // namespace bustub
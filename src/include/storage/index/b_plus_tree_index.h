@@ -16,6 +16,7 @@
 #include <vector>
 
 #include "storage/index/b_plus_tree.h"
+#include "storage/index/b_plus_tree_builder.h"
 #include "storage/index/index.h"
 
 namespace bustub {
@@ -25,7 +26,12 @@ namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager);
+  // The index keeps NORMALIZED keys, built from key tuples by SetFromKey with the key schema, which compare with memcmp.
+  // A COMPRESSED index stores the keys of a node without their common prefix; its key size is the length of the key
+  // schema if all of its columns are inlined.
+  BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager,
+                 PageSizeClass page_size_class = PageSizeClass::PAGE_4K,
+                 BTreePageLayout page_layout = BTreePageLayout::PLAIN);
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
   void v_InsertEntry(const Tuple &key, RID rid, Transaction *transaction);
@@ -36,12 +42,23 @@ class BPlusTreeIndex : public Index {
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
   void v_ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction);
 
+  // Look the keys up in key order, so that keys close together share their descents; see BPlusTree::GetValues.
+  void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                Transaction *transaction) override;
+
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
 
   INDEXITERATOR_TYPE GetEndIterator();
 
+  // Iterate over the entries whose keys, tuples of the key schema, are in [low, high), in key order or, if reverse, in
+  // reverse key order; a null bound leaves that end open. Scans compare with GetEndIterator when they are done.
+  INDEXITERATOR_TYPE GetRangeIterator(const Tuple *low, const Tuple *high, bool reverse = false);
+
+  // Bulk load the index, which must be empty: add the entries to the builder, then call its Finish.
+  BPlusTreeBuilder<KeyType, ValueType, KeyComparator> GetBuilder(double fill_factor = btree_bulk_load_fill_factor);
+
  protected:
   // comparator for key
   KeyComparator comparator_;
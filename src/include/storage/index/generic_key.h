@@ -12,13 +12,23 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstring>
 
+#include "common/config.h"
+#include "common/exception.h"
 #include "storage/table/tuple.h"
+#include "type/limits.h"
 #include "type/value.h"
 
 namespace bustub {
 
+/**
+ * How the bytes of a GenericKey hold its columns. TUPLE keys are a key tuple, compared column by column as Values;
+ * NORMALIZED keys are encoded so that they sort as their bytes do, and are compared with memcmp.
+ */
+enum class KeyEncoding { TUPLE, NORMALIZED };
+
 /**
  * Generic key is used for indexing with opaque data.
  *
@@ -35,6 +45,79 @@ class GenericKey {
     memcpy(data_, tuple.GetData(), tuple.GetLength());
   }
 
+  /**
+   * Set the key to the NORMALIZED encoding of a tuple of key_schema. Each column in turn is stored so that the bytes
+   * sort as the values do, and nulls as all zero bytes, before any value:
+   * integers and booleans big-endian with the sign bit flipped; decimals big-endian with the sign bit flipped if they
+   * are positive and all bits flipped if they are negative; varchars as their bytes, with each zero byte followed by
+   * 0xFF, and then 0x00 0x01 (a null varchar is 0x00 0x00).
+   * Encodings longer than the key are cut off, so that keys which only differ past KeySize compare equal.
+   */
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
+    memset(data_, 0, KeySize);
+    size_t size = 0;
+    auto put = [&](uint8_t byte) {
+      if (size < KeySize) {
+        data_[size++] = static_cast<char>(byte);
+      }
+    };
+    auto put_bits = [&](uint64_t bits, int width) {
+      for (int i = width - 1; i >= 0; i--) {
+        put(static_cast<uint8_t>(bits >> (8 * i)));
+      }
+    };
+    for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+      const Value value = tuple.GetValue(key_schema, i);
+      const TypeId type = key_schema->GetColumn(i).GetType();
+      if (type == TypeId::VARCHAR) {
+        if (!value.IsNull()) {
+          // the length counts a terminating zero, which comparisons leave out
+          const char *data = value.GetData();
+          for (uint32_t j = 0; j + 1 < value.GetLength(); j++) {
+            put(static_cast<uint8_t>(data[j]));
+            if (data[j] == 0) {
+              put(0xFF);
+            }
+          }
+        }
+        put(0x00);
+        put(value.IsNull() ? 0x00 : 0x01);
+        continue;
+      }
+      const int width = key_schema->GetColumn(i).GetFixedLength();
+      if (value.IsNull()) {
+        put_bits(0, width);
+        continue;
+      }
+      const uint64_t sign_bit = uint64_t{1} << (8 * width - 1);
+      switch (type) {
+        case TypeId::BOOLEAN:
+        case TypeId::TINYINT:
+          put_bits(static_cast<uint64_t>(value.GetAs<int8_t>()) ^ sign_bit, width);
+          break;
+        case TypeId::SMALLINT:
+          put_bits(static_cast<uint64_t>(value.GetAs<int16_t>()) ^ sign_bit, width);
+          break;
+        case TypeId::INTEGER:
+          put_bits(static_cast<uint64_t>(value.GetAs<int32_t>()) ^ sign_bit, width);
+          break;
+        case TypeId::BIGINT:
+          put_bits(static_cast<uint64_t>(value.GetAs<int64_t>()) ^ sign_bit, width);
+          break;
+        case TypeId::DECIMAL: {
+          // -0.0 equals 0.0
+          double decimal = value.GetAs<double>() == 0 ? 0.0 : value.GetAs<double>();
+          uint64_t bits;
+          memcpy(&bits, &decimal, sizeof(bits));
+          put_bits((bits & sign_bit) != 0 ? ~bits : bits ^ sign_bit, width);
+          break;
+        }
+        default:
+          throw Exception(ExceptionType::NOT_IMPLEMENTED, "key columns of this type cannot be normalized");
+      }
+    }
+  }
+
   // NOTE: for test purpose only
   inline void SetFromInteger(int64_t key) {
     memset(data_, 0, KeySize);
@@ -71,12 +154,19 @@ class GenericKey {
 };
 
 /**
- * Function object returns true if lhs < rhs, used for trees
+ * Function object returns true if lhs < rhs, used for trees. It compares keys of the encoding it is created with.
  */
 template <size_t KeySize>
 class GenericComparator {
  public:
+  /** What ComparePrefixes returns if the prefixes of two keys do not decide how the keys compare. */
+  static constexpr int PREFIX_TIE = 2;
+
   inline int operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const {
+    if (encoding_ == KeyEncoding::NORMALIZED) {
+      int cmp = memcmp(lhs.data_, rhs.data_, KeySize);
+      return cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+    }
     uint32_t column_count = key_schema_->GetColumnCount();
 
     for (uint32_t i = 0; i < column_count; i++) {
@@ -94,13 +184,93 @@ class GenericComparator {
     return 0;
   }
 
-  GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
+  /**
+   * Prefix of a key that sorts like the key: its first column, if that is an integer, with the sign bit flipped so
+   * that it sorts as unsigned. Keys without such a column, and keys whose first column is null, have prefix 0.
+   * The prefix of a NORMALIZED key is its first 8 bytes, big-endian.
+   */
+  inline uint64_t KeyPrefix(const GenericKey<KeySize> &key) const {
+    if (normalized_prefix_) {
+      uint64_t prefix = 0;
+      for (size_t i = 0; i < NORMALIZED_PREFIX_SIZE; i++) {
+        prefix = prefix << 8 | static_cast<uint8_t>(key.data_[i]);
+      }
+      return prefix;
+    }
+    const char *data = key.data_ + prefix_offset_;
+    switch (prefix_type_) {
+      case TypeId::TINYINT:
+        return NormalizedPrefix<int8_t>(data, BUSTUB_INT8_NULL);
+      case TypeId::SMALLINT:
+        return NormalizedPrefix<int16_t>(data, BUSTUB_INT16_NULL);
+      case TypeId::INTEGER:
+        return NormalizedPrefix<int32_t>(data, BUSTUB_INT32_NULL);
+      case TypeId::BIGINT:
+        return NormalizedPrefix<int64_t>(data, BUSTUB_INT64_NULL);
+      default:
+        return 0;
+    }
+  }
+
+  /**
+   * Compare two keys by their prefixes: -1, 0 or 1 if the prefixes decide, which takes two nonzero prefixes that
+   * differ or, if the first column is the whole key, are equal; PREFIX_TIE if the keys have to be compared.
+   */
+  inline int ComparePrefixes(uint64_t lhs, uint64_t rhs) const {
+    if (lhs == 0 || rhs == 0 || (lhs == rhs && !prefix_is_key_)) {
+      return PREFIX_TIE;
+    }
+    return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+  }
+
+  GenericComparator(const GenericComparator &other)
+      : key_schema_{other.key_schema_},
+        encoding_{other.encoding_},
+        normalized_prefix_{other.normalized_prefix_},
+        prefix_type_{other.prefix_type_},
+        prefix_offset_{other.prefix_offset_},
+        prefix_is_key_{other.prefix_is_key_} {}
 
   // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  explicit GenericComparator(Schema *key_schema, KeyEncoding encoding = KeyEncoding::TUPLE)
+      : key_schema_(key_schema), encoding_(encoding) {
+    if (!btree_key_prefix_search || key_schema->GetColumnCount() == 0) {
+      return;
+    }
+    if (encoding == KeyEncoding::NORMALIZED) {
+      normalized_prefix_ = true;
+      prefix_is_key_ = KeySize <= NORMALIZED_PREFIX_SIZE;
+      return;
+    }
+    const auto &col = key_schema->GetColumn(0);
+    if (col.IsInlined() && col.GetOffset() + col.GetFixedLength() <= KeySize) {
+      prefix_type_ = col.GetType();
+      prefix_offset_ = col.GetOffset();
+      prefix_is_key_ = key_schema->GetColumnCount() == 1;
+    }
+  }
 
  private:
+  static constexpr size_t NORMALIZED_PREFIX_SIZE = KeySize < 8 ? KeySize : 8;
+
+  template <typename T>
+  static inline uint64_t NormalizedPrefix(const char *data, T null_value) {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    if (value == null_value) {
+      return 0;
+    }
+    return static_cast<uint64_t>(static_cast<int64_t>(value)) ^ (uint64_t{1} << 63);
+  }
+
   Schema *key_schema_;
+  KeyEncoding encoding_;
+  // whether KeyPrefix reads the first bytes of NORMALIZED keys
+  bool normalized_prefix_{false};
+  // type and offset of the first column if it is inlined, so that KeyPrefix can read it
+  TypeId prefix_type_{TypeId::INVALID};
+  uint32_t prefix_offset_{0};
+  bool prefix_is_key_{false};
 };
 
 }  // namespace bustub
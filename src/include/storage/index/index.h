@@ -137,6 +137,16 @@ class Index {
 
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  // look up a batch of keys: the rids of keys[i] are added to (*results)[i]; indexes that can share work between the
+  // lookups override the one by one default
+  virtual void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                        Transaction *transaction) {
+    results->resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      ScanKey(keys[i], &(*results)[i], transaction);
+    }
+  }
+
  private:
   //===--------------------------------------------------------------------===//
   //  Data members
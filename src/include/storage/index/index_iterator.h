@@ -14,67 +14,74 @@
  */
 #pragma once
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTree;
+
+/**
+ * Iterates over the entries of a B+ tree from a leaf on. An iterator may end before the last entry at a bound, the
+ * first key it does not reach, and may go in decreasing key order, in which case the bound is the lowest key it
+ * reaches. Leaves link only to their right sibling, so a reverse iterator finds the leaf before its own with another
+ * descent, for the greatest key below the first key of its leaf.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
  public:
   // you may define your own constructor based on your member variables
   IndexIterator();
-  IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf_, BufferPoolManager *bpm, int index);
+  IndexIterator(ReadPageGuard leaf_guard, BufferPoolManager *bpm, int index);
+  // an iterator of tree that ends at bound unless it is null, and goes backwards if reverse
+  IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, ReadPageGuard leaf_guard, int index,
+                const KeyType *bound, bool reverse);
   ~IndexIterator();
 
+  // the iterator owns the latch and pin of its leaf, so it can be moved but not copied
+  IndexIterator(IndexIterator &&that) noexcept = default;
+  IndexIterator &operator=(IndexIterator &&that) noexcept = default;
+
   bool isEnd();
 
   const MappingType &operator*();
 
   IndexIterator &operator++();
 
-  IndexIterator &operator=(const IndexIterator &other) {
-    leaf_ = other.leaf_;
-    buffer_pool_manager_ = other.buffer_pool_manager_;
-    index_ = other.index_;
-
-    if (leaf_ != nullptr) {
-      buffer_pool_manager_->FetchPage(leaf_->GetPageId())->RLatch();
-    }
-    return *this;
-  }
-
   bool operator==(const IndexIterator &itr) const {
-    if (itr.leaf_ == nullptr && leaf_ == nullptr) {
-      return true;
-    }
-    if (itr.leaf_ == nullptr) {
-      return false;
-    }
-    if (leaf_ == nullptr) {
-      return false;
+    if (itr.leaf_ == nullptr || leaf_ == nullptr) {
+      return itr.leaf_ == leaf_;
     }
     return ((leaf_->GetPageId() == (itr.leaf_)->GetPageId()) && (index_ == itr.index_));
   }
 
-  bool operator!=(const IndexIterator &itr) const {
-    if (itr.leaf_ == nullptr && leaf_ == nullptr) {
-      return false;
-    }
-    if (itr.leaf_ == nullptr) {
-      return true;
-    }
-    if (leaf_ == nullptr) {
-      return true;
-    }
-    return ((leaf_->GetPageId() != (itr.leaf_)->GetPageId()) || (index_ != itr.index_));
-  }
+  bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
+  /**
+   * Sets stop_ for the leaf and, unless index_ is within it, moves on to the next leaf with entries within the bound,
+   * or the previous one if the iterator is reverse, or to the end.
+   */
+  void Seek();
+  void SetEnd();
+
   // add your own private member variables here
-  B_PLUS_TREE_LEAF_PAGE_TYPE *leaf_{nullptr};
+  /** The leaf the iterator is on, read latched; invalid at the end. */
+  ReadPageGuard leaf_guard_;
+  const B_PLUS_TREE_LEAF_PAGE_TYPE *leaf_{nullptr};
   BufferPoolManager *buffer_pool_manager_{nullptr};
   int index_{-1};
+  /** The tree of a bounded or reverse iterator, whose comparator it compares keys with. */
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_{nullptr};
+  KeyType bound_{};
+  bool bounded_{false};
+  bool reverse_{false};
+  /** The index past the last entry of the leaf the iterator reaches, or the first if it is reverse. */
+  int stop_{0};
+  /** The entry last dereferenced, decoded from the leaf, which may not store its key whole. */
+  MappingType item_;
 };
 
 }  // namespace bustub
@@ -10,15 +10,20 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <cstdint>
 #include <queue>
+#include <utility>
+#include <vector>
 
 #include "storage/page/b_plus_tree_page.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_INTERNAL_PAGE_TYPE BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>
-#define INTERNAL_PAGE_HEADER_SIZE 24
-#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(MappingType)))
+#define INTERNAL_PAGE_HEADER_SIZE 32
+#define INTERNAL_PAGE_SIZE_OF(page_size) \
+  (((page_size)-INTERNAL_PAGE_HEADER_SIZE - sizeof(KeyType)) / (sizeof(MappingType)))
+#define INTERNAL_PAGE_SIZE INTERNAL_PAGE_SIZE_OF(PAGE_SIZE)
 /**
  * Store n indexed keys and n+1 child pointers (page_id) within internal page.
  * Pointer PAGE_ID(i) points to a subtree in which all keys K satisfy:
@@ -28,24 +33,52 @@ namespace bustub {
  * should ignore the first key.
  *
  * Internal page format (keys are stored in increasing order):
- *  --------------------------------------------------------------------------
- * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
- *  --------------------------------------------------------------------------
+ *  ----------------------------------------------------------------------------------------------
+ * | HEADER | HIGH KEY | PREFIX | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
+ *  ----------------------------------------------------------------------------------------------
+ *
+ * The header is that of BPlusTreePage followed by NextPageId (4), KeySize (1), PrefixSize (1), KeyEnd (1) and an
+ * unused byte, 32 bytes in total. As in leaf pages, the next page is the right sibling on the same level and the high
+ * key is the lowest key that belongs to it; the rightmost page of a level has no sibling and no high key.
+ *
+ * Keys are stored as in leaf pages, whole or compressed. The layout of a compressed page covers all keys but the
+ * first; the first key is only kept after a split, for the tree to read right away, and is lost when the layout
+ * widens. Separators are keys of the level below, so they are only as long as those keys need: their trailing zero
+ * bytes are not stored.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
  public:
-  // must call initialize method after "create" a new node
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE);
+  // must call initialize method after "create" a new node; a key size compresses the page
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE,
+            int key_size = 0);
 
   KeyType KeyAt(int index) const;
   void SetKeyAt(int index, const KeyType &key);
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+  KeyType GetHighKey() const;
+  void SetHighKey(const KeyType &high_key);
   int ValueIndex(const ValueType &value) const;
   ValueType ValueAt(int index) const;
+  int GetKeySize() const;
+
+  // Whether key can be inserted without splitting the page first, the max size of the page once it holds key, and
+  // the least max size it can have once it holds any one key more; see BPlusTreeLeafPage.
+  bool HasRoomFor(const KeyType &key) const;
+  int GetMaxSizeFor(const KeyType &key) const;
+  int GetMaxSizeForAnyKey() const;
+  // Whether right, the page after this one, fits into this page together with the key that separates them; and
+  // whether the key at index can be changed to key.
+  bool CanMerge(const BPlusTreeInternalPage *right, const KeyType &middle_key) const;
+  bool CanSetKeyAt(int index, const KeyType &key) const;
 
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
+  // index of the child whose subtree holds the greatest keys less than key
+  int LookupBefore(const KeyType &key, const KeyComparator &comparator) const;
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
   int InsertNodeAfter(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
+  void Append(const KeyType &new_key, const ValueType &new_value);
   void Remove(int index);
   ValueType RemoveAndReturnOnlyChild();
 
@@ -58,9 +91,48 @@ class BPlusTreeInternalPage : public BPlusTreePage {
                          BufferPoolManager *buffer_pool_manager);
 
  private:
-  void CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
+  static_assert(sizeof(KeyType) <= UINT8_MAX, "key sizes are stored in a byte");
+
+  /** The entries of the page as of one read of its layout; see BPlusTreeLeafPage. */
+  struct Entries {
+    const char *prefix_;
+    const char *slots_;
+    int prefix_size_;
+    int key_end_;
+    int slot_size_;
+    int size_;
+
+    // the key is decoded into buf, unless the page stores it whole
+    const KeyType &KeyAt(int index, KeyType *buf) const;
+    ValueType ValueAt(int index) const;
+    // compare the key at index with key, whose comparator prefix is key_prefix
+    int CompareAt(int index, const KeyType &key, uint64_t key_prefix, const KeyComparator &comparator) const;
+    // index of the first key after the first that is greater than key, or size_ if there is none
+    int UpperBound(const KeyType &key, const KeyComparator &comparator) const;
+    // index of the first key after the first that is not less than key, or size_ if there is none
+    int LowerBound(const KeyType &key, const KeyComparator &comparator) const;
+  };
+
+  Entries GetEntries() const;
+  int DataSize() const;
+  char *SlotAt(int index);
+  void WriteEntry(int index, const KeyType &key, const ValueType &value);
+  void InsertAt(int index, const KeyType &key, const ValueType &value);
+  void RemoveAt(int index);
+  void WidenFor(const KeyType &key, int *prefix_size, int *key_end) const;
+  void LayoutOf(const std::vector<MappingType> &items, bool with_first_key, int *prefix_size, int *key_end) const;
+  void Decode(std::vector<MappingType> *items) const;
+  void Encode(const std::vector<MappingType> &items, bool with_first_key = false);
+  void Encode(const std::vector<MappingType> &items, int prefix_size, int key_end, const char *prefix);
+  void CopyNFrom(const std::vector<MappingType> &items, BufferPoolManager *buffer_pool_manager);
   void CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
-  MappingType array[0];
+  page_id_t next_page_id_;
+  uint8_t key_size_;
+  uint8_t prefix_size_;
+  uint8_t key_end_;
+  uint8_t unused_;
+  KeyType high_key_;
+  char data_[0];
 };
 }  // namespace bustub
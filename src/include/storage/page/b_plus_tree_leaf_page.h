@@ -10,6 +10,7 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <cstdint>
 #include <utility>
 #include <vector>
 
@@ -18,8 +19,9 @@
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
-#define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+#define LEAF_PAGE_HEADER_SIZE 32
+#define LEAF_PAGE_SIZE_OF(page_size) (((page_size)-LEAF_PAGE_HEADER_SIZE - sizeof(KeyType)) / sizeof(MappingType))
+#define LEAF_PAGE_SIZE LEAF_PAGE_SIZE_OF(PAGE_SIZE)
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
@@ -27,33 +29,56 @@ namespace bustub {
  * page. Only support unique key.
  *
  * Leaf page format (keys are stored in order):
- *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
- *  ----------------------------------------------------------------------
+ *  ------------------------------------------------------------------------------------
+ * | HEADER | HIGH KEY | PREFIX | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
+ *  ------------------------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ *  Header format (size in byte, 32 bytes in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
- *  -----------------------------------------------
+ *  ---------------------------------------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | KeySize (1) | PrefixSize (1) | KeyEnd (1) | Unused (1)
+ *  ---------------------------------------------------------------------------------------------------
+ *
+ * The next page is the right sibling, and the high key is the lowest key that belongs to it, i.e. an upper bound on
+ * the keys of this page. The rightmost page has no sibling, and its high key is unused.
+ *
+ * Each entry stores the bytes [PrefixSize, KeyEnd) of its key. The first PrefixSize bytes, which all keys of the page
+ * share, are stored once in PREFIX, and the bytes from KeyEnd on are zero in all of them. Pages that are not
+ * compressed have KeySize 0 and store whole keys; their max size is given when they are created. Compressed pages
+ * narrow the entries to their keys whenever entries move between pages, widen them for keys that need more bytes, and
+ * size themselves by their bytes; see BPlusTreePage::CompressedMaxSize for why that size is capped.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
  public:
   // After creating a new leaf page from buffer pool, must call initialize
-  // method to set default values
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = LEAF_PAGE_SIZE);
+  // method to set default values; a key size compresses the page, whose keys then have no nonzero byte past it
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = LEAF_PAGE_SIZE,
+            int key_size = 0);
   // helper methods
   page_id_t GetNextPageId() const;
   void SetNextPageId(page_id_t next_page_id);
+  KeyType GetHighKey() const;
+  void SetHighKey(const KeyType &high_key);
   KeyType KeyAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
-  const MappingType &GetItem(int index);
+  MappingType GetItem(int index) const;
+  int GetKeySize() const;
+
+  // Whether key can be inserted without splitting the page first, which a compressed page that would need wider
+  // entries for it may have to do; the max size of the page once it holds key; and the least max size it can have
+  // once it holds any one key more.
+  bool HasRoomFor(const KeyType &key) const;
+  int GetMaxSizeFor(const KeyType &key) const;
+  int GetMaxSizeForAnyKey() const;
+  // Whether right, the page after this one, fits into this page.
+  bool CanMerge(const BPlusTreeLeafPage *right) const;
 
   // insert and delete methods
   int Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator);
+  void Append(const KeyType &key, const ValueType &value);
   bool Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const;
   int RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator);
 
@@ -64,10 +89,48 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
 
  private:
-  void CopyNFrom(MappingType *items, int size);
+  static_assert(sizeof(KeyType) <= UINT8_MAX, "key sizes are stored in a byte");
+
+  /**
+   * The entries of the page as of one read of its layout. Lookups that read the page while a writer changes it,
+   * to validate the page version afterwards, so see a layout that keeps them within the page.
+   */
+  struct Entries {
+    const char *prefix_;
+    const char *slots_;
+    int prefix_size_;
+    int key_end_;
+    int slot_size_;
+    int size_;
+
+    // the key is decoded into buf, unless the page stores it whole
+    const KeyType &KeyAt(int index, KeyType *buf) const;
+    ValueType ValueAt(int index) const;
+    // compare the key at index with key, whose comparator prefix is key_prefix
+    int CompareAt(int index, const KeyType &key, uint64_t key_prefix, const KeyComparator &comparator) const;
+    // index of the first key not less than key, or size_ if there is none
+    int LowerBound(const KeyType &key, const KeyComparator &comparator) const;
+  };
+
+  Entries GetEntries() const;
+  int DataSize() const;
+  char *SlotAt(int index);
+  void WriteEntry(int index, const KeyType &key, const ValueType &value);
+  void InsertAt(int index, const KeyType &key, const ValueType &value);
+  void RemoveAt(int index);
+  void WidenFor(const KeyType &key, int *prefix_size, int *key_end) const;
+  void LayoutOf(const std::vector<MappingType> &items, int *prefix_size, int *key_end) const;
+  void Decode(std::vector<MappingType> *items) const;
+  void Encode(const std::vector<MappingType> &items);
+  void Encode(const std::vector<MappingType> &items, int prefix_size, int key_end, const char *prefix);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item);
   page_id_t next_page_id_;
-  MappingType array[0];
+  uint8_t key_size_;
+  uint8_t prefix_size_;
+  uint8_t key_end_;
+  uint8_t unused_;
+  KeyType high_key_;
+  char data_[0];
 };
 }  // namespace bustub
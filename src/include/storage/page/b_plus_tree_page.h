@@ -27,6 +27,12 @@ namespace bustub {
 // define page type enum
 enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
 
+/**
+ * How the pages of a B+ tree store their keys. PLAIN pages store whole keys. COMPRESSED pages store the prefix their
+ * keys share once and drop the zero bytes their keys end in, so wide keys with little in them take less room.
+ */
+enum class BTreePageLayout { PLAIN, COMPRESSED };
+
 /**
  * Both internal and leaf page are inherited from this page.
  *
@@ -62,6 +68,13 @@ class BPlusTreePage {
 
   void SetLSN(lsn_t lsn = INVALID_LSN);
 
+  // Number of bytes of a key up to its last nonzero byte.
+  static int SignificantLength(const char *key, int key_size);
+
+ protected:
+  static int CommonPrefixLength(const char *lhs, const char *rhs, int length);
+  static int CompressedMaxSize(int data_size, int key_size, int value_size, int prefix_size, int key_end);
+
  private:
   // member variable, attributes that both internal and leaf page share
   IndexPageType page_type_;
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -28,10 +29,12 @@ namespace bustub {
 class Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManager;
+  friend class BufferPoolManagerInstance;
+  friend class FrameArray;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
+  /** Constructor. The frame gets its data from the FrameArray that holds it. */
+  Page() = default;
 
   /** Default destructor. */
   ~Page() = default;
@@ -39,6 +42,9 @@ class Page {
   /** @return the actual data contained within this page */
   inline char *GetData() { return data_; }
 
+  /** @return the size in bytes of the data of this frame, that of the page size class it belongs to */
+  inline int GetSize() const { return size_; }
+
   /** @return the page id of this page */
   inline page_id_t GetPageId() { return page_id_; }
 
@@ -48,18 +54,46 @@ class Page {
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
   inline bool IsDirty() { return is_dirty_; }
 
-  /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
+  /** Acquire the page write latch. The version turns odd, so optimistic reads from now on fail. */
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_relaxed);
+    // the odd version becomes visible before anything the writer changes
+    std::atomic_thread_fence(std::memory_order_release);
+  }
 
-  /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  /** Release the page write latch. The version turns even again, and differs from before the latch was taken. */
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
 
+  /** Acquire the page read latch if no writer holds or waits for it. @return true if the latch was acquired */
+  inline bool TryRLatch() { return rwlatch_.TryRLock(); }
+
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+  /**
+   * Starts an optimistic read: the page is read without its latch, and ValidateOptimisticRead tells afterwards whether
+   * what was read is consistent. The page must stay pinned for the whole read.
+   * @param[out] version the version to validate the read against
+   * @return false if the page is write latched, in which case there is no point in reading it
+   */
+  inline bool TryOptimisticRead(uint64_t *version) const {
+    *version = version_.load(std::memory_order_acquire);
+    return (*version & 1) == 0;
+  }
+
+  /** @return true if the page was not write latched since TryOptimisticRead handed out version */
+  inline bool ValidateOptimisticRead(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
   /** @return the page LSN. */
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
@@ -76,18 +110,22 @@ class Page {
 
  private:
   /** Zeroes out the data that is held within the page. */
-  inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
-
-  /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
-  /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, size_); }
+
+  /** The data of the page, held by the FrameArray and aligned so that it can be read and written with O_DIRECT. */
+  char *data_{nullptr};
+  /** Size of data_ in bytes. */
+  int size_{0};
+  /** The ID of this page. Read without the buffer pool latch on the hit path, hence atomic. */
+  std::atomic<page_id_t> page_id_ = INVALID_PAGE_ID;
+  /** The pin count of this page; -1 while the frame is free or being (re)assigned by the buffer pool. */
+  std::atomic<int> pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** Bumped when the write latch is taken and when it is released, so odd while a writer holds the page. */
+  std::atomic<uint64_t> version_{0};
 };
 
 }  // namespace bustub
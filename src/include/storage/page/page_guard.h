@@ -0,0 +1,251 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.h
+//
+// Identification: src/include/storage/page/page_guard.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "storage/page/page.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+class ReadPageGuard;
+class WritePageGuard;
+
+/**
+ * BasicPageGuard holds a pin on a buffer pool page and unpins it when it goes out of scope or is dropped, reporting
+ * the page dirty if it was written through the guard. Guards are move-only, so a pin always has exactly one owner and
+ * is released exactly once, also when an exception unwinds the stack.
+ *
+ * A guard that holds no page is invalid; that is what the BufferPoolManager hands out when a page cannot be brought
+ * into the pool.
+ */
+class BasicPageGuard {
+ public:
+  BasicPageGuard() = default;
+
+  /**
+   * Takes over a pin on page.
+   * @param bpm the buffer pool the page belongs to
+   * @param page the pinned page, nullptr for an invalid guard
+   */
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+  BasicPageGuard(const BasicPageGuard &) = delete;
+  BasicPageGuard &operator=(const BasicPageGuard &) = delete;
+
+  /** Takes over the pin of that, which becomes invalid. */
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+
+  /** Releases the pin held, if any, and takes over the pin of that, which becomes invalid. */
+  BasicPageGuard &operator=(BasicPageGuard &&that) noexcept;
+
+  ~BasicPageGuard() { Drop(); }
+
+  /** Unpins the page and invalidates the guard; does nothing on an invalid guard. */
+  void Drop();
+
+  /**
+   * Read latches the page and hands the pin over to a read guard, without another round trip to the buffer pool.
+   * This guard becomes invalid.
+   */
+  ReadPageGuard UpgradeRead();
+
+  /**
+   * Like UpgradeRead, unless that would wait for a writer: then this guard stays as it is.
+   * @return true if the page was read latched and read_guard took it over
+   */
+  bool TryUpgradeRead(ReadPageGuard *read_guard);
+
+  /**
+   * Write latches the page and hands the pin over to a write guard, without another round trip to the buffer pool.
+   * This guard becomes invalid.
+   */
+  WritePageGuard UpgradeWrite();
+
+  /** @return true if the guard holds a page */
+  bool IsValid() const { return page_ != nullptr; }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() const { return page_->GetPageId(); }
+
+  /** @return the page data, for reading */
+  const char *GetData() const { return page_->GetData(); }
+
+  /** @return the page data, for writing; the page is unpinned dirty */
+  char *GetDataMut() {
+    is_dirty_ = true;
+    return page_->GetData();
+  }
+
+  /** @return the page data viewed as T, for reading */
+  template <class T>
+  const T *As() const {
+    return reinterpret_cast<const T *>(GetData());
+  }
+
+  /** @return the page data viewed as T, for writing; the page is unpinned dirty */
+  template <class T>
+  T *AsMut() {
+    return reinterpret_cast<T *>(GetDataMut());
+  }
+
+  /**
+   * @return the page itself as T, for the Page subclasses that wrap their own data (TablePage, HeaderPage); call
+   * SetDirty if it is written to
+   */
+  template <class T>
+  T *AsPage() {
+    return static_cast<T *>(page_);
+  }
+
+  /** Makes the page be unpinned dirty. */
+  void SetDirty() { is_dirty_ = true; }
+
+  /** Starts an optimistic read of the unlatched page, see Page::TryOptimisticRead. */
+  bool TryOptimisticRead(uint64_t *version) const { return page_->TryOptimisticRead(version); }
+
+  /** @return true if the page was not write latched since TryOptimisticRead handed out version */
+  bool ValidateOptimisticRead(uint64_t version) const { return page_->ValidateOptimisticRead(version); }
+
+ private:
+  friend class ReadPageGuard;
+  friend class WritePageGuard;
+
+  BufferPoolManager *bpm_{nullptr};
+  Page *page_{nullptr};
+  bool is_dirty_{false};
+};
+
+/**
+ * ReadPageGuard holds a pin and the read latch of a buffer pool page and releases both, latch first, when it goes out
+ * of scope or is dropped.
+ */
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+
+  /**
+   * Takes over a pin and the read latch on page.
+   * @param bpm the buffer pool the page belongs to
+   * @param page the pinned and read latched page, nullptr for an invalid guard
+   */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+
+  ReadPageGuard(const ReadPageGuard &) = delete;
+  ReadPageGuard &operator=(const ReadPageGuard &) = delete;
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+
+  /** Releases the latch and pin held, if any, and takes over those of that, which becomes invalid. */
+  ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+
+  ~ReadPageGuard() { Drop(); }
+
+  /** Unlatches and unpins the page and invalidates the guard; does nothing on an invalid guard. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  bool IsValid() const { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() const { return guard_.PageId(); }
+
+  /** @return the page data */
+  const char *GetData() const { return guard_.GetData(); }
+
+  /** @return the page data viewed as T */
+  template <class T>
+  const T *As() const {
+    return guard_.As<T>();
+  }
+
+  /** @return the page itself as T, for the Page subclasses that wrap their own data */
+  template <class T>
+  T *AsPage() {
+    return guard_.AsPage<T>();
+  }
+
+  /** @return true if the page was not write latched since an optimistic read of it was handed version */
+  bool ValidateOptimisticRead(uint64_t version) const { return guard_.ValidateOptimisticRead(version); }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+/**
+ * WritePageGuard holds a pin and the write latch of a buffer pool page and releases both, latch first, when it goes
+ * out of scope or is dropped.
+ */
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+
+  /**
+   * Takes over a pin and the write latch on page.
+   * @param bpm the buffer pool the page belongs to
+   * @param page the pinned and write latched page, nullptr for an invalid guard
+   */
+  WritePageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+
+  WritePageGuard(const WritePageGuard &) = delete;
+  WritePageGuard &operator=(const WritePageGuard &) = delete;
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+
+  /** Releases the latch and pin held, if any, and takes over those of that, which becomes invalid. */
+  WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+
+  ~WritePageGuard() { Drop(); }
+
+  /** Unlatches and unpins the page and invalidates the guard; does nothing on an invalid guard. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  bool IsValid() const { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  page_id_t PageId() const { return guard_.PageId(); }
+
+  /** @return the page data, for reading */
+  const char *GetData() const { return guard_.GetData(); }
+
+  /** @return the page data, for writing; the page is unpinned dirty */
+  char *GetDataMut() { return guard_.GetDataMut(); }
+
+  /** @return the page data viewed as T, for reading */
+  template <class T>
+  const T *As() const {
+    return guard_.As<T>();
+  }
+
+  /** @return the page data viewed as T, for writing; the page is unpinned dirty */
+  template <class T>
+  T *AsMut() {
+    return guard_.AsMut<T>();
+  }
+
+  /** @return the page itself as T, for the Page subclasses that wrap their own data; see SetDirty */
+  template <class T>
+  T *AsPage() {
+    return guard_.AsPage<T>();
+  }
+
+  /** Makes the page be unpinned dirty. */
+  void SetDirty() { guard_.SetDirty(); }
+
+ private:
+  friend class BasicPageGuard;
+
+  BasicPageGuard guard_;
+};
+
+}  // namespace bustub
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
@@ -46,9 +48,10 @@ class TableHeap {
    * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @param txn the creating transaction
+   * @param page_size_class size of the pages of the table; the buffer pool must have frames of that size
    */
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-            Transaction *txn);
+            Transaction *txn, PageSizeClass page_size_class = PageSizeClass::PAGE_4K);
 
   /**
    * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
@@ -99,6 +102,16 @@ class TableHeap {
    */
   bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn);
 
+  /**
+   * Read the tuples of a batch of rids from the table. The rids are visited in page order, so that each page is
+   * fetched once, with table_scan_read_ahead of the pages still to come read in ahead.
+   * @param rids rids of the tuples to read, in any order
+   * @param[out] tuples the tuple of each rid, at the rid's position
+   * @param txn transaction performing the read
+   * @return true if every read was successful
+   */
+  bool GetTuples(const std::vector<RID> &rids, std::vector<Tuple> *tuples, Transaction *txn);
+
   /** @return the begin iterator of this table */
   TableIterator Begin(Transaction *txn);
 
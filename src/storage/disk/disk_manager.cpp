@@ -10,8 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstring>
 #include <iostream>
 #include <string>
@@ -25,18 +30,28 @@ namespace bustub {
 
 static char *buffer_used;
 
+/** Number of 64-bit words of the free-space map stored in one page of its file. */
+static constexpr size_t FSM_WORDS_PER_PAGE = PAGE_SIZE / sizeof(uint64_t);
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
 DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+    : file_name_(db_file),
+      next_page_id_(0),
+      num_flushes_(0),
+      num_writes_(0),
+      num_reads_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  fsm_name_ = file_name_.substr(0, n) + ".fsm";
 
   log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -52,27 +67,51 @@ DiskManager::DiskManager(const std::string &db_file)
     }
   }
 
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
-    }
+  // create the file if it does not exist
+  db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
   }
   buffer_used = nullptr;
+
+  // page ids already in the file are taken; a fresh file makes whatever free-space map is lying around stale
+  size_t num_pages = GetNumDiskPages();
+  next_page_id_ = static_cast<page_id_t>(num_pages);
+  fsm_fd_ = open(fsm_name_.c_str(), O_RDWR | O_CREAT | (num_pages == 0 ? O_TRUNC : 0), 0644);
+  if (fsm_fd_ < 0) {
+    throw Exception("can't open free-space map file");
+  }
+  int fsm_size = GetFileSize(fsm_name_);
+  if (fsm_size > 0) {
+    free_map_.resize((fsm_size + PAGE_SIZE - 1) / PAGE_SIZE * FSM_WORDS_PER_PAGE);
+    if (pread(fsm_fd_, free_map_.data(), fsm_size, 0) != fsm_size) {
+      throw Exception("can't read free-space map file");
+    }
+    size_t num_free_pages = 0;
+    for (size_t word = 0; word < free_map_.size(); ++word) {
+      if (free_map_[word] != 0) {
+        num_free_pages += __builtin_popcountll(free_map_[word]);
+        // pages freed before they were ever written lie beyond the end of the file, but their ids were taken too
+        auto last_free = static_cast<page_id_t>(word * 64 + 63 - __builtin_clzll(free_map_[word]));
+        next_page_id_ = std::max<page_id_t>(next_page_id_, last_free + 1);
+      }
+    }
+    num_free_pages_ = num_free_pages;
+  }
 }
 
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
-  db_io_.close();
+  if (fsm_fd_ >= 0) {
+    close(fsm_fd_);
+    fsm_fd_ = -1;
+  }
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+    db_fd_ = -1;
+  }
   log_io_.close();
 }
 
@@ -80,45 +119,107 @@ void DiskManager::ShutDown() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
+  off_t offset = static_cast<off_t>(GetPageSlot(page_id)) * PAGE_SIZE;
+  int page_size = PageSizeOf(page_id);
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
+  num_write_calls_ += 1;
+  // pwrite hands the page straight to the OS, like the flush of the old stream did
+  if (pwrite(db_fd_, page_data, page_size, offset) != page_size) {
     LOG_DEBUG("I/O error while writing");
-    return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
-      LOG_DEBUG("I/O error while reading");
-      return;
+  off_t offset = static_cast<off_t>(GetPageSlot(page_id)) * PAGE_SIZE;
+  int page_size = PageSizeOf(page_id);
+  num_reads_ += 1;
+  ssize_t read_count = pread(db_fd_, page_data, page_size, offset);
+  if (read_count < 0) {
+    LOG_DEBUG("I/O error while reading");
+    return;
+  }
+  // if file ends before reading the whole page
+  if (read_count < page_size) {
+    LOG_DEBUG("Read less than a page");
+    memset(page_data + read_count, 0, page_size - read_count);
+  }
+}
+
+/**
+ * Write a set of pages with one pwritev per run of adjacent pages, then sync the file once
+ */
+void DiskManager::WritePages(std::vector<std::pair<page_id_t, const char *>> *pages) {
+  if (pages->empty()) {
+    return;
+  }
+  std::sort(pages->begin(), pages->end(),
+            [](const std::pair<page_id_t, const char *> &a, const std::pair<page_id_t, const char *> &b) {
+              return GetPageSlot(a.first) < GetPageSlot(b.first);
+            });
+
+  std::vector<iovec> iovecs;
+  size_t run_start = 0;
+  while (run_start < pages->size()) {
+    // extend the run while the pages stay adjacent in the file, up to what a single pwritev accepts
+    size_t run_end = run_start + 1;
+    while (run_end < pages->size() && run_end - run_start < IOV_MAX &&
+           GetPageSlot((*pages)[run_end].first) == GetPageSlot(NextPageId((*pages)[run_end - 1].first))) {
+      run_end++;
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    iovecs.clear();
+    size_t remaining = 0;
+    for (size_t i = run_start; i < run_end; ++i) {
+      auto page_size = static_cast<size_t>(PageSizeOf((*pages)[i].first));
+      iovecs.push_back({const_cast<char *>((*pages)[i].second), page_size});
+      remaining += page_size;
     }
+
+    off_t offset = static_cast<off_t>(GetPageSlot((*pages)[run_start].first)) * PAGE_SIZE;
+    iovec *iov = iovecs.data();
+    int iov_count = static_cast<int>(iovecs.size());
+    // pwritev may stop short; resume from wherever it did
+    while (remaining > 0) {
+      ssize_t written = pwritev(db_fd_, iov, iov_count, offset);
+      num_write_calls_ += 1;
+      if (written < 0) {
+        LOG_DEBUG("I/O error while writing");
+        break;
+      }
+      offset += written;
+      remaining -= written;
+      while (iov_count > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+        written -= iov->iov_len;
+        iov++;
+        iov_count--;
+      }
+      if (iov_count > 0) {
+        iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+        iov->iov_len -= written;
+      }
+    }
+    num_writes_ += static_cast<int>(run_end - run_start);
+    run_start = run_end;
+  }
+
+  if (fsync(db_fd_) != 0 || fsync(fsm_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+}
+
+/**
+ * Perform a batch of page requests synchronously, in submission order
+ */
+void DiskManager::SubmitRequests(std::vector<DiskRequest> requests) {
+  for (auto &request : requests) {
+    if (request.is_write_) {
+      WritePage(request.page_id_, request.data_);
+    } else {
+      ReadPage(request.page_id_, request.data_);
+    }
+    request.callback_(true);
   }
 }
 
@@ -186,16 +287,157 @@ bool DiskManager::ReadLog(char *log_data, int size, int offset) {
 
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * Reuse the lowest free slots if there are enough, otherwise extend the file
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage(PageSizeClass size_class) {
+  page_id_t num_slots = SlotsOfClass(size_class);
+  if (num_slots == 1) {
+    if (num_free_pages_ == 0) {
+      return next_page_id_++;
+    }
+
+    std::scoped_lock<std::mutex> lock(fsm_latch_);
+    for (; free_hint_ < free_map_.size(); ++free_hint_) {
+      if (free_map_[free_hint_] != 0) {
+        auto page_id = static_cast<page_id_t>(free_hint_ * 64 + __builtin_ctzll(free_map_[free_hint_]));
+        // written through before the page is handed out, so that a page in use is never recorded as free
+        SetFreeL(page_id, false);
+        return page_id;
+      }
+    }
+    return next_page_id_++;
+  }
+
+  std::scoped_lock<std::mutex> lock(fsm_latch_);
+  if (num_free_pages_ >= static_cast<size_t>(num_slots)) {
+    page_id_t slot = FindFreeSlotsL(num_slots);
+    if (slot != INVALID_PAGE_ID) {
+      SetFreeL(slot, false, num_slots);
+      return MakePageId(size_class, slot);
+    }
+  }
+  // extend the file; single slot allocations bump the end without the latch, hence the loop
+  page_id_t end = next_page_id_;
+  page_id_t slot;
+  do {
+    slot = (end + num_slots - 1) / num_slots * num_slots;
+  } while (!next_page_id_.compare_exchange_weak(end, slot + num_slots));
+  // the slots skipped to align the page are left for smaller pages
+  if (slot > end) {
+    SetFreeL(end, true, slot - end);
+  }
+  free_hint_ = std::min(free_hint_, static_cast<size_t>(end) / 64);
+  return MakePageId(size_class, slot);
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
- * This does not actually need to do anything for now.
+ * Record the slots of the page in the free-space map
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (page_id < 0 || static_cast<size_t>(GetPageSizeClass(page_id)) >= NUM_PAGE_SIZE_CLASSES) {
+    return;
+  }
+  page_id_t slot = GetPageSlot(page_id);
+  page_id_t num_slots = SlotsOfClass(GetPageSizeClass(page_id));
+  if (slot % num_slots != 0 || slot + num_slots > next_page_id_) {
+    return;
+  }
+  std::scoped_lock<std::mutex> lock(fsm_latch_);
+  if (IsFreeL(slot)) {
+    LOG_DEBUG("page %d deallocated twice", page_id);
+    return;
+  }
+  SetFreeL(slot, true, num_slots);
+  free_hint_ = std::min(free_hint_, static_cast<size_t>(slot) / 64);
+}
+
+/**
+ * Find the lowest run of free slots that a page of num_slots slots can take
+ */
+page_id_t DiskManager::FindFreeSlotsL(page_id_t num_slots) const {
+  // runs are aligned to their length, which divides 64, so a run never straddles two words
+  uint64_t run = (num_slots == 64 ? ~uint64_t{0} : (uint64_t{1} << num_slots) - 1);
+  for (size_t word = free_hint_; word < free_map_.size(); ++word) {
+    if (free_map_[word] == 0) {
+      continue;
+    }
+    for (page_id_t shift = 0; shift < 64; shift += num_slots) {
+      if ((free_map_[word] >> shift & run) == run) {
+        return static_cast<page_id_t>(word * 64) + shift;
+      }
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+/**
+ * Truncate the run of free pages at the end of the file
+ */
+size_t DiskManager::TruncateFreePages() {
+  std::scoped_lock<std::mutex> lock(fsm_latch_);
+  page_id_t end = next_page_id_;
+  page_id_t new_end = end;
+  while (new_end > 0 && IsFreeL(new_end - 1)) {
+    new_end--;
+  }
+  if (new_end == end) {
+    return 0;
+  }
+  // allocations that bypass the latch only ever bump next_page_id_; if one did, the tail is no longer free
+  if (!next_page_id_.compare_exchange_strong(end, new_end)) {
+    return 0;
+  }
+
+  SetFreeL(new_end, false, end - new_end);
+  if (static_cast<size_t>(new_end) < GetNumDiskPages() &&
+      ftruncate(db_fd_, static_cast<off_t>(new_end) * PAGE_SIZE) != 0) {
+    LOG_DEBUG("I/O error while truncating");
+  }
+  return end - new_end;
+}
+
+/**
+ * Flip the bits of a run of slots in the free-space map and write the map pages holding them
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {}
+void DiskManager::SetFreeL(page_id_t slot, bool is_free, page_id_t num_slots) {
+  auto first_word = static_cast<size_t>(slot) / 64;
+  auto last_word = static_cast<size_t>(slot + num_slots - 1) / 64;
+  if (last_word >= free_map_.size()) {
+    free_map_.resize((last_word / FSM_WORDS_PER_PAGE + 1) * FSM_WORDS_PER_PAGE);
+  }
+  for (page_id_t i = slot; i < slot + num_slots; ++i) {
+    uint64_t bit = uint64_t{1} << (i % 64);
+    if (is_free) {
+      free_map_[i / 64] |= bit;
+    } else {
+      free_map_[i / 64] &= ~bit;
+    }
+  }
+  if (is_free) {
+    num_free_pages_ += num_slots;
+  } else {
+    num_free_pages_ -= num_slots;
+  }
+
+  for (size_t map_page = first_word / FSM_WORDS_PER_PAGE; map_page <= last_word / FSM_WORDS_PER_PAGE; ++map_page) {
+    off_t offset = static_cast<off_t>(map_page) * PAGE_SIZE;
+    if (pwrite(fsm_fd_, free_map_.data() + map_page * FSM_WORDS_PER_PAGE, PAGE_SIZE, offset) != PAGE_SIZE) {
+      LOG_DEBUG("I/O error while writing the free-space map");
+    }
+  }
+}
+
+/**
+ * Returns the size of the database file in slots, counting a trailing partial slot
+ */
+size_t DiskManager::GetNumDiskPages() {
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) != 0 || stat_buf.st_size <= 0) {
+    return 0;
+  }
+  return (static_cast<size_t>(stat_buf.st_size) + PAGE_SIZE - 1) / PAGE_SIZE;
+}
 
 /**
  * Returns number of flushes made so far
@@ -207,6 +449,16 @@ int DiskManager::GetNumFlushes() const { return num_flushes_; }
  */
 int DiskManager::GetNumWrites() const { return num_writes_; }
 
+/**
+ * Returns number of write system calls made so far
+ */
+int DiskManager::GetNumWriteCalls() const { return num_write_calls_; }
+
+/**
+ * Returns number of page reads
+ */
+int DiskManager::GetNumReads() const { return num_reads_; }
+
 /**
  * Returns true if the log is currently being flushed
  */
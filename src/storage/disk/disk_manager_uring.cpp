@@ -0,0 +1,329 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// disk_manager_uring.cpp
+//
+// Identification: src/storage/disk/disk_manager_uring.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/disk_manager_uring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+namespace {
+
+int IoUringSetup(unsigned entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int IoUringRegister(int ring_fd, unsigned opcode, void *arg, unsigned nr_args) {
+  return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+/** user_data of the no-op that tells the completion thread to exit */
+constexpr uint64_t SHUTDOWN_USER_DATA = 0;
+
+}  // namespace
+
+DiskManagerUring::DiskManagerUring(const std::string &db_file, bool direct_io, unsigned queue_depth)
+    : DiskManager(db_file) {
+  if (direct_io) {
+    // not every file system supports O_DIRECT (tmpfs does not); the buffered descriptor serves everything then
+    direct_fd_ = open(db_file.c_str(), O_RDWR | O_DIRECT);
+    if (direct_fd_ < 0) {
+      LOG_DEBUG("O_DIRECT is not supported for %s, using buffered I/O", db_file.c_str());
+    }
+  }
+  SetUpRing(queue_depth);
+  if (ring_fd_ >= 0) {
+    completion_thread_ = new std::thread(&DiskManagerUring::RunCompletionThread, this);
+  }
+}
+
+void DiskManagerUring::SetUpRing(unsigned queue_depth) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int ring_fd = IoUringSetup(queue_depth, &params);
+  if (ring_fd < 0) {
+    LOG_DEBUG("io_uring_setup failed (%s), falling back to synchronous I/O", strerror(errno));
+    return;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ =
+      mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                                IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+    LOG_DEBUG("mapping the io_uring queues failed, falling back to synchronous I/O");
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqes_size_);
+    }
+    if (!single_mmap && cq_ring_ != MAP_FAILED) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    sq_ring_ = cq_ring_ = nullptr;
+    close(ring_fd);
+    return;
+  }
+
+  auto *sq = static_cast<char *>(sq_ring_);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  sq_entries_ = params.sq_entries;
+  auto *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  cq_entries_ = params.cq_entries;
+  sqes_ = static_cast<io_uring_sqe *>(sqes);
+  ring_fd_ = ring_fd;
+}
+
+void DiskManagerUring::ShutDown() {
+  if (ring_fd_ >= 0) {
+    {
+      // let everything in flight complete, then queue the no-op that makes the completion thread exit
+      std::unique_lock<std::mutex> lock(sq_latch_);
+      sq_cv_.wait(lock, [this] { return in_flight_ == 0; });
+      unsigned tail = *sq_tail_;
+      unsigned index = tail & *sq_mask_;
+      io_uring_sqe *sqe = &sqes_[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = SHUTDOWN_USER_DATA;
+      sq_array_[index] = index;
+      __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+      while (IoUringEnter(ring_fd_, 1, 0, 0) < 0 && errno == EINTR) {
+      }
+    }
+    completion_thread_->join();
+    delete completion_thread_;
+    completion_thread_ = nullptr;
+
+    munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+  if (direct_fd_ >= 0) {
+    close(direct_fd_);
+    direct_fd_ = -1;
+  }
+  DiskManager::ShutDown();
+}
+
+void DiskManagerUring::WritePage(page_id_t page_id, const char *page_data) {
+  off_t offset = static_cast<off_t>(GetPageSlot(page_id)) * PAGE_SIZE;
+  int page_size = PageSizeOf(page_id);
+  num_writes_ += 1;
+  num_write_calls_ += 1;
+  if (pwrite(FileFor(page_data), page_data, page_size, offset) != page_size) {
+    LOG_DEBUG("I/O error while writing");
+  }
+}
+
+void DiskManagerUring::ReadPage(page_id_t page_id, char *page_data) {
+  off_t offset = static_cast<off_t>(GetPageSlot(page_id)) * PAGE_SIZE;
+  int page_size = PageSizeOf(page_id);
+  num_reads_ += 1;
+  ssize_t read_count = pread(FileFor(page_data), page_data, page_size, offset);
+  if (read_count < 0) {
+    LOG_DEBUG("I/O error while reading");
+    return;
+  }
+  // if file ends before reading the whole page
+  if (read_count < page_size) {
+    memset(page_data + read_count, 0, page_size - read_count);
+  }
+}
+
+void DiskManagerUring::SubmitRequests(std::vector<DiskRequest> requests) {
+  if (ring_fd_ < 0) {
+    DiskManager::SubmitRequests(std::move(requests));
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(sq_latch_);
+  size_t next = 0;
+  while (next < requests.size()) {
+    // every request in flight needs a completion queue entry, otherwise the kernel would have to drop completions
+    sq_cv_.wait(lock, [this] { return in_flight_ < cq_entries_; });
+    auto batch = std::min<size_t>({requests.size() - next, sq_entries_, cq_entries_ - in_flight_});
+
+    unsigned tail = *sq_tail_;
+    for (size_t i = 0; i < batch; ++i, ++next) {
+      DiskRequest &request = requests[next];
+      if (request.is_write_) {
+        num_writes_ += 1;
+      } else {
+        num_reads_ += 1;
+      }
+
+      unsigned index = (tail + i) & *sq_mask_;
+      io_uring_sqe *sqe = &sqes_[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = request.is_write_ ? IORING_OP_WRITE : IORING_OP_READ;
+      sqe->fd = FileFor(request.data_);
+      sqe->off = static_cast<uint64_t>(GetPageSlot(request.page_id_)) * PAGE_SIZE;
+      sqe->addr = reinterpret_cast<uint64_t>(request.data_);
+      sqe->len = PageSizeOf(request.page_id_);
+      if (buffers_registered_) {
+        for (size_t buffer = 0; buffer < buffers_.size(); ++buffer) {
+          char *begin = buffers_[buffer].first;
+          if (request.data_ >= begin && request.data_ + sqe->len <= begin + buffers_[buffer].second) {
+            sqe->opcode = request.is_write_ ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->buf_index = static_cast<uint16_t>(buffer);
+            break;
+          }
+        }
+      }
+      sqe->user_data = reinterpret_cast<uint64_t>(new InFlightRequest(std::move(request)));
+      sq_array_[index] = index;
+    }
+    __atomic_store_n(sq_tail_, tail + static_cast<unsigned>(batch), __ATOMIC_RELEASE);
+    in_flight_ += batch;
+
+    // without SQPOLL the kernel consumes every queued entry during the call, so the queue is empty afterwards
+    auto to_submit = static_cast<unsigned>(batch);
+    while (to_submit > 0) {
+      int submitted = IoUringEnter(ring_fd_, to_submit, 0, 0);
+      if (submitted < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+          continue;
+        }
+        throw Exception("io_uring_enter failed");
+      }
+      to_submit -= static_cast<unsigned>(submitted);
+    }
+  }
+}
+
+void DiskManagerUring::RegisterBuffers(char *data, size_t size) {
+  if (ring_fd_ < 0) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(sq_latch_);
+  sq_cv_.wait(lock, [this] { return in_flight_ == 0; });
+  buffers_.emplace_back(data, size);
+  UpdateRegisteredBuffersL();
+}
+
+void DiskManagerUring::UnregisterBuffers(char *data) {
+  if (ring_fd_ < 0) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(sq_latch_);
+  sq_cv_.wait(lock, [this] { return in_flight_ == 0; });
+  buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                [data](const std::pair<char *, size_t> &buffer) { return buffer.first == data; }),
+                 buffers_.end());
+  UpdateRegisteredBuffersL();
+}
+
+void DiskManagerUring::UpdateRegisteredBuffersL() {
+  if (buffers_registered_) {
+    IoUringRegister(ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    buffers_registered_ = false;
+  }
+  if (buffers_.empty()) {
+    return;
+  }
+  std::vector<iovec> iovecs;
+  iovecs.reserve(buffers_.size());
+  for (auto &buffer : buffers_) {
+    iovecs.push_back({buffer.first, buffer.second});
+  }
+  // registration pins the memory, which RLIMIT_MEMLOCK may forbid; the plain opcodes work without it
+  buffers_registered_ =
+      IoUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, iovecs.data(), static_cast<unsigned>(iovecs.size())) == 0;
+  if (!buffers_registered_) {
+    LOG_DEBUG("registering %zu buffers failed (%s)", iovecs.size(), strerror(errno));
+  }
+}
+
+void DiskManagerUring::RunCompletionThread() {
+  while (true) {
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+
+    size_t completed = 0;
+    bool shut_down = false;
+    for (; head != tail; ++head) {
+      io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+      if (cqe->user_data == SHUTDOWN_USER_DATA) {
+        shut_down = true;
+        continue;
+      }
+      auto *in_flight = reinterpret_cast<InFlightRequest *>(cqe->user_data);
+      DiskRequest &request = in_flight->request_;
+      int page_size = PageSizeOf(request.page_id_);
+      bool ok = cqe->res == page_size;
+      if (!request.is_write_ && cqe->res >= 0 && cqe->res < page_size) {
+        // if file ends before reading the whole page
+        memset(request.data_ + cqe->res, 0, page_size - cqe->res);
+        ok = true;
+      }
+      if (!ok) {
+        LOG_DEBUG("I/O error on page %d: %s", request.page_id_, strerror(-cqe->res));
+      }
+      request.callback_(ok);
+      delete in_flight;
+      completed++;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    if (completed > 0) {
+      {
+        std::scoped_lock<std::mutex> lock(sq_latch_);
+        in_flight_ -= completed;
+      }
+      sq_cv_.notify_all();
+    }
+    if (shut_down) {
+      return;
+    }
+  }
+}
+
+}  // namespace bustub
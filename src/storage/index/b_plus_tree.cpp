@@ -10,6 +10,7 @@
 //===----------------------------------------------------------------------===//
 
 #include <string>
+#include <utility>
 
 #include "common/exception.h"
 #include "common/logger.h"
@@ -25,18 +26,31 @@ const bool b_debug_msg = false;
 
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, PageSizeClass page_size_class,
+                          BTreePageLayout page_layout, int key_size)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {
+      internal_max_size_(internal_max_size),
+      page_size_class_(page_size_class),
+      key_size_(page_layout == BTreePageLayout::COMPRESSED ? key_size : 0),
+      latch_protocol_(btree_latch_protocol) {
+  if (page_layout == BTreePageLayout::COMPRESSED && (key_size < 1 || key_size > static_cast<int>(sizeof(KeyType)))) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "compressed B+ tree key size");
+  }
   if (b_debug_msg) {
     LOG_DEBUG("internal max cap: %d - leaf max cap: %d", internal_max_size_, leaf_max_size_);
   }
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                          PageSizeClass page_size_class, BTreePageLayout page_layout, int key_size)
+    : BPlusTree(std::move(name), buffer_pool_manager, comparator, LEAF_PAGE_SIZE_OF(PageSizeOfClass(page_size_class)),
+                INTERNAL_PAGE_SIZE_OF(PageSizeOfClass(page_size_class)), page_size_class, page_layout, key_size) {}
+
 /*
  * Helper function to decide whether current b+tree is empty - CALLER HOLD lock
  */
@@ -52,34 +66,114 @@ bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID;
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) {
-  //{
-  //  Page *page;
-  //  BPlusTreePage *page_node;
-
-  //  page = buffer_pool_manager_->FetchPage(root_page_id_);
-  //  page_node = reinterpret_cast<BPlusTreePage *> (page->GetData());
-  //  ToString(page_node, buffer_pool_manager_);
-  //}
-  Page *page = READ_FindLeafPage(key, false, transaction);
-  if (page == nullptr) {
-    return false;
+  // search the leaf without latching it, and keep the result only if no writer changed the leaf meanwhile; B-link
+  // splits do not touch the parent, so its version does not tell a descent that it went to the wrong child
+  for (int attempt = 0; btree_optimistic_reads && latch_protocol_ == BTreeLatchProtocol::CRABBING &&
+                        attempt < OPTIMISTIC_READ_ATTEMPTS;
+       attempt++) {
+    BasicPageGuard leaf_guard;
+    uint64_t version;
+    if (!OPTIMISTIC_FindLeafPage(key, false, &leaf_guard, &version)) {
+      continue;
+    }
+    if (!leaf_guard.IsValid()) {
+      return false;
+    }
+    ValueType val;
+    bool ok = leaf_guard.As<LeafPage>()->Lookup(key, &val, comparator_);
+    if (leaf_guard.ValidateOptimisticRead(version)) {
+      if (ok) {
+        result->push_back(std::move(val));
+      }
+      return ok;
+    }
   }
 
-  auto *leaf_page_node = reinterpret_cast<LeafPage *>(page->GetData());
+  ReadPageGuard leaf_guard = READ_FindLeafPage(key, false, transaction);
+  if (!leaf_guard.IsValid()) {
+    return false;
+  }
 
   ValueType val;
-  bool ok = leaf_page_node->Lookup(key, &val, comparator_);
-
+  bool ok = leaf_guard.As<LeafPage>()->Lookup(key, &val, comparator_);
   if (ok) {
     result->push_back(std::move(val));
   }
-
-  // done using; not dirty
-  page->RUnlatch();
-  buffer_pool_manager_->UnpinPage(leaf_page_node->GetPageId(), false);
   return ok;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::GetValues(const std::vector<KeyType> &keys, std::vector<std::vector<ValueType>> *results,
+                                 Transaction *transaction) {
+  results->resize(keys.size());
+  size_t found = 0;
+  // look up the keys from first on that are on leaf: those up to its high key, as long as they do not decrease, for
+  // the leaf holds the keys from the one it was found for up to its high key; returns the index of the key after them
+  std::vector<std::pair<size_t, ValueType>> values;
+  auto lookup_run = [&](const LeafPage *leaf, size_t first) {
+    bool last_leaf = leaf->GetNextPageId() == INVALID_PAGE_ID;
+    KeyType high_key = leaf->GetHighKey();
+    values.clear();
+    size_t i = first;
+    do {
+      ValueType val;
+      if (leaf->Lookup(keys[i], &val, comparator_)) {
+        values.emplace_back(i, std::move(val));
+      }
+      i++;
+    } while (i < keys.size() && comparator_(keys[i], keys[i - 1]) >= 0 &&
+             (last_leaf || comparator_(keys[i], high_key) < 0));
+    return i;
+  };
+  auto keep_values = [&]() {
+    for (auto &value : values) {
+      (*results)[value.first].push_back(std::move(value.second));
+    }
+    found += values.size();
+  };
+
+  // the internal pages of the last optimistic descent, which the next one starts from
+  std::vector<std::pair<BasicPageGuard, uint64_t>> path;
+  for (size_t first = 0; first < keys.size();) {
+    if (first > 0 && comparator_(keys[first], keys[first - 1]) < 0) {
+      path.clear();
+    }
+    // as GetValue does, read the leaf of the first key without latching it, and keep what was found on it only if no
+    // writer changed the leaf meanwhile
+    bool done = false;
+    for (int attempt = 0; btree_optimistic_reads && latch_protocol_ == BTreeLatchProtocol::CRABBING &&
+                          attempt < OPTIMISTIC_READ_ATTEMPTS && !done;
+         attempt++) {
+      BasicPageGuard leaf_guard;
+      uint64_t version;
+      if (!OPTIMISTIC_FindLeafPage(keys[first], &path, &leaf_guard, &version)) {
+        continue;
+      }
+      if (!leaf_guard.IsValid()) {
+        return found;
+      }
+      size_t next = lookup_run(leaf_guard.As<LeafPage>(), first);
+      if (leaf_guard.ValidateOptimisticRead(version)) {
+        keep_values();
+        first = next;
+        done = true;
+      }
+    }
+    if (done) {
+      continue;
+    }
+
+    path.clear();
+    ReadPageGuard leaf_guard = READ_FindLeafPage(keys[first], false, transaction);
+    if (!leaf_guard.IsValid()) {
+      return found;
+    }
+    first = lookup_run(leaf_guard.As<LeafPage>(), first);
+    keep_values();
+  }
+  return found;
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -94,6 +188,13 @@ INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
   // 1. if empty start new tree
   // 2. insert - ok = no duplicate
+  if (key_size_ != 0 &&
+      BPlusTreePage::SignificantLength(reinterpret_cast<const char *>(&key), sizeof(KeyType)) > key_size_) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "key wider than the key size of a compressed B+ tree");
+  }
+  if (latch_protocol_ == BTreeLatchProtocol::BLINK) {
+    return BLINK_Insert(key, value);
+  }
   return InsertIntoLeaf(key, value, transaction);
 }
 
@@ -106,17 +207,15 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
   // ask for new root page
-  auto *root_page = new_rootL(true);
+  WritePageGuard root_guard = new_rootL(true);
 
   // init new tree (as leaf)
-  auto *root_node = reinterpret_cast<LeafPage *>(root_page->GetData());
-  root_node->Init(root_page_id_, INVALID_PAGE_ID, leaf_max_size_);
+  auto *root_node = root_guard.AsMut<LeafPage>();
+  root_node->Init(root_page_id_, INVALID_PAGE_ID, leaf_max_size_, key_size_);
+  root_level_ = 0;
 
   // insert; do not need to handle duplicate
   root_node->Insert(key, value, comparator_);
-
-  // done using; mark dirty
-  buffer_pool_manager_->UnpinPage(root_node->GetPageId(), true);
 }
 
 /*
@@ -127,42 +226,99 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
-/*NOTE: for insert, if a node is modified, its ancestor also got modified if the ancestor in transaction*/
+/*NOTE: for insert, the ancestors still in the context are the ones a split may modify*/
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  // fetch - page hold WRITE latch
-  auto *page = WRITE_FindLeafPage(key, value, false, WType::INSERT, transaction);
-  if (page == nullptr) {  // started a new tree
+  // most inserts do not split; try with only the leaf write latched first
+  if (btree_optimistic_writes) {
+    WritePageGuard leaf_guard = OPTIMISTIC_WRITE_FindLeafPage(key);
+    if (leaf_guard.IsValid()) {
+      ValueType val;
+      if (leaf_guard.As<LeafPage>()->Lookup(key, &val, comparator_)) {
+        optimistic_writes_++;
+        return false;
+      }
+      if (isSafe(WType::INSERT, leaf_guard.As<BPlusTreePage>(), key)) {
+        leaf_guard.AsMut<LeafPage>()->Insert(key, value, comparator_);
+        optimistic_writes_++;
+        return true;
+      }
+    }
+    write_restarts_++;
+  }
+
+  // fetch - leaf holds WRITE latch
+  Context ctx;
+  if (!WRITE_FindLeafPage(key, value, false, WType::INSERT, &ctx)) {  // started a new tree
     return true;
   }
+  WritePageGuard &leaf_guard = ctx.write_set_.back();
 
   // check if duplicate
-  auto *leaf_page_node = reinterpret_cast<LeafPage *>(page->GetData());
   ValueType val;
-  bool exist = leaf_page_node->Lookup(key, &val, comparator_);
-  if (exist) {
-    release_N_unPin(leaf_page_node->GetPageId(), page, transaction, false);  // page, ancestor not dirty
+  if (leaf_guard.As<LeafPage>()->Lookup(key, &val, comparator_)) {
+    release(&ctx);
     return false;
   }
 
-  // insert
-  auto new_size = leaf_page_node->Insert(key, value, comparator_);
-
-  // if full, split leaf node - now parent latch must been held
-  if (new_size >= leaf_page_node->GetMaxSize()) {
-    LeafPage *new_leaf_page_node = Split(leaf_page_node);
-    auto partition_key = new_leaf_page_node->KeyAt(0);  // partition key
-
+  // insert; if it splits the leaf, the parent latch must have been held
+  auto *leaf_page_node = leaf_guard.AsMut<LeafPage>();
+  KeyType partition_key;
+  BasicPageGuard new_leaf_guard = InsertIntoPage(leaf_page_node, key, value, &partition_key);
+  if (new_leaf_guard.IsValid()) {
     // recursively insert parent
-    InsertIntoParent(leaf_page_node, partition_key, new_leaf_page_node, transaction);
-    buffer_pool_manager_->UnpinPage(new_leaf_page_node->GetPageId(), true);
+    InsertIntoParent(leaf_page_node, partition_key, new_leaf_guard.AsMut<LeafPage>(), &ctx);
   }
 
-  // done using; mark dirty;
-  release_N_unPin(leaf_page_node->GetPageId(), page, transaction, true);  // page, ancestor dirty
+  release(&ctx);
   return true;
 }
 
+/*
+ * Insert into a write latched page, and split it if it becomes full. A compressed page that would need wider entries
+ * for the key than it has room for splits first, and the key goes into the half it belongs to.
+ * @return: the page the split created, invalid if there was none; partition_key is set to its lowest key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+BasicPageGuard BPLUSTREE_TYPE::InsertIntoPage(LeafPage *leaf, const KeyType &key, const ValueType &value,
+                                              KeyType *partition_key) {
+  if (leaf->HasRoomFor(key)) {
+    if (leaf->Insert(key, value, comparator_) < leaf->GetMaxSize()) {
+      return {};
+    }
+    BasicPageGuard new_leaf_guard = Split(leaf);
+    *partition_key = new_leaf_guard.As<LeafPage>()->KeyAt(0);
+    return new_leaf_guard;
+  }
+  BasicPageGuard new_leaf_guard = Split(leaf);
+  auto *new_leaf = new_leaf_guard.AsMut<LeafPage>();
+  *partition_key = new_leaf->KeyAt(0);
+  (comparator_(key, *partition_key) < 0 ? leaf : new_leaf)->Insert(key, value, comparator_);
+  return new_leaf_guard;
+}
+
+/*
+ * Insert key & new_value after old_value into a write latched internal page, as InsertIntoPage does for leaves; the
+ * partition key is read before the key goes in, since a compressed page keeps its first key only until then
+ */
+INDEX_TEMPLATE_ARGUMENTS
+BasicPageGuard BPLUSTREE_TYPE::InsertIntoPage(InternalPage *node, page_id_t old_value, const KeyType &key,
+                                              page_id_t new_value, KeyType *partition_key) {
+  if (node->HasRoomFor(key)) {
+    if (node->InsertNodeAfter(old_value, key, new_value) < node->GetMaxSize()) {
+      return {};
+    }
+    BasicPageGuard new_node_guard = Split(node);
+    *partition_key = new_node_guard.As<InternalPage>()->KeyAt(0);
+    return new_node_guard;
+  }
+  BasicPageGuard new_node_guard = Split(node);
+  auto *new_node = new_node_guard.AsMut<InternalPage>();
+  *partition_key = new_node->KeyAt(0);
+  (new_node->ValueIndex(old_value) == -1 ? node : new_node)->InsertNodeAfter(old_value, key, new_value);
+  return new_node_guard;
+}
+
 /*
 // no need to hold latch for newly split page here
 // because it is the right sibling,
@@ -170,33 +326,38 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
 /*WHen this is called, its left and parent have latch, so it is safe not to hold latch*/
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-N *BPLUSTREE_TYPE::Split(N *node) {
+BasicPageGuard BPLUSTREE_TYPE::Split(N *node) {
   BPlusTreePage *p = reinterpret_cast<BPlusTreePage *>(node);
 
   // new page
   page_id_t page_id;
-  auto *page = new_page(&page_id);
+  BasicPageGuard guard = new_page(&page_id);
   if (p->IsLeafPage()) {
-    LeafPage *tmp_n = reinterpret_cast<LeafPage *>(page->GetData());
+    LeafPage *tmp_n = guard.AsMut<LeafPage>();
     LeafPage *tmp = reinterpret_cast<LeafPage *>(p);
-    tmp_n->Init(page_id, p->GetParentPageId(), p->GetMaxSize());
+    tmp_n->Init(page_id, p->GetParentPageId(), p->GetMaxSize(), key_size_);
 
-    // move key & val pairs
+    // move key & val pairs; the new page takes over the right link and high key
     tmp->MoveHalfTo(tmp_n);
-    auto pid = tmp->GetNextPageId();
+    tmp_n->SetNextPageId(tmp->GetNextPageId());
+    tmp_n->SetHighKey(tmp->GetHighKey());
     tmp->SetNextPageId(tmp_n->GetPageId());
-    tmp_n->SetNextPageId(pid);
+    tmp->SetHighKey(tmp_n->KeyAt(0));
   } else {
-    InternalPage *tmp_n = reinterpret_cast<InternalPage *>(page->GetData());
+    InternalPage *tmp_n = guard.AsMut<InternalPage>();
     InternalPage *tmp = reinterpret_cast<InternalPage *>(p);
-    tmp_n->Init(page_id, p->GetParentPageId(), p->GetMaxSize());
+    tmp_n->Init(page_id, p->GetParentPageId(), p->GetMaxSize(), key_size_);
 
-    // move key & val pairs
-    tmp->MoveHalfTo(tmp_n, buffer_pool_manager_);
+    // move key & val pairs; B-link trees do not keep parent page ids, so the children are not adopted
+    tmp->MoveHalfTo(tmp_n, latch_protocol_ == BTreeLatchProtocol::BLINK ? nullptr : buffer_pool_manager_);
+    tmp_n->SetNextPageId(tmp->GetNextPageId());
+    tmp_n->SetHighKey(tmp->GetHighKey());
+    tmp->SetNextPageId(tmp_n->GetPageId());
+    tmp->SetHighKey(tmp_n->KeyAt(0));
   }
 
-  // new page wull be used by caller, dont Unpin
-  return reinterpret_cast<N *>(page->GetData());
+  // new page will be used by caller, who releases it with the guard
+  return guard;
 }
 
 /*
@@ -211,45 +372,128 @@ N *BPLUSTREE_TYPE::Split(N *node) {
 /*NOTE: when this is called, parent must hold latch*/
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                                      Transaction *transaction) {
-  // ensure parent in transaction
-  // check_parent(old_node, transaction);
-
+                                      Context *ctx) {
   // root - terminate recursion
   if (old_node->IsRootPage()) {
-    auto *root_page = new_rootL(false);
+    WritePageGuard root_guard = new_rootL(false);
 
     // init new root (as internal)
-    auto *root_node = reinterpret_cast<InternalPage *>(root_page->GetData());
-    root_node->Init(root_page_id_, INVALID_PAGE_ID, internal_max_size_);
+    auto *root_node = root_guard.AsMut<InternalPage>();
+    root_node->Init(root_page_id_, INVALID_PAGE_ID, internal_max_size_, key_size_);
 
     // adopt
     root_node->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
     old_node->SetParentPageId(root_page_id_);
     new_node->SetParentPageId(root_page_id_);
-
-    // done using; dirty
-    buffer_pool_manager_->UnpinPage(root_node->GetPageId(), true);
+    root_level_++;
     return;
   }
 
-  // otherwise fetch parent page
-  auto parent_id = old_node->GetParentPageId();
-  auto *page = fetch_page(parent_id);  // latch is hold
-  auto *parent_page_node = reinterpret_cast<InternalPage *>(page->GetData());
-
-  // close - mark dirty - parent must in transactions
-  buffer_pool_manager_->UnpinPage(parent_page_node->GetPageId(), true);
+  // otherwise the parent is latched in the context
+  WritePageGuard &parent_guard = get_parent(old_node, ctx);
+  auto *parent_page_node = parent_guard.AsMut<InternalPage>();
 
   // insert into parent, adopt
-  auto new_size = parent_page_node->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+  KeyType partition_key;
+  BasicPageGuard new_parent_guard =
+      InsertIntoPage(parent_page_node, old_node->GetPageId(), key, new_node->GetPageId(), &partition_key);
 
   // recursive check
-  if (new_size >= parent_page_node->GetMaxSize()) {
-    auto *new_parent_page_node = Split(parent_page_node);
-    auto partition_key = new_parent_page_node->KeyAt(0);  // partition key
-    InsertIntoParent(parent_page_node, partition_key, new_parent_page_node, transaction);
-    buffer_pool_manager_->UnpinPage(new_parent_page_node->GetPageId(), true);
+  if (new_parent_guard.IsValid()) {
+    auto *new_parent_page_node = new_parent_guard.AsMut<InternalPage>();
+    // a parent that split before it took new_node did not adopt it
+    if (new_parent_page_node->ValueIndex(new_node->GetPageId()) != -1) {
+      new_node->SetParentPageId(new_parent_page_node->GetPageId());
+    }
+    InsertIntoParent(parent_page_node, partition_key, new_parent_page_node, ctx);
+  }
+}
+
+/*
+ * Insert into a B-link tree: find the leaf without holding more than one latch at a time, write latch it, and move
+ * right if it split since the descent read its parent. A split leaf is released only once its parent is latched.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::BLINK_Insert(const KeyType &key, const ValueType &value) {
+  // B-link trees never become empty again once they have a root
+  if (IsEmpty()) {
+    std::scoped_lock root_lock(mu_);
+    if (IsEmpty()) {
+      StartNewTree(key, value);
+      return true;
+    }
+  }
+
+  std::vector<page_id_t> path;
+  WritePageGuard leaf_guard = fetch_page(BLINK_FindLeafPage(key, false, &path)).UpgradeWrite();
+  while (BLINK_MoveRight(leaf_guard.As<LeafPage>(), key)) {
+    leaf_guard = fetch_page(leaf_guard.As<LeafPage>()->GetNextPageId()).UpgradeWrite();
+  }
+
+  // check if duplicate
+  ValueType val;
+  if (leaf_guard.As<LeafPage>()->Lookup(key, &val, comparator_)) {
+    return false;
+  }
+
+  KeyType partition_key;
+  BasicPageGuard new_leaf_guard = InsertIntoPage(leaf_guard.AsMut<LeafPage>(), key, value, &partition_key);
+  if (!new_leaf_guard.IsValid()) {
+    return true;
+  }
+  page_id_t new_leaf_id = new_leaf_guard.PageId();
+  new_leaf_guard.Drop();
+  BLINK_InsertIntoParent(std::move(leaf_guard), partition_key, new_leaf_id, &path);
+  return true;
+}
+
+/*
+ * Link the page a B-link split created into the parent of the page that split
+ * @param   child_guard   the page that split, write latched until its parent is
+ * @param   path          the internal pages the descent to the child went through, root first; the parent is the last
+ * of them or a page to its right, unless the root grew since
+ * Latches are taken bottom-up and left to right, so splits cannot deadlock.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BLINK_InsertIntoParent(WritePageGuard child_guard, KeyType key, page_id_t new_page_id,
+                                            std::vector<page_id_t> *path) {
+  for (int level = 0;; level++) {
+    page_id_t child_id = child_guard.PageId();
+    if (path->empty()) {
+      std::unique_lock<std::mutex> root_lock(mu_);
+      // the child is the root - grow the tree
+      if (root_page_id_ == child_id) {
+        WritePageGuard root_guard = new_rootL(false);
+        auto *root_node = root_guard.AsMut<InternalPage>();
+        root_node->Init(root_page_id_, INVALID_PAGE_ID, internal_max_size_, key_size_);
+        root_node->PopulateNewRoot(child_id, key, new_page_id);
+        root_level_++;
+        return;
+      }
+      // another split grew the tree above the child; find the way down from the new root
+      page_id_t root_page_id = root_page_id_;
+      int root_level = root_level_;
+      root_lock.unlock();
+      BLINK_FindPath(key, root_page_id, root_level, level, path);
+    }
+
+    WritePageGuard parent_guard = fetch_page(path->back()).UpgradeWrite();
+    path->pop_back();
+    while (BLINK_MoveRight(parent_guard.As<InternalPage>(), key)) {
+      parent_guard = fetch_page(parent_guard.As<InternalPage>()->GetNextPageId()).UpgradeWrite();
+    }
+    child_guard.Drop();
+
+    KeyType partition_key;
+    BasicPageGuard new_parent_guard =
+        InsertIntoPage(parent_guard.AsMut<InternalPage>(), child_id, key, new_page_id, &partition_key);
+    if (!new_parent_guard.IsValid()) {
+      return;
+    }
+    key = partition_key;
+    new_page_id = new_parent_guard.PageId();
+    new_parent_guard.Drop();
+    child_guard = std::move(parent_guard);
   }
 }
 
@@ -265,40 +509,74 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
-  // check_txns(transaction);
+  if (latch_protocol_ == BTreeLatchProtocol::BLINK) {
+    BLINK_Remove(key);
+    return;
+  }
 
-  // fetch - page hold WRITE latch -
+  // most removes do not merge; try with only the leaf write latched first
   ValueType v;
-  auto *page = WRITE_FindLeafPage(key, v, false, WType::DELETE, transaction);
-  if (page == nullptr) {  // nullptr - empty tree - return immediately
+  if (btree_optimistic_writes) {
+    WritePageGuard leaf_guard = OPTIMISTIC_WRITE_FindLeafPage(key);
+    if (leaf_guard.IsValid()) {
+      if (!leaf_guard.As<LeafPage>()->Lookup(key, &v, comparator_)) {
+        optimistic_writes_++;
+        return;
+      }
+      if (isSafe(WType::DELETE, leaf_guard.As<BPlusTreePage>(), key)) {
+        leaf_guard.AsMut<LeafPage>()->RemoveAndDeleteRecord(key, comparator_);
+        optimistic_writes_++;
+        return;
+      }
+    }
+    write_restarts_++;
+  }
+
+  // fetch - leaf holds WRITE latch
+  Context ctx;
+  if (!WRITE_FindLeafPage(key, v, false, WType::DELETE, &ctx)) {  // empty tree - return immediately
     return;
   }
-  auto *leaf_page_node = reinterpret_cast<LeafPage *>(page->GetData());
+  WritePageGuard &leaf_guard = ctx.write_set_.back();
 
-  // delete
-  int original_size = leaf_page_node->GetSize();
-  int remain_size = leaf_page_node->RemoveAndDeleteRecord(key, comparator_);
-  bool has_modify = (original_size != remain_size);
-  if (!has_modify) {
-    release_N_unPin(leaf_page_node->GetPageId(), page, transaction,
-                    false);  // page, ancestor not dirty - release and free
+  // nothing to delete - page and ancestors stay clean
+  if (!leaf_guard.As<LeafPage>()->Lookup(key, &v, comparator_)) {
+    release(&ctx);
     return;
   }
 
+  // delete
+  auto *leaf_page_node = leaf_guard.AsMut<LeafPage>();
+  int remain_size = leaf_page_node->RemoveAndDeleteRecord(key, comparator_);
+
   // redist or merge
-  bool should_delete = false;
-  if (remain_size < leaf_page_node->GetMinSize()) {
-    should_delete = CoalesceOrRedistribute(leaf_page_node, transaction);
+  if (remain_size < leaf_page_node->GetMinSize() && CoalesceOrRedistribute(leaf_page_node, &ctx)) {
+    ctx.deleted_pages_.push_back(leaf_page_node->GetPageId());
+  }
+
+  // close - and ancestor; deletion is addressed once everything is released
+  release(&ctx);
+}
+
+/*
+ * Delete from a B-link tree: the entry leaves its leaf and nothing else changes. Leaves may run empty; they keep
+ * their place in the tree and take new keys in their range.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BLINK_Remove(const KeyType &key) {
+  page_id_t leaf_id = BLINK_FindLeafPage(key, false, nullptr);
+  if (leaf_id == INVALID_PAGE_ID) {
+    return;
+  }
+  WritePageGuard leaf_guard = fetch_page(leaf_id).UpgradeWrite();
+  while (BLINK_MoveRight(leaf_guard.As<LeafPage>(), key)) {
+    leaf_guard = fetch_page(leaf_guard.As<LeafPage>()->GetNextPageId()).UpgradeWrite();
   }
 
-  // close - and ancestor
-  release_N_unPin(leaf_page_node->GetPageId(), page, transaction,
-                  true);  // page, ancestor dirty - del will be addressed
-  if (should_delete) {
-    // if (page->GetPinCount() != 0) {
-    //   LOG_ERROR("%d - %d - %d", page->GetPageId(), page->GetPinCount(), root_page_id_);
-    // }
-    buffer_pool_manager_->DeletePage(leaf_page_node->GetPageId());
+  // nothing to delete - page stays clean
+  ValueType v;
+  if (leaf_guard.As<LeafPage>()->Lookup(key, &v, comparator_)) {
+    leaf_guard.AsMut<LeafPage>()->RemoveAndDeleteRecord(key, comparator_);
   }
 }
 
@@ -312,33 +590,43 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
 /*when this is called, node and its parent has latch*/
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
-  // ensure parent in transaction
-  // check_parent(node, transaction);
-
+bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Context *ctx) {
   // root - termination of recursion
   if (node->IsRootPage()) {
     return AdjustRoot(node);
   }
 
   // get parent - and we must have its latch
-  auto *parent_page = fetch_page(node->GetParentPageId());
-  auto *parent_node = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  WritePageGuard &parent_guard = get_parent(node, ctx);
+  auto *parent_node = parent_guard.AsMut<InternalPage>();
+  // a compressed parent that had no room for a separator may be left with node as its only child
+  if (parent_node->GetSize() < 2) {
+    return false;
+  }
   int cur_index = parent_node->ValueIndex(node->GetPageId());
 
-  // close - parent still in transaction
-  buffer_pool_manager_->UnpinPage(parent_node->GetPageId(), true);
-
-  // get sibling - and latch
-  auto *sibling_page = get_sibling(cur_index, parent_node);
-  sibling_page->WLatch();
-  transaction->AddIntoPageSet(sibling_page);
-  auto *sibling_node = reinterpret_cast<N *>(sibling_page->GetData());
-
-  // redist - not del me nor sibling
-  if (sibling_node->GetSize() + node->GetSize() > node->GetMaxSize()) {
-    // no recursion within callee
-    Redistribute(sibling_node, node, cur_index);
+  // get sibling - if node is leftmost, get right sibling - otherwise get left sibling - and latch
+  page_id_t sib_id = parent_node->ValueAt(cur_index == 0 ? 1 : cur_index - 1);
+  ctx->write_set_.push_back(fetch_page(sib_id).UpgradeWrite());
+  WritePageGuard &sibling_guard = ctx->write_set_.back();
+  auto *sibling_node = sibling_guard.AsMut<N>();
+
+  // redist - not del me nor sibling; a merged node must stay below max size, since inserts split at max size
+  N *left = cur_index == 0 ? node : sibling_node;
+  N *right = cur_index == 0 ? sibling_node : node;
+  int separator_index = cur_index == 0 ? 1 : cur_index;
+  bool can_merge =
+      node->IsLeafPage()
+          ? reinterpret_cast<LeafPage *>(left)->CanMerge(reinterpret_cast<LeafPage *>(right))
+          : reinterpret_cast<InternalPage *>(left)->CanMerge(reinterpret_cast<InternalPage *>(right),
+                                                             parent_node->KeyAt(separator_index));
+  if (!can_merge) {
+    // no recursion within callee; a compressed parent may have no room for the new separator, and the pages then
+    // stay as they are
+    auto separator = cur_index == 0 ? sibling_node->KeyAt(1) : sibling_node->KeyAt(sibling_node->GetSize() - 1);
+    if (parent_node->CanSetKeyAt(separator_index, separator)) {
+      Redistribute(sibling_node, node, parent_node, cur_index);
+    }
     return false;
   }
 
@@ -347,15 +635,15 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
   // either del me or sibling
   bool node_should_delete = false;
   if (cur_index == 0) {
-    transaction->AddIntoDeletedPageSet(sibling_node->GetPageId());
+    ctx->deleted_pages_.push_back(sibling_node->GetPageId());
   } else {
     node_should_delete = true;  // sibling <- me; delete me
   }
   // maybe recursion within callee
-  bool parent_should_del = Coalesce(sibling_node, node, parent_node, cur_index, transaction);
+  bool parent_should_del = Coalesce(sibling_node, node, parent_node, cur_index, ctx);
   // del
   if (parent_should_del) {  // need to del parent page here
-    transaction->AddIntoDeletedPageSet(parent_node->GetPageId());
+    ctx->deleted_pages_.push_back(parent_node->GetPageId());
   }
   return node_should_delete;
 }
@@ -376,7 +664,7 @@ INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 bool BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node,
                               BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent, int index,
-                              Transaction *transaction) {
+                              Context *ctx) {
   BPlusTreePage *p = reinterpret_cast<BPlusTreePage *>(node);
   BPlusTreePage *p_n = reinterpret_cast<BPlusTreePage *>(neighbor_node);
   auto isLeaf = p->IsLeafPage();
@@ -414,7 +702,7 @@ bool BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node,
 
   // recursively check parent - now parent is 'leaf'
   if (parent->GetSize() < parent->GetMinSize()) {
-    return CoalesceOrRedistribute(parent, transaction);
+    return CoalesceOrRedistribute(parent, ctx);
   }
   return false;  // if parent is fine, then do not delete parent
 }
@@ -427,16 +715,11 @@ bool BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node,
  * Using template N to represent either internal page or leaf page.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
+ * @param   parent_node        parent page of input "node"
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
-  // get parent
-  auto *parent_page = fetch_page(node->GetParentPageId());
-  auto *parent_node = reinterpret_cast<InternalPage *>(parent_page->GetData());
-  // close - because parent must in transaction
-  buffer_pool_manager_->UnpinPage(parent_node->GetPageId(), true);
-
+void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, InternalPage *parent_node, int index) {
   BPlusTreePage *p = reinterpret_cast<BPlusTreePage *>(node);
   BPlusTreePage *p_n = reinterpret_cast<BPlusTreePage *>(neighbor_node);
 
@@ -450,9 +733,11 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
     if (index == 0) {  // neighbor at my right
       parent_node->SetKeyAt(1, tmp_n->KeyAt(1));
       tmp_n->MoveFirstToEndOf(tmp);
+      tmp->SetHighKey(parent_node->KeyAt(1));
     } else {
       parent_node->SetKeyAt(index, tmp_n->KeyAt(tmp_n->GetSize() - 1));
       tmp_n->MoveLastToFrontOf(tmp);
+      tmp_n->SetHighKey(parent_node->KeyAt(index));
     }
   } else {
     // resolve internal page type
@@ -464,10 +749,12 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
       auto middle_key = parent_node->KeyAt(1);
       parent_node->SetKeyAt(1, tmp_n->KeyAt(1));
       tmp_n->MoveFirstToEndOf(tmp, middle_key, buffer_pool_manager_);
+      tmp->SetHighKey(parent_node->KeyAt(1));
     } else {
       auto middle_key = parent_node->KeyAt(index);
       parent_node->SetKeyAt(index, tmp_n->KeyAt(tmp_n->GetSize() - 1));
       tmp_n->MoveLastToFrontOf(tmp, middle_key, buffer_pool_manager_);
+      tmp_n->SetHighKey(parent_node->KeyAt(index));
     }
   }
 }
@@ -485,7 +772,6 @@ INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
   // case 2
   if (old_root_node->IsLeafPage()) {
-    // LOG_DEBUG("adj %d - %d - %d", old_root_node->GetPageId(), root_page_id_, old_root_node->GetSize());
     bool should_del = (old_root_node->GetSize() == 0);
     if (should_del) {
       root_page_id_ = INVALID_PAGE_ID;
@@ -503,20 +789,15 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
   auto *tmp_old = reinterpret_cast<InternalPage *>(old_root_node);
   page_id_t val = tmp_old->RemoveAndReturnOnlyChild();
 
-  // LOG_DEBUG("switch from: %d - to: %d", root_page_id_, val);
-
-  // switch root to its only child
-  auto *page = fetch_page(val);
-  auto *tmp = reinterpret_cast<BPlusTreePage *>(page->GetData());
-  tmp->SetParentPageId(INVALID_PAGE_ID);
+  // switch root to its only child; mark dirty
+  BasicPageGuard child_guard = fetch_page(val);
+  child_guard.AsMut<BPlusTreePage>()->SetParentPageId(INVALID_PAGE_ID);
 
   // switch
   root_page_id_ = val;
+  root_level_--;
   UpdateRootPageId(false);
 
-  // mark dirty
-  buffer_pool_manager_->UnpinPage(val, true);
-
   return true;
 }
 
@@ -530,14 +811,8 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::begin() {
-  // return INDEXITERATOR_TYPE();
   KeyType k;
-  auto *page = READ_FindLeafPage(k, true);
-  if (page == nullptr) {
-    return INDEXITERATOR_TYPE(nullptr, buffer_pool_manager_, -1);
-  }
-  auto *leaf_page_node = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
-  return INDEXITERATOR_TYPE(leaf_page_node, buffer_pool_manager_, 0);
+  return INDEXITERATOR_TYPE(this, READ_FindLeafPage(k, true), 0, nullptr, false);
 }
 
 /*
@@ -547,14 +822,12 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::begin() {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
-  // return INDEXITERATOR_TYPE();
-
-  auto *page = READ_FindLeafPage(key, false);
-  if (page == nullptr) {
-    return INDEXITERATOR_TYPE(nullptr, buffer_pool_manager_, -1);
+  ReadPageGuard leaf_guard = READ_FindLeafPage(key, false);
+  if (!leaf_guard.IsValid()) {
+    return end();
   }
-  auto *leaf_page_node = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
-  return INDEXITERATOR_TYPE(leaf_page_node, buffer_pool_manager_, leaf_page_node->KeyIndex(key, comparator_));
+  int index = leaf_guard.As<LeafPage>()->KeyIndex(key, comparator_);
+  return INDEXITERATOR_TYPE(this, std::move(leaf_guard), index, nullptr, false);
 }
 
 /*
@@ -563,196 +836,437 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::end() { return INDEXITERATOR_TYPE(nullptr, buffer_pool_manager_, -1); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::end() { return INDEXITERATOR_TYPE(ReadPageGuard(), buffer_pool_manager_, -1); }
+
+/*
+ * Input parameters are the bounds of the range, either of which may be null, construct an index iterator that starts
+ * at the first key in the range, or at the last if it is reverse, and ends at the other bound
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Range(const KeyType *low, const KeyType *high, bool reverse) {
+  int index = 0;
+  ReadPageGuard leaf_guard;
+  if (reverse) {
+    leaf_guard = READ_FindLeafPageBefore(high, &index);
+  } else {
+    leaf_guard = READ_FindLeafPage(low != nullptr ? *low : KeyType{}, low == nullptr);
+    if (leaf_guard.IsValid() && low != nullptr) {
+      index = leaf_guard.As<LeafPage>()->KeyIndex(*low, comparator_);
+    }
+  }
+  if (!leaf_guard.IsValid()) {
+    return end();
+  }
+  return INDEXITERATOR_TYPE(this, std::move(leaf_guard), index, reverse ? low : high, reverse);
+}
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
  *****************************************************************************/
 INDEX_TEMPLATE_ARGUMENTS
-Page *BPLUSTREE_TYPE::new_page(page_id_t *pid) {
-  auto *page = buffer_pool_manager_->NewPage(pid);
-  if (page == nullptr) {
-    throw Exception(ExceptionType::INVALID, "new page");
+BasicPageGuard BPLUSTREE_TYPE::new_page(page_id_t *pid) {
+  BasicPageGuard guard = buffer_pool_manager_->NewPageGuarded(pid, page_size_class_);
+  if (!guard.IsValid()) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "new page");
   }
-  return page;
+  return guard;
 }
+
 INDEX_TEMPLATE_ARGUMENTS
-Page *BPLUSTREE_TYPE::fetch_page(page_id_t pid) {
-  auto *page = buffer_pool_manager_->FetchPage(pid);
-  // if (page->GetPageId() != pid) {
-  //  LOG_DEBUG("fetch_page %d - %d", pid, page->GetPageId());
-  //  throw Exception(ExceptionType::INVALID, "new page");
-  //}
-  if (page == nullptr) {
+BasicPageGuard BPLUSTREE_TYPE::fetch_page(page_id_t pid) {
+  BasicPageGuard guard = buffer_pool_manager_->FetchPageBasic(pid);
+  if (!guard.IsValid()) {
     throw Exception(ExceptionType::OUT_OF_MEMORY, "out of mem");
   }
-  return page;
+  return guard;
 }
 
+// the parent of a node that is being changed is always among the ancestors the context still holds
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::check_parent(BPlusTreePage *node, Transaction *transaction) {
-  if (node->IsRootPage()) {
-    return;
-  }
-  if (!is_pid_in_txns(transaction, node->GetParentPageId())) {
-    // LOG_ERROR("check parent %d %d", node->GetPageId(), node->GetParentPageId());
-    throw Exception(ExceptionType::INVALID, "check_parent");
+WritePageGuard &BPLUSTREE_TYPE::get_parent(const BPlusTreePage *node, Context *ctx) {
+  page_id_t parent_id = node->GetParentPageId();
+  for (auto it = ctx->write_set_.rbegin(); it != ctx->write_set_.rend(); ++it) {
+    if (it->PageId() == parent_id) {
+      return *it;
+    }
   }
+  throw Exception(ExceptionType::INVALID, "get_parent");
 }
 
+// the new root is write latched before it is published, so optimistic readers cannot see it half initialized
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::is_pid_in_txns(Transaction *transaction, page_id_t pid) {
-  std::shared_ptr<std::deque<Page *>> page_set = transaction->GetPageSet();
-  for (auto &i : *page_set) {
-    if (i == nullptr) {
-      continue;
-    }
-    auto *tmp = reinterpret_cast<BPlusTreePage *>(i->GetData());
-    // if (tmp->GetPageId() != i->GetPageId()) {
-    //  LOG_ERROR("is_pid_in_txns %d %d", tmp->GetPageId(), i->GetPageId());
-    //}
-    if (tmp->GetPageId() == pid) {
-      return true;
-    }
-  }
-  return false;
+WritePageGuard BPLUSTREE_TYPE::new_rootL(bool new_tree) {
+  page_id_t root_page_id;
+  WritePageGuard guard = new_page(&root_page_id).UpgradeWrite();
+  root_page_id_ = root_page_id;
+  UpdateRootPageId(new_tree);  // insert header page (meta data) - true for start a new tree
+  return guard;
 }
 
+// Optimistic lock coupling: descend without latching, reading each page between TryOptimisticRead and
+// ValidateOptimisticRead. A child id is only followed once the parent validates, and the parent is validated again
+// after the child's version is taken, so the child was still the parent's child when its read began. Pages stay
+// pinned while they are read, so their frames cannot be reused underneath; writers bump the versions.
+// @return: false if a writer got in the way and the descent has to restart; otherwise the pinned leaf, invalid if the
+// tree is empty, and the version to validate reads of the leaf against
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::check_txns(Transaction *transaction) {
-  if (!transaction->GetPageSet()->empty()) {
-    throw Exception(ExceptionType::INVALID, "check_txns");
+bool BPLUSTREE_TYPE::OPTIMISTIC_FindLeafPage(const KeyType &key, bool leftMost, BasicPageGuard *leaf,
+                                             uint64_t *version) {
+  page_id_t root_page_id = root_page_id_;
+  if (root_page_id == INVALID_PAGE_ID) {
+    *leaf = BasicPageGuard();
+    return true;
   }
-  if (!transaction->GetDeletedPageSet()->empty()) {
-    throw Exception(ExceptionType::INVALID, "check_txns");
+  BasicPageGuard guard = fetch_page(root_page_id);
+  uint64_t node_version;
+  // the page may have stopped being the root before it was pinned
+  if (!guard.TryOptimisticRead(&node_version) || root_page_id_ != root_page_id) {
+    return false;
+  }
+
+  for (;;) {
+    bool is_leaf = guard.As<BPlusTreePage>()->IsLeafPage();
+    if (!guard.ValidateOptimisticRead(node_version)) {
+      return false;
+    }
+    if (is_leaf) {
+      break;
+    }
+    auto *internal_page_node = guard.As<InternalPage>();
+    page_id_t val = (leftMost) ? internal_page_node->ValueAt(0) : internal_page_node->Lookup(key, comparator_);
+    if (!guard.ValidateOptimisticRead(node_version)) {
+      return false;
+    }
+
+    BasicPageGuard child_guard = fetch_page(val);
+    uint64_t child_version;
+    if (!child_guard.TryOptimisticRead(&child_version) || !guard.ValidateOptimisticRead(node_version)) {
+      return false;
+    }
+    guard = std::move(child_guard);
+    node_version = child_version;
   }
+  *leaf = std::move(guard);
+  *version = node_version;
+  return true;
 }
 
-// get sibling - if node is leftmost, get right sibling - otherwise get left sibling
+// The optimistic descent of a lookup that follows another one, for a key not less than the one before: path holds the
+// internal pages that descent went through, pinned, with their versions. The descent starts again at the lowest of
+// them whose keys reach up to key, which it validates first, rather than at the root, and leaves its own path in path.
+// @return: as OPTIMISTIC_FindLeafPage; on false, path is emptied
 INDEX_TEMPLATE_ARGUMENTS
-Page *BPLUSTREE_TYPE::get_sibling(int index, InternalPage *parent_node) {
-  Page *sibling_page;
-  page_id_t sib_id;
-  if (index == 0) {
-    sib_id = parent_node->ValueAt(1);
+bool BPLUSTREE_TYPE::OPTIMISTIC_FindLeafPage(const KeyType &key, std::vector<std::pair<BasicPageGuard, uint64_t>> *path,
+                                             BasicPageGuard *leaf, uint64_t *version) {
+  while (!path->empty()) {
+    auto *node = path->back().first.As<InternalPage>();
+    bool covers = node->GetNextPageId() == INVALID_PAGE_ID || comparator_(key, node->GetHighKey()) < 0;
+    if (!path->back().first.ValidateOptimisticRead(path->back().second)) {
+      path->clear();
+      return false;
+    }
+    if (covers) {
+      break;
+    }
+    path->pop_back();
+  }
+
+  BasicPageGuard guard;
+  uint64_t node_version;
+  if (path->empty()) {
+    page_id_t root_page_id = root_page_id_;
+    if (root_page_id == INVALID_PAGE_ID) {
+      *leaf = BasicPageGuard();
+      return true;
+    }
+    guard = fetch_page(root_page_id);
+    if (!guard.TryOptimisticRead(&node_version) || root_page_id_ != root_page_id) {
+      return false;
+    }
   } else {
-    sib_id = parent_node->ValueAt(index - 1);
+    guard = std::move(path->back().first);
+    node_version = path->back().second;
+    path->pop_back();
   }
-  sibling_page = fetch_page(sib_id);
-  return sibling_page;
-}
 
-INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::release_N_unPin(page_id_t pid, Page *page, Transaction *transaction, bool dirty) {
-  free_ancestor(transaction, dirty);  // ancestor must be dirty, otherwise it won't be in transaction
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(pid, dirty);
-}
+  for (;;) {
+    bool is_leaf = guard.As<BPlusTreePage>()->IsLeafPage();
+    if (!guard.ValidateOptimisticRead(node_version)) {
+      path->clear();
+      return false;
+    }
+    if (is_leaf) {
+      break;
+    }
+    page_id_t val = guard.As<InternalPage>()->Lookup(key, comparator_);
+    if (!guard.ValidateOptimisticRead(node_version)) {
+      path->clear();
+      return false;
+    }
 
-INDEX_TEMPLATE_ARGUMENTS
-Page *BPLUSTREE_TYPE::new_rootL(bool new_tree) {
-  auto *page = new_page(&root_page_id_);
-  UpdateRootPageId(new_tree);  // insert header page (meta data) - true for start a new tree
-  return page;
+    BasicPageGuard child_guard = fetch_page(val);
+    uint64_t child_version;
+    if (!child_guard.TryOptimisticRead(&child_version) || !guard.ValidateOptimisticRead(node_version)) {
+      path->clear();
+      return false;
+    }
+    path->emplace_back(std::move(guard), node_version);
+    guard = std::move(child_guard);
+    node_version = child_version;
+  }
+  *leaf = std::move(guard);
+  *version = node_version;
+  return true;
 }
 
-// @return: page with read latch
+// @return: leaf with read latch, invalid if the tree is empty
 INDEX_TEMPLATE_ARGUMENTS
-Page *BPLUSTREE_TYPE::READ_FindLeafPage(const KeyType &key, bool leftMost, Transaction *transaction) {
-  Page *page;
-  Page *childPage;
-  BPlusTreePage *page_node;
-  page_id_t val;
+ReadPageGuard BPLUSTREE_TYPE::READ_FindLeafPage(const KeyType &key, bool leftMost, Transaction *transaction) {
+  // descend optimistically, then latch the leaf; if its version is unchanged, it is still the leaf for key
+  if (latch_protocol_ == BTreeLatchProtocol::BLINK) {
+    page_id_t leaf_id = BLINK_FindLeafPage(key, leftMost, nullptr);
+    if (leaf_id == INVALID_PAGE_ID) {
+      return {};
+    }
+    ReadPageGuard guard = fetch_page(leaf_id).UpgradeRead();
+    while (!leftMost && BLINK_MoveRight(guard.As<LeafPage>(), key)) {
+      guard = fetch_page(guard.As<LeafPage>()->GetNextPageId()).UpgradeRead();
+    }
+    return guard;
+  }
 
-  mu_.lock();
-  if (IsEmpty()) {
-    mu_.unlock();
-    return nullptr;
+  for (int attempt = 0; btree_optimistic_reads && attempt < OPTIMISTIC_READ_ATTEMPTS; attempt++) {
+    BasicPageGuard leaf_guard;
+    uint64_t version;
+    if (!OPTIMISTIC_FindLeafPage(key, leftMost, &leaf_guard, &version)) {
+      continue;
+    }
+    if (!leaf_guard.IsValid()) {
+      return {};
+    }
+    ReadPageGuard guard = leaf_guard.UpgradeRead();
+    if (guard.ValidateOptimisticRead(version)) {
+      return guard;
+    }
   }
 
-  page = fetch_page(root_page_id_);
-  page->RLatch();
-  page_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
-  mu_.unlock();
+  std::unique_lock<std::mutex> root_lock(mu_);
+  if (IsEmpty()) {
+    return {};
+  }
+  ReadPageGuard guard = fetch_page(root_page_id_).UpgradeRead();
+  root_lock.unlock();
 
   // if  root and leaf - new tree - return directly
   // if root ok, then recursively search
-  while (!page_node->IsLeafPage()) {
-    auto *internal_page_node = reinterpret_cast<InternalPage *>(page_node);
-    val = (leftMost) ? internal_page_node->ValueAt(0) : internal_page_node->Lookup(key, comparator_);
+  while (!guard.As<BPlusTreePage>()->IsLeafPage()) {
+    auto *internal_page_node = guard.As<InternalPage>();
+    page_id_t val = (leftMost) ? internal_page_node->ValueAt(0) : internal_page_node->Lookup(key, comparator_);
 
-    // get child
-    childPage = fetch_page(val);
-    childPage->RLatch();
+    // latch the child before the assignment releases the parent
+    guard = fetch_page(val).UpgradeRead();
+  }
+  return guard;
+}
+
+// Read latch the leaf that holds the greatest key less than key, or the greatest key of all if key is null, and set
+// *index to its position in the leaf; an invalid guard if there is no such key. The descent keeps the lowest key the
+// subtree it is in may hold, its fence: if the leaf turns out to have no key below key, because keys were removed, the
+// keys that are left below it are below the fence, and the descent starts over from there. B-link descents hold one
+// latch at a time and move right past pages whose high key is still below key; the others couple their latches.
+INDEX_TEMPLATE_ARGUMENTS
+ReadPageGuard BPLUSTREE_TYPE::READ_FindLeafPageBefore(const KeyType *key, int *index) {
+  const bool blink = latch_protocol_ == BTreeLatchProtocol::BLINK;
+  KeyType bound{};
+  bool bounded = key != nullptr;
+  if (bounded) {
+    bound = *key;
+  }
+  // whether there may be keys below bound to the right of node
+  auto move_right = [&](const auto *node) {
+    return node->GetNextPageId() != INVALID_PAGE_ID && (!bounded || comparator_(node->GetHighKey(), bound) < 0);
+  };
+
+  while (true) {
+    KeyType fence{};
+    bool fenced = false;
+    ReadPageGuard guard;
+    if (blink) {
+      page_id_t root_page_id = root_page_id_;
+      if (root_page_id == INVALID_PAGE_ID) {
+        return {};
+      }
+      guard = fetch_page(root_page_id).UpgradeRead();
+    } else {
+      std::unique_lock<std::mutex> root_lock(mu_);
+      if (IsEmpty()) {
+        return {};
+      }
+      guard = fetch_page(root_page_id_).UpgradeRead();
+    }
 
-    // release above
-    page->RUnlatch();
-    buffer_pool_manager_->UnpinPage(page_node->GetPageId(), false);
+    while (true) {
+      const bool is_leaf = guard.As<BPlusTreePage>()->IsLeafPage();
+      if (blink && (is_leaf ? move_right(guard.As<LeafPage>()) : move_right(guard.As<InternalPage>()))) {
+        fence = is_leaf ? guard.As<LeafPage>()->GetHighKey() : guard.As<InternalPage>()->GetHighKey();
+        fenced = true;
+        page_id_t next_page_id = is_leaf ? guard.As<LeafPage>()->GetNextPageId()
+                                         : guard.As<InternalPage>()->GetNextPageId();
+        guard = fetch_page(next_page_id).UpgradeRead();
+        continue;
+      }
+      if (is_leaf) {
+        break;
+      }
+      auto *internal_page_node = guard.As<InternalPage>();
+      int child = bounded ? internal_page_node->LookupBefore(bound, comparator_) : internal_page_node->GetSize() - 1;
+      if (child > 0) {
+        fence = internal_page_node->KeyAt(child);
+        fenced = true;
+      }
+      page_id_t child_id = internal_page_node->ValueAt(child);
+      if (blink) {
+        guard.Drop();
+      }
+      // latch crabbing latches the child before the assignment releases the parent
+      guard = fetch_page(child_id).UpgradeRead();
+    }
 
-    // swap
-    page = childPage;
-    page_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    auto *leaf = guard.As<LeafPage>();
+    *index = (bounded ? leaf->KeyIndex(bound, comparator_) : leaf->GetSize()) - 1;
+    if (*index >= 0) {
+      return guard;
+    }
+    if (!fenced) {
+      return {};
+    }
+    bound = fence;
+    bounded = true;
   }
-  if (page == nullptr) {
-    throw Exception(ExceptionType::INVALID, "traverse");
+}
+
+// Optimistic write descent: read latch the internal pages, coupling like READ_FindLeafPage, and write latch the leaf
+// before its parent is released. If the leaf is safe, the operation cannot change anything above it.
+// @return: the write latched leaf, or an invalid guard if the tree is empty or the root is a leaf, which may change
+// the root page id and so is left to the pessimistic descent
+INDEX_TEMPLATE_ARGUMENTS
+WritePageGuard BPLUSTREE_TYPE::OPTIMISTIC_WRITE_FindLeafPage(const KeyType &key) {
+  std::unique_lock<std::mutex> root_lock(mu_);
+  if (IsEmpty()) {
+    return {};
+  }
+  ReadPageGuard guard = fetch_page(root_page_id_).UpgradeRead();
+  root_lock.unlock();
+  if (guard.As<BPlusTreePage>()->IsLeafPage()) {
+    return {};
+  }
+
+  for (;;) {
+    page_id_t val = guard.As<InternalPage>()->Lookup(key, comparator_);
+    // a child cannot be merged away or change its type while its parent is latched
+    BasicPageGuard child_guard = fetch_page(val);
+    if (child_guard.As<BPlusTreePage>()->IsLeafPage()) {
+      return child_guard.UpgradeWrite();
+    }
+    guard = child_guard.UpgradeRead();
   }
-  return page;
 }
 
-// @return: leaf with write latch
-// if parents are not safe, they exist in transaction
+// @return: false if the tree was empty; otherwise the leaf is write latched at the back of the context, behind the
+// ancestors that are not safe
 INDEX_TEMPLATE_ARGUMENTS
-Page *BPLUSTREE_TYPE::WRITE_FindLeafPage(const KeyType &key, const ValueType &value, bool leftMost, WType op,
-                                         Transaction *transaction) {
-  Page *page;
-  Page *childPage;
-  BPlusTreePage *page_node;
-  page_id_t val;
-  mu_.lock();
+bool BPLUSTREE_TYPE::WRITE_FindLeafPage(const KeyType &key, const ValueType &value, bool leftMost, WType op,
+                                        Context *ctx) {
+  ctx->root_lock_ = std::unique_lock<std::mutex>(mu_);
   if (IsEmpty()) {
     if (op == WType::INSERT) {
       StartNewTree(key, value);
     }
-    mu_.unlock();
-    return nullptr;
+    ctx->root_lock_.unlock();
+    return false;
   }
-  transaction->AddIntoPageSet(nullptr);  // mark as mu_.lock - will be unlock in free_ancestor
 
-  page = fetch_page(root_page_id_);
-  page->WLatch();
-  page_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  ctx->write_set_.push_back(fetch_page(root_page_id_).UpgradeWrite());
 
   // traverse
-  while (!page_node->IsLeafPage()) {
-    auto *internal_page_node = reinterpret_cast<InternalPage *>(page_node);
-    val = (leftMost) ? internal_page_node->ValueAt(0) : internal_page_node->Lookup(key, comparator_);
+  for (;;) {
+    const WritePageGuard &guard = ctx->write_set_.back();
+    if (guard.As<BPlusTreePage>()->IsLeafPage()) {
+      return true;
+    }
+    auto *internal_page_node = guard.As<InternalPage>();
+    page_id_t val = (leftMost) ? internal_page_node->ValueAt(0) : internal_page_node->Lookup(key, comparator_);
 
     // get child
-    childPage = fetch_page(val);
-    childPage->WLatch();
-
-    // add current page to transactions
-    transaction->AddIntoPageSet(page);
-
-    // traverse
-    page = childPage;
-    page_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    ctx->write_set_.push_back(fetch_page(val).UpgradeWrite());
+    const WritePageGuard &child_guard = ctx->write_set_.back();
 
     // check
-    if (isSafe(op, page_node)) {
-      free_ancestor(transaction, false);
+    if (isSafe(op, child_guard.As<BPlusTreePage>(), key)) {
+      free_ancestor(ctx);
     }
   }
-  if (page == nullptr) {
-    throw Exception(ExceptionType::INVALID, "traverse");
+}
+
+// B-link descent: read latch one page at a time, and move right past pages that split after their parent was read.
+// B-link trees never delete pages, so a page id stays valid after the latch of the page it came from is released.
+// @return: the leaf for key, not latched, or INVALID_PAGE_ID if the tree is empty; the internal pages the descent went
+// down from are appended to path, root first, unless it is null
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t BPLUSTREE_TYPE::BLINK_FindLeafPage(const KeyType &key, bool leftMost, std::vector<page_id_t> *path) {
+  page_id_t page_id = root_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    ReadPageGuard guard = fetch_page(page_id).UpgradeRead();
+    if (guard.As<BPlusTreePage>()->IsLeafPage()) {
+      return page_id;
+    }
+    auto *internal_page_node = guard.As<InternalPage>();
+    if (!leftMost && BLINK_MoveRight(internal_page_node, key)) {
+      page_id = internal_page_node->GetNextPageId();
+      continue;
+    }
+    if (path != nullptr) {
+      path->push_back(page_id);
+    }
+    page_id = (leftMost) ? internal_page_node->ValueAt(0) : internal_page_node->Lookup(key, comparator_);
   }
-  return page;
+  return INVALID_PAGE_ID;
 }
 
+// B-link descent from the given root to the internal page at level + 1 for key, which the caller may hold a child of
+// latched; the pages it went down from, including that one, are appended to path
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::isSafe(WType op, BPlusTreePage *node) {
-  if (op == WType::INSERT && node->GetSize() < node->GetMaxSize() - 1) {
-    return true;
+void BPLUSTREE_TYPE::BLINK_FindPath(const KeyType &key, page_id_t root_page_id, int root_level, int level,
+                                    std::vector<page_id_t> *path) {
+  page_id_t page_id = root_page_id;
+  for (int page_level = root_level; page_level > level;) {
+    ReadPageGuard guard = fetch_page(page_id).UpgradeRead();
+    auto *internal_page_node = guard.As<InternalPage>();
+    if (BLINK_MoveRight(internal_page_node, key)) {
+      page_id = internal_page_node->GetNextPageId();
+      continue;
+    }
+    path->push_back(page_id);
+    page_id = internal_page_node->Lookup(key, comparator_);
+    page_level--;
+  }
+}
+
+// whether key is at or above the high key of node, so that a split moved it to the right sibling
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N>
+bool BPLUSTREE_TYPE::BLINK_MoveRight(const N *node, const KeyType &key) const {
+  return node->GetNextPageId() != INVALID_PAGE_ID && comparator_(key, node->GetHighKey()) >= 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::isSafe(WType op, const BPlusTreePage *node, const KeyType &key) {
+  // a leaf takes key itself; an internal page takes whatever separator a split below it brings up
+  if (op == WType::INSERT) {
+    int max_size = node->IsLeafPage() ? reinterpret_cast<const LeafPage *>(node)->GetMaxSizeFor(key)
+                                      : reinterpret_cast<const InternalPage *>(node)->GetMaxSizeForAnyKey();
+    return node->GetSize() + 1 < max_size;
   }
   if (op == WType::DELETE && node->GetSize() > node->GetMinSize()) {  // or node->GetMinSize() + 1
     return true;
@@ -760,45 +1274,28 @@ bool BPLUSTREE_TYPE::isSafe(WType op, BPlusTreePage *node) {
   return false;
 }
 
+// release the root latch and every ancestor of the current page
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::free_ancestor(Transaction *transaction, bool ancestor_dirty) {
-  // this is a pointer
-  auto page_set = transaction->GetPageSet();
-
-  while (!page_set->empty()) {
-    Page *p = page_set->front();
-    if (p == nullptr) {
-      mu_.unlock();
-      page_set->pop_front();
-      continue;
-    }
-    auto *tmp = reinterpret_cast<BPlusTreePage *>(p->GetData());
-    page_id_t pid = tmp->GetPageId();
-
-    p->WUnlatch();
-    buffer_pool_manager_->UnpinPage(pid, ancestor_dirty);
+void BPLUSTREE_TYPE::free_ancestor(Context *ctx) {
+  if (ctx->root_lock_.owns_lock()) {
+    ctx->root_lock_.unlock();
+  }
+  while (ctx->write_set_.size() > 1) {
+    ctx->write_set_.pop_front();
+  }
+}
 
-    // if in del set, del
-    if (transaction->GetDeletedPageSet()->find(pid) != transaction->GetDeletedPageSet()->end()) {
-      buffer_pool_manager_->DeletePage(pid);
-      transaction->GetDeletedPageSet()->erase(pid);
-    }
-    // notice this clears elem in transaction - because page_set is a pointer
-    page_set->pop_front();
-  }
-
-  // check
-  // if (!page_set->empty() || !transaction->GetPageSet()->empty()) {
-  //   throw Exception(ExceptionType::INVALID, "del");
-  // }
-  // if (!transaction->GetDeletedPageSet()->empty()) {
-  //   LOG_DEBUG("fatal - GetDeletedPageSet");
-  //   auto p = transaction->GetDeletedPageSet();
-  //   for (auto &i : *p) {
-  //     LOG_DEBUG("%d", i);
-  //   }
-  //   throw Exception(ExceptionType::INVALID, "del");
-  // }
+// release everything the operation holds, then delete the pages it emptied
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::release(Context *ctx) {
+  ctx->write_set_.clear();
+  if (ctx->root_lock_.owns_lock()) {
+    ctx->root_lock_.unlock();
+  }
+  for (page_id_t pid : ctx->deleted_pages_) {
+    buffer_pool_manager_->DeletePage(pid);
+  }
+  ctx->deleted_pages_.clear();
 }
 
 /*
@@ -806,38 +1303,26 @@ void BPLUSTREE_TYPE::free_ancestor(Transaction *transaction, bool ancestor_dirty
  * the left most leaf page
  */
 INDEX_TEMPLATE_ARGUMENTS
-Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
-  // throw Exception(ExceptionType::NOT_IMPLEMENTED, "Implement this for test");
-  // LOG_ERROR("only used for checkpoint 1");
-
+BasicPageGuard BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
   // protect root
   if (IsEmpty()) {
-    return nullptr;
+    return {};
   }
 
-  Page *page;
-  BPlusTreePage *page_node;
-  page_id_t val;
-
   // root
-  page = buffer_pool_manager_->FetchPage(root_page_id_);
-
-  page_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  BasicPageGuard guard = fetch_page(root_page_id_);
 
   // if  root and leaf - new tree - return directly
   // if root ok, then recursively search
-  while (!page_node->IsLeafPage()) {
+  while (!guard.As<BPlusTreePage>()->IsLeafPage()) {
     // data key must exist in internal node
-    auto *internal_page_node = reinterpret_cast<InternalPage *>(page_node);
-
-    val = (leftMost) ? internal_page_node->ValueAt(0) : internal_page_node->Lookup(key, comparator_);
+    auto *internal_page_node = guard.As<InternalPage>();
+    page_id_t val = (leftMost) ? internal_page_node->ValueAt(0) : internal_page_node->Lookup(key, comparator_);
 
     // unpin current page and find next
-    buffer_pool_manager_->UnpinPage(page_node->GetPageId(), false);
-    page = buffer_pool_manager_->FetchPage(val);
-    page_node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    guard = fetch_page(val);
   }
-  return page;
+  return guard;
 }
 
 /*
@@ -850,7 +1335,8 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
-  HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  BasicPageGuard header_guard = fetch_page(HEADER_PAGE_ID);
+  auto *header_page = header_guard.AsPage<HeaderPage>();
   if (insert_record != 0) {
     // create a new record<index_name + root_page_id> in header_page
     header_page->InsertRecord(index_name_, root_page_id_);
@@ -858,7 +1344,7 @@ void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
-  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  header_guard.SetDirty();
 }
 
 /*
@@ -986,7 +1472,7 @@ void BPLUSTREE_TYPE::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::o
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Print() {
   if (root_page_id_ != INVALID_PAGE_ID) {
-    auto *page = fetch_page(root_page_id_);
+    auto *page = buffer_pool_manager_->FetchPage(root_page_id_);
     auto *tmp = reinterpret_cast<BPlusTreePage *>(page->GetData());
     ToString(tmp, buffer_pool_manager_);  // will unpin page
   } else {
@@ -0,0 +1,339 @@
+//===----------------------------------------------------------------------===//
+//
+//                         CMU-DB Project (15-445/645)
+//                         ***DO NO SHARE PUBLICLY***
+//
+// Identification: src/index/b_plus_tree_builder.cpp
+//
+// Copyright (c) 2018, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <queue>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "storage/index/b_plus_tree_builder.h"
+
+namespace bustub {
+
+namespace {
+// Nodes hold at most max_size - 1 entries between operations, and the tree merges nodes that are less than half full,
+// so a fill factor is only followed within those bounds.
+int FillOf(int max_size, double fill_factor) {
+  int fill = static_cast<int>((max_size - 1) * fill_factor);
+  return std::clamp(fill, std::min((max_size + 1) / 2, max_size - 1), max_size - 1);
+}
+}  // namespace
+
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_BUILDER_TYPE::BPlusTreeBuilder(BPlusTree<KeyType, ValueType, KeyComparator> *tree, double fill_factor,
+                                         size_t sort_buffer_size)
+    : tree_(tree),
+      comparator_(tree->comparator_),
+      fill_factor_(fill_factor),
+      buffer_capacity_(std::max<size_t>(1, sort_buffer_size / sizeof(MappingType))) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_BUILDER_TYPE::~BPlusTreeBuilder() {
+  for (auto &run : runs_) {
+    fclose(run.file_);
+  }
+}
+
+/*****************************************************************************
+ * SORTING
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_BUILDER_TYPE::Add(const KeyType &key, const ValueType &value) {
+  buffer_.emplace_back(key, value);
+  if (buffer_.size() >= buffer_capacity_) {
+    SpillRun();
+  }
+}
+
+// stable, so that of several entries with the same key the one added first comes first
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_BUILDER_TYPE::SortBuffer() {
+  std::stable_sort(buffer_.begin(), buffer_.end(), [this](const MappingType &lhs, const MappingType &rhs) {
+    return comparator_(lhs.first, rhs.first) < 0;
+  });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_BUILDER_TYPE::SpillRun() {
+  SortBuffer();
+  // the file has no name and is removed when it is closed
+  FILE *file = std::tmpfile();
+  if (file == nullptr) {
+    throw Exception(ExceptionType::INVALID, "cannot create a run file for the bulk load");
+  }
+  runs_.push_back(Run{file, {}, 0});
+  if (fwrite(buffer_.data(), sizeof(MappingType), buffer_.size(), file) != buffer_.size()) {
+    throw Exception(ExceptionType::INVALID, "cannot write a run file for the bulk load");
+  }
+  buffer_.clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_BUILDER_TYPE::ReadBlock(Run *run, size_t block_size) {
+  run->block_.resize(block_size);
+  run->block_.resize(fread(run->block_.data(), sizeof(MappingType), block_size, run->file_));
+  run->pos_ = 0;
+  return !run->block_.empty();
+}
+
+/*****************************************************************************
+ * BUILDING
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_BUILDER_TYPE::Finish() {
+  if (!tree_->IsEmpty()) {
+    throw Exception(ExceptionType::INVALID, "bulk load into a non-empty tree");
+  }
+
+  if (runs_.empty()) {
+    SortBuffer();
+    for (const auto &item : buffer_) {
+      Emit(item);
+    }
+  } else {
+    if (!buffer_.empty()) {
+      SpillRun();
+    }
+    std::vector<MappingType>().swap(buffer_);
+
+    // merge the runs, each read back in blocks of an equal share of the sort buffer; on equal keys the earlier run,
+    // which holds the entries added earlier, goes first
+    size_t block_size = std::max<size_t>(1, buffer_capacity_ / runs_.size());
+    auto after = [this](size_t lhs, size_t rhs) {
+      int cmp = comparator_(runs_[lhs].block_[runs_[lhs].pos_].first, runs_[rhs].block_[runs_[rhs].pos_].first);
+      return cmp > 0 || (cmp == 0 && lhs > rhs);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(after)> heads(after);
+    for (size_t i = 0; i < runs_.size(); i++) {
+      rewind(runs_[i].file_);
+      if (ReadBlock(&runs_[i], block_size)) {
+        heads.push(i);
+      }
+    }
+    while (!heads.empty()) {
+      size_t i = heads.top();
+      heads.pop();
+      Run &run = runs_[i];
+      Emit(run.block_[run.pos_]);
+      if (++run.pos_ < run.block_.size() || ReadBlock(&run, block_size)) {
+        heads.push(i);
+      }
+    }
+  }
+  std::vector<MappingType>().swap(buffer_);
+
+  if (levels_.empty()) {
+    return 0;
+  }
+  FixRightEdge();
+
+  // every page is written; unpin them and publish the root
+  page_id_t root_page_id = levels_.back().node_.PageId();
+  int root_level = static_cast<int>(levels_.size()) - 1;
+  levels_.clear();
+  std::scoped_lock lock(tree_->mu_);
+  tree_->root_page_id_ = root_page_id;
+  tree_->root_level_ = root_level;
+  tree_->UpdateRootPageId(true);
+  return num_loaded_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_BUILDER_TYPE::Emit(const MappingType &item) {
+  if (num_loaded_ > 0 && comparator_(last_key_, item.first) == 0) {
+    return;
+  }
+  last_key_ = item.first;
+  num_loaded_++;
+
+  if (levels_.empty()) {
+    OpenNode(0, item.first);
+  } else {
+    BasicPageGuard &leaf_guard = levels_[0].node_;
+    // a compressed leaf holds fewer entries once it needs wider ones for the key
+    auto *leaf = leaf_guard.As<LeafPage>();
+    if (leaf->GetSize() >= FillOf(leaf->GetMaxSizeFor(item.first), fill_factor_)) {
+      OpenNode(0, item.first);
+    }
+  }
+  BasicPageGuard &leaf_guard = levels_[0].node_;
+  leaf_guard.AsMut<LeafPage>()->Append(item.first, item.second);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_BUILDER_TYPE::OpenNode(size_t level, const KeyType &first_key) {
+  page_id_t page_id;
+  BasicPageGuard guard = tree_->new_page(&page_id);
+  if (level == levels_.size()) {
+    // the first leaf, which is the root until a second one is opened
+    guard.AsMut<LeafPage>()->Init(page_id, INVALID_PAGE_ID, tree_->leaf_max_size_, tree_->key_size_);
+    levels_.push_back(Level{std::move(guard), INVALID_PAGE_ID});
+    return;
+  }
+
+  // link the page into the level above first, which may add a level; then make it the right sibling of the page
+  // before, whose high key is where the new page begins
+  page_id_t parent_id = AddChild(level + 1, first_key, page_id);
+  BasicPageGuard &cur_guard = levels_[level].node_;
+  if (level == 0) {
+    guard.AsMut<LeafPage>()->Init(page_id, parent_id, tree_->leaf_max_size_, tree_->key_size_);
+    auto *cur = cur_guard.AsMut<LeafPage>();
+    cur->SetNextPageId(page_id);
+    cur->SetHighKey(first_key);
+  } else {
+    guard.AsMut<InternalPage>()->Init(page_id, parent_id, tree_->internal_max_size_, tree_->key_size_);
+    auto *cur = cur_guard.AsMut<InternalPage>();
+    cur->SetNextPageId(page_id);
+    cur->SetHighKey(first_key);
+  }
+  levels_[level].prev_page_id_ = cur_guard.PageId();
+  cur_guard = std::move(guard);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t BPLUSTREE_BUILDER_TYPE::AddChild(size_t level, const KeyType &key, page_id_t child) {
+  if (level == levels_.size()) {
+    // the level below got its second page: a new root over both
+    page_id_t page_id;
+    BasicPageGuard guard = tree_->new_page(&page_id);
+    auto *root = guard.AsMut<InternalPage>();
+    root->Init(page_id, INVALID_PAGE_ID, tree_->internal_max_size_, tree_->key_size_);
+    BasicPageGuard &first_guard = levels_[level - 1].node_;
+    auto *first = first_guard.AsMut<BPlusTreePage>();
+    root->PopulateNewRoot(first->GetPageId(), key, child);
+    first->SetParentPageId(page_id);
+    levels_.push_back(Level{std::move(guard), INVALID_PAGE_ID});
+    return page_id;
+  }
+
+  BasicPageGuard &full_guard = levels_[level].node_;
+  auto *full = full_guard.As<InternalPage>();
+  if (full->GetSize() >= FillOf(full->GetMaxSizeFor(key), fill_factor_)) {
+    OpenNode(level, key);
+  }
+  BasicPageGuard &node_guard = levels_[level].node_;
+  auto *node = node_guard.AsMut<InternalPage>();
+  node->Append(key, child);
+  return node->GetPageId();
+}
+
+// The rightmost page of a level is the last child of the rightmost page of the level above. Its separator is the key
+// of its entry there, unless it is the first child, in which case the separator is further up.
+INDEX_TEMPLATE_ARGUMENTS
+std::pair<size_t, int> BPLUSTREE_BUILDER_TYPE::SeparatorOf(size_t level) {
+  for (size_t up = level + 1; up < levels_.size(); up++) {
+    BasicPageGuard &guard = levels_[up].node_;
+    int index = guard.As<InternalPage>()->GetSize() - 1;
+    if (index > 0) {
+      return {up, index};
+    }
+  }
+  throw Exception(ExceptionType::INVALID, "bulk load separator");
+}
+
+/*
+ * All pages but the rightmost of each level are filled to the fill factor; the rightmost gets what is left. If that
+ * is less than half a page, it is merged into its left neighbour if both fit into one page, and otherwise the two
+ * share their entries evenly. Merging removes the page's entry from the level above, which is fixed up next. A root
+ * that is left with a single child is dropped.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_BUILDER_TYPE::FixRightEdge() {
+  BufferPoolManager *bpm = tree_->buffer_pool_manager_;
+  for (size_t level = 0; level + 1 < levels_.size(); level++) {
+    BasicPageGuard &node_guard = levels_[level].node_;
+    auto *node = node_guard.AsMut<BPlusTreePage>();
+    if (node->GetSize() >= node->GetMinSize()) {
+      continue;
+    }
+    BasicPageGuard prev_guard = tree_->fetch_page(levels_[level].prev_page_id_);
+    auto *prev = prev_guard.AsMut<BPlusTreePage>();
+    auto [separator_level, separator_index] = SeparatorOf(level);
+    BasicPageGuard &separator_guard = levels_[separator_level].node_;
+    auto *separator_node = separator_guard.AsMut<InternalPage>();
+    KeyType separator = separator_node->KeyAt(separator_index);
+
+    bool can_merge = node->IsLeafPage()
+                         ? reinterpret_cast<LeafPage *>(prev)->CanMerge(reinterpret_cast<LeafPage *>(node))
+                         : reinterpret_cast<InternalPage *>(prev)->CanMerge(reinterpret_cast<InternalPage *>(node),
+                                                                            separator);
+    if (can_merge) {
+      if (node->IsLeafPage()) {
+        reinterpret_cast<LeafPage *>(node)->MoveAllTo(reinterpret_cast<LeafPage *>(prev));
+      } else if (node->GetSize() > 0) {
+        reinterpret_cast<InternalPage *>(node)->MoveAllTo(reinterpret_cast<InternalPage *>(prev), separator, bpm);
+      } else {
+        reinterpret_cast<InternalPage *>(prev)->SetNextPageId(INVALID_PAGE_ID);
+      }
+      BasicPageGuard &parent_guard = levels_[level + 1].node_;
+      auto *parent = parent_guard.AsMut<InternalPage>();
+      parent->Remove(parent->GetSize() - 1);
+      page_id_t page_id = node->GetPageId();
+      node_guard = std::move(prev_guard);
+      bpm->DeletePage(page_id);
+      continue;
+    }
+
+    // a compressed page takes no more entries than it has room for in its widest layout, and its separator must fit
+    // into the page that holds it; if either does not work out, the page is left less than half full
+    int room = node->IsLeafPage() ? reinterpret_cast<LeafPage *>(node)->GetMaxSizeForAnyKey()
+                                  : reinterpret_cast<InternalPage *>(node)->GetMaxSizeForAnyKey();
+    int moves = std::min((prev->GetSize() + node->GetSize()) / 2, room - 1) - node->GetSize();
+    if (moves <= 0) {
+      continue;
+    }
+    KeyType new_separator = node->IsLeafPage()
+                                ? reinterpret_cast<LeafPage *>(prev)->KeyAt(prev->GetSize() - moves)
+                                : reinterpret_cast<InternalPage *>(prev)->KeyAt(prev->GetSize() - moves);
+    if (!separator_node->CanSetKeyAt(separator_index, new_separator)) {
+      continue;
+    }
+    if (node->IsLeafPage()) {
+      auto *leaf = reinterpret_cast<LeafPage *>(node);
+      for (int i = 0; i < moves; i++) {
+        reinterpret_cast<LeafPage *>(prev)->MoveLastToFrontOf(leaf);
+      }
+      separator = leaf->KeyAt(0);
+      reinterpret_cast<LeafPage *>(prev)->SetHighKey(separator);
+    } else {
+      auto *internal = reinterpret_cast<InternalPage *>(prev);
+      for (int i = 0; i < moves; i++) {
+        KeyType key = internal->KeyAt(internal->GetSize() - 1);
+        internal->MoveLastToFrontOf(reinterpret_cast<InternalPage *>(node), separator, bpm);
+        separator = key;
+      }
+      internal->SetHighKey(separator);
+    }
+    separator_node->SetKeyAt(separator_index, separator);
+  }
+
+  while (levels_.size() > 1) {
+    BasicPageGuard &root_guard = levels_.back().node_;
+    if (root_guard.As<InternalPage>()->GetSize() > 1) {
+      break;
+    }
+    page_id_t root_page_id = root_guard.PageId();
+    levels_.pop_back();
+    bpm->DeletePage(root_page_id);
+    // the only child of the root is the only page of the level below
+    BasicPageGuard &child_guard = levels_.back().node_;
+    child_guard.AsMut<BPlusTreePage>()->SetParentPageId(INVALID_PAGE_ID);
+  }
+}
+
+template class BPlusTreeBuilder<GenericKey<4>, RID, GenericComparator<4>>;
+template class BPlusTreeBuilder<GenericKey<8>, RID, GenericComparator<8>>;
+template class BPlusTreeBuilder<GenericKey<16>, RID, GenericComparator<16>>;
+template class BPlusTreeBuilder<GenericKey<32>, RID, GenericComparator<32>>;
+template class BPlusTreeBuilder<GenericKey<64>, RID, GenericComparator<64>>;
+
+}  // namespace bustub
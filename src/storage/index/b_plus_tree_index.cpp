@@ -9,18 +9,34 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <numeric>
+
 #include "storage/index/b_plus_tree_index.h"
 #include "common/logger.h"
 
 namespace bustub {
+
+namespace {
+// bytes of a key that SetFromKey may fill; normalized columns are as long as inlined ones, varchars as long as the key
+int KeySizeOf(const Schema *key_schema, int max_key_size) {
+  if (!key_schema->GetUnlinedColumns().empty()) {
+    return max_key_size;
+  }
+  return std::clamp(static_cast<int>(key_schema->GetLength()), 1, max_key_size);
+}
+}  // namespace
+
 /*
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(IndexMetadata *metadata, BufferPoolManager *buffer_pool_manager,
+                                     PageSizeClass page_size_class, BTreePageLayout page_layout)
     : Index(metadata),
-      comparator_(metadata->GetKeySchema()),
-      container_(metadata->GetName(), buffer_pool_manager, comparator_) {}
+      comparator_(metadata->GetKeySchema(), KeyEncoding::NORMALIZED),
+      container_(metadata->GetName(), buffer_pool_manager, comparator_, page_size_class, page_layout,
+                 KeySizeOf(metadata->GetKeySchema(), sizeof(KeyType))) {}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
@@ -29,7 +45,7 @@ void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *t
   if (sizeof(index_key.data_) < key.GetLength()) {
     LOG_ERROR("index_key %ld key %d ", sizeof(index_key.data_), key.GetLength());
   }
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
   // LOG_INFO("InsertEntry %ld %d %d", index_key.ToString(), rid.GetPageId(), rid.GetSlotNum());
 
   container_.Insert(index_key, rid, transaction);
@@ -43,7 +59,7 @@ void BPLUSTREE_INDEX_TYPE::v_InsertEntry(const Tuple &key, RID rid, Transaction
   if (sizeof(index_key.data_) < key.GetLength()) {
     LOG_ERROR("index_key %ld key %d ", sizeof(index_key.data_), key.GetLength());
   }
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
   auto ok = container_.Insert(index_key, rid, transaction);
   LOG_INFO("insert %d", ok);
 }
@@ -56,7 +72,7 @@ void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *t
   if (sizeof(index_key.data_) < key.GetLength()) {
     LOG_ERROR("index_key %ld key %d ", sizeof(index_key.data_), key.GetLength());
   }
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
   container_.Remove(index_key, transaction);
 }
@@ -75,18 +91,44 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, T
   if (sizeof(index_key.data_) < key.GetLength()) {
     LOG_ERROR("index_key %ld key %d ", sizeof(index_key.data_), key.GetLength());
   }
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
   container_.GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                                    Transaction *transaction) {
+  std::vector<KeyType> index_keys(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    index_keys[i].SetFromKey(keys[i], GetKeySchema());
+  }
+  std::vector<size_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](size_t lhs, size_t rhs) { return comparator_(index_keys[lhs], index_keys[rhs]) < 0; });
+  std::vector<KeyType> sorted_keys;
+  sorted_keys.reserve(keys.size());
+  for (size_t i : order) {
+    sorted_keys.push_back(index_keys[i]);
+  }
+
+  std::vector<std::vector<RID>> sorted_results;
+  container_.GetValues(sorted_keys, &sorted_results, transaction);
+  results->resize(keys.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    auto &result = (*results)[order[i]];
+    result.insert(result.end(), sorted_results[i].begin(), sorted_results[i].end());
+  }
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::v_ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
   KeyType index_key;
   if (sizeof(index_key.data_) < key.GetLength()) {
     LOG_ERROR("index_key %ld key %d ", sizeof(index_key.data_), key.GetLength());
   }
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
   auto ok = container_.GetValue(index_key, result, transaction);
   LOG_INFO("%s %d", result->at(0).ToString().c_str(), ok);
@@ -101,6 +143,24 @@ INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) {
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetEndIterator() { return container_.end(); }
 
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetRangeIterator(const Tuple *low, const Tuple *high, bool reverse) {
+  KeyType low_key;
+  KeyType high_key;
+  if (low != nullptr) {
+    low_key.SetFromKey(*low, GetKeySchema());
+  }
+  if (high != nullptr) {
+    high_key.SetFromKey(*high, GetKeySchema());
+  }
+  return container_.Range(low != nullptr ? &low_key : nullptr, high != nullptr ? &high_key : nullptr, reverse);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_BUILDER_TYPE BPLUSTREE_INDEX_TYPE::GetBuilder(double fill_factor) {
+  return BPLUSTREE_BUILDER_TYPE(&container_, fill_factor);
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
@@ -2,8 +2,10 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <utility>
 
 #include "common/logger.h"
+#include "storage/index/b_plus_tree.h"
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
@@ -18,19 +20,40 @@ INDEXITERATOR_TYPE::IndexIterator() =
 // INDEXITERATOR_TYPE::IndexIterator() : leaf_(nullptr), buffer_pool_manager_(nullptr), index_(-1) {}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, BufferPoolManager *bpm, int index)
-    : leaf_(leaf), buffer_pool_manager_(bpm), index_(index) {}
+INDEXITERATOR_TYPE::IndexIterator(ReadPageGuard leaf_guard, BufferPoolManager *bpm, int index)
+    : leaf_guard_(std::move(leaf_guard)), buffer_pool_manager_(bpm), index_(index) {
+  if (!leaf_guard_.IsValid()) {
+    index_ = -1;
+    return;
+  }
+  leaf_ = leaf_guard_.As<B_PLUS_TREE_LEAF_PAGE_TYPE>();
+  // a start key past the last key of its leaf starts at the next leaf
+  Seek();
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-// INDEXITERATOR_TYPE::~IndexIterator() = default;
-INDEXITERATOR_TYPE::~IndexIterator() {
-  if (leaf_ != nullptr) {
-    buffer_pool_manager_->FetchPage(leaf_->GetPageId())->RUnlatch();
-    buffer_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-    buffer_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
+INDEXITERATOR_TYPE::IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, ReadPageGuard leaf_guard,
+                                  int index, const KeyType *bound, bool reverse)
+    : leaf_guard_(std::move(leaf_guard)),
+      buffer_pool_manager_(tree->buffer_pool_manager_),
+      index_(index),
+      tree_(tree),
+      bounded_(bound != nullptr),
+      reverse_(reverse) {
+  if (!leaf_guard_.IsValid()) {
+    index_ = -1;
+    return;
+  }
+  if (bounded_) {
+    bound_ = *bound;
   }
+  leaf_ = leaf_guard_.As<B_PLUS_TREE_LEAF_PAGE_TYPE>();
+  Seek();
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::~IndexIterator() = default;
+
 INDEX_TEMPLATE_ARGUMENTS
 bool INDEXITERATOR_TYPE::isEnd() { return leaf_ == nullptr && index_ == -1; }
 
@@ -39,7 +62,8 @@ const MappingType &INDEXITERATOR_TYPE::operator*() {
   if (isEnd()) {
     throw Exception(ExceptionType::INVALID, "iterator *");
   }
-  return leaf_->GetItem(index_);
+  item_ = leaf_->GetItem(index_);
+  return item_;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -48,25 +72,88 @@ INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
     throw Exception(ExceptionType::INVALID, "iterator *");
   }
 
-  // LOG_INFO("%d %d %d", leaf_->GetPageId(), leaf_->GetSize(), index_);
-  index_++;
-  if (index_ >= leaf_->GetSize()) {
+  if (reverse_ ? --index_ < stop_ : ++index_ >= stop_) {
+    Seek();
+  }
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Seek() {
+  while (true) {
+    int size = leaf_->GetSize();
+    if (reverse_) {
+      stop_ = bounded_ ? leaf_->KeyIndex(bound_, tree_->comparator_) : 0;
+      if (index_ >= stop_) {
+        return;
+      }
+      // the bound is on this leaf, or the leaf starts at it; otherwise find the leaf before this one, which has
+      // entries, so that the search key is its first key
+      if (stop_ > 0 || size == 0 || (bounded_ && tree_->comparator_(leaf_->KeyAt(0), bound_) <= 0)) {
+        SetEnd();
+        return;
+      }
+      KeyType first_key = leaf_->KeyAt(0);
+      // release this leaf first: latching leaves from right to left while holding one would deadlock with scans
+      leaf_guard_.Drop();
+      leaf_guard_ = tree_->READ_FindLeafPageBefore(&first_key, &index_);
+      if (!leaf_guard_.IsValid()) {
+        SetEnd();
+        return;
+      }
+      leaf_ = leaf_guard_.As<B_PLUS_TREE_LEAF_PAGE_TYPE>();
+      continue;
+    }
+
+    stop_ = bounded_ ? leaf_->KeyIndex(bound_, tree_->comparator_) : size;
+    if (index_ < stop_) {
+      return;
+    }
+    // the bound is on this leaf, or the next leaf only holds keys at or above it, which is its high key
     auto next_pid = leaf_->GetNextPageId();
-    buffer_pool_manager_->FetchPage(leaf_->GetPageId())->RUnlatch();
-    buffer_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-    buffer_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
-
-    if (next_pid == INVALID_PAGE_ID) {
-      leaf_ = nullptr;
-      index_ = -1;
-    } else {
-      auto *page = buffer_pool_manager_->FetchPage(next_pid);
-      page->RLatch();
-      leaf_ = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
-      index_ = 0;
+    if (stop_ < size || next_pid == INVALID_PAGE_ID ||
+        (bounded_ && tree_->comparator_(leaf_->GetHighKey(), bound_) >= 0)) {
+      SetEnd();
+      return;
+    }
+    // latch the next leaf before this one is released. A writer that holds the next leaf may be waiting for this one,
+    // to merge the two or move entries between them, so rather than wait for it the iterator lets go of this leaf and
+    // finds the keys after it again from the root.
+    BasicPageGuard next_guard = buffer_pool_manager_->FetchPageBasic(next_pid);
+    if (!next_guard.IsValid()) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "iterator ++");
+    }
+    ReadPageGuard next_leaf_guard;
+    if (tree_ == nullptr) {
+      next_leaf_guard = next_guard.UpgradeRead();
+    } else if (!next_guard.TryUpgradeRead(&next_leaf_guard)) {
+      next_guard.Drop();
+      // the keys after the last one of this leaf or, if it has none, those from its high key on
+      KeyType key = size > 0 ? leaf_->KeyAt(size - 1) : leaf_->GetHighKey();
+      leaf_guard_.Drop();
+      leaf_guard_ = tree_->READ_FindLeafPage(key, false);
+      if (!leaf_guard_.IsValid()) {
+        SetEnd();
+        return;
+      }
+      leaf_ = leaf_guard_.As<B_PLUS_TREE_LEAF_PAGE_TYPE>();
+      index_ = leaf_->KeyIndex(key, tree_->comparator_);
+      if (size > 0 && index_ < leaf_->GetSize() && tree_->comparator_(leaf_->KeyAt(index_), key) == 0) {
+        index_++;
+      }
+      continue;
     }
+    leaf_guard_ = std::move(next_leaf_guard);
+    leaf_ = leaf_guard_.As<B_PLUS_TREE_LEAF_PAGE_TYPE>();
+    index_ = 0;
   }
-  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SetEnd() {
+  leaf_guard_.Drop();
+  leaf_ = nullptr;
+  index_ = -1;
 }
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
@@ -9,6 +9,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -27,15 +29,21 @@ namespace bustub {
  * Init method after creating a new internal page
  * Including set page type, set current size, set page id, set parent id and set
  * max page size
+ * A compressed page starts out without a layout, and its max size follows the layout.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size, int key_size) {
   BPlusTreePage::SetPageType(IndexPageType::INTERNAL_PAGE);
   BPlusTreePage::SetPageId(page_id);
   BPlusTreePage::SetParentPageId(parent_id);
   BPlusTreePage::SetSize(0);
+  next_page_id_ = INVALID_PAGE_ID;
+  key_size_ = key_size;
+  prefix_size_ = 0;
+  key_end_ = key_size == 0 ? sizeof(KeyType) : 0;
   // BPlusTreePage::SetMaxSize(max_size);
-  BPlusTreePage::SetMaxSize(max_size);
+  BPlusTreePage::SetMaxSize(key_size == 0 ? max_size
+                                          : CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), 0, 0));
 }
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
@@ -47,7 +55,8 @@ KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const {
   if (index < 0 || index >= BPlusTreePage::GetSize()) {
     LOG_ERROR("internal Page KeyAt");
   }
-  return array[index].first;
+  KeyType buf;
+  return GetEntries().KeyAt(index, &buf);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -55,17 +64,44 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
   if (index < 0 || index >= BPlusTreePage::GetSize()) {
     LOG_ERROR("internal Page SetKeyAt");
   }
-  array[index].first = key;
+  ValueType value = ValueAt(index);
+  if (key_size_ != 0 && index > 0) {
+    int prefix_size;
+    int key_end;
+    WidenFor(key, &prefix_size, &key_end);
+    if (prefix_size != prefix_size_ || key_end != key_end_) {
+      std::vector<MappingType> items;
+      Decode(&items);
+      Encode(items, prefix_size, key_end, reinterpret_cast<const char *>(&key));
+    }
+  }
+  WriteEntry(index, key, value);
 }
 
+/*
+ * Helper methods to get/set the right sibling and the high key
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetNextPageId() const { return next_page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetHighKey() const { return high_key_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetHighKey(const KeyType &high_key) { high_key_ = high_key; }
+
 /*
  * Helper method to find and return array index(or offset), so that its value
  * equals to input "value"
  */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const {
-  for (int i = 0; i < BPlusTreePage::GetSize(); i++) {
-    if (array[i].second == value) {
+  Entries entries = GetEntries();
+  for (int i = 0; i < entries.size_; i++) {
+    if (entries.ValueAt(i) == value) {
       return i;
     }
   }
@@ -81,49 +117,301 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const {
   if (index < 0 || index >= BPlusTreePage::GetSize()) {
     LOG_ERROR("internal Page ValueAt");
   }
-  return array[index].second;
+  return GetEntries().ValueAt(index);
+}
+
+/*
+ * Helper method to get the key size of a compressed page, 0 if the page is not compressed
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetKeySize() const { return key_size_; }
+
+/*
+ * Helper methods to check whether a key fits, so that the tree can split first or leave the page alone if it does not
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::HasRoomFor(const KeyType &key) const {
+  return key_size_ == 0 || BPlusTreePage::GetSize() + 1 < GetMaxSizeFor(key);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetMaxSizeFor(const KeyType &key) const {
+  if (key_size_ == 0) {
+    return BPlusTreePage::GetMaxSize();
+  }
+  int prefix_size;
+  int key_end;
+  WidenFor(key, &prefix_size, &key_end);
+  return CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), prefix_size, key_end);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetMaxSizeForAnyKey() const {
+  if (key_size_ == 0) {
+    return BPlusTreePage::GetMaxSize();
+  }
+  return std::min(BPlusTreePage::GetMaxSize(),
+                  CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), 0, key_size_));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanMerge(const BPlusTreeInternalPage *right, const KeyType &middle_key) const {
+  int size = BPlusTreePage::GetSize() + right->GetSize();
+  if (key_size_ == 0) {
+    return size < BPlusTreePage::GetMaxSize();
+  }
+  std::vector<MappingType> items;
+  Decode(&items);
+  right->Decode(&items);
+  if (right->GetSize() > 0) {
+    items[BPlusTreePage::GetSize()].first = middle_key;
+  }
+  int prefix_size;
+  int key_end;
+  LayoutOf(items, false, &prefix_size, &key_end);
+  return size < CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), prefix_size, key_end);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanSetKeyAt(int index, const KeyType &key) const {
+  return key_size_ == 0 || index == 0 || BPlusTreePage::GetSize() < GetMaxSizeFor(key);
 }
 
 /*****************************************************************************
- * LOOKUP
+ * LAYOUT
  *****************************************************************************/
 /*
- * Find and return the child pointer(page_id) which points to the child page
- * that contains input "key"
- * Start the search from the second key(the first key should always be invalid)
+ * The layout fields are read once, and clamped so that fields that come from different writes still describe
+ * entries within the page; optimistic descents read internal pages while writers change them
  */
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const {
-  // this tree does not allow duplicates key
-  int left = 0;
-  int right = BPlusTreePage::GetSize() - 1;
-  int mid;
-
-  // for (int i = 1; i < GetSize(); i++) {
-  //  LOG_DEBUG("key: %ld - array key: %ld ", key.ToString(), array[i].first.ToString());
-  //  LOG_DEBUG("compare: %d", comparator(array[i].first, key));
-  //}
-
-  while (left + 1 < right) {
-    mid = (left + right) / 2;
-    if (comparator(array[mid].first, key) == 1) {
+typename B_PLUS_TREE_INTERNAL_PAGE_TYPE::Entries B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetEntries() const {
+  Entries entries;
+  entries.key_end_ = key_end_;
+  entries.prefix_size_ = std::min<int>(prefix_size_, entries.key_end_);
+  entries.slot_size_ = entries.key_end_ - entries.prefix_size_ + sizeof(ValueType);
+  entries.prefix_ = data_;
+  entries.slots_ = data_ + entries.prefix_size_;
+  entries.size_ = std::clamp(BPlusTreePage::GetSize(), 0, (DataSize() - entries.prefix_size_) / entries.slot_size_);
+  return entries;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const KeyType &B_PLUS_TREE_INTERNAL_PAGE_TYPE::Entries::KeyAt(int index, KeyType *buf) const {
+  const char *slot = slots_ + index * slot_size_;
+  if (prefix_size_ == 0 && key_end_ == static_cast<int>(sizeof(KeyType))) {
+    return *reinterpret_cast<const KeyType *>(slot);
+  }
+  auto *key = reinterpret_cast<char *>(buf);
+  memcpy(key, prefix_, prefix_size_);
+  memcpy(key + prefix_size_, slot, key_end_ - prefix_size_);
+  memset(key + key_end_, 0, sizeof(KeyType) - key_end_);
+  return *buf;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Entries::ValueAt(int index) const {
+  ValueType value;
+  memcpy(&value, slots_ + index * slot_size_ + key_end_ - prefix_size_, sizeof(ValueType));
+  return value;
+}
+
+// the prefixes decide most comparisons; only ties go through the typed comparison of the keys
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::Entries::CompareAt(int index, const KeyType &key, uint64_t key_prefix,
+                                                       const KeyComparator &comparator) const {
+  KeyType buf;
+  const KeyType &entry_key = KeyAt(index, &buf);
+  int cmp = comparator.ComparePrefixes(comparator.KeyPrefix(entry_key), key_prefix);
+  return cmp != KeyComparator::PREFIX_TIE ? cmp : comparator(entry_key, key);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::Entries::UpperBound(const KeyType &key, const KeyComparator &comparator) const {
+  uint64_t key_prefix = comparator.KeyPrefix(key);
+  int left = 1;
+  int right = std::max(size_, 1);
+  while (left < right) {
+    int mid = (left + right) / 2;
+    if (CompareAt(mid, key, key_prefix, comparator) <= 0) {
+      left = mid + 1;
+    } else {
       right = mid;
-    } else if (comparator(array[mid].first, key) == -1) {
-      left = mid;
+    }
+  }
+  return left;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::Entries::LowerBound(const KeyType &key, const KeyComparator &comparator) const {
+  uint64_t key_prefix = comparator.KeyPrefix(key);
+  int left = 1;
+  int right = std::max(size_, 1);
+  while (left < right) {
+    int mid = (left + right) / 2;
+    if (CompareAt(mid, key, key_prefix, comparator) < 0) {
+      left = mid + 1;
     } else {
-      return array[mid].second;
+      right = mid;
     }
   }
+  return left;
+}
+
+// bytes after the high key, which hold the prefix and the entries
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::DataSize() const {
+  return PageSizeOf(BPlusTreePage::GetPageId()) - INTERNAL_PAGE_HEADER_SIZE - static_cast<int>(sizeof(KeyType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::SlotAt(int index) {
+  return data_ + prefix_size_ + index * (key_end_ - prefix_size_ + sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::WriteEntry(int index, const KeyType &key, const ValueType &value) {
+  char *slot = SlotAt(index);
+  memcpy(slot, reinterpret_cast<const char *>(&key) + prefix_size_, key_end_ - prefix_size_);
+  memcpy(slot + key_end_ - prefix_size_, &value, sizeof(ValueType));
+}
 
-  for (int i = left + 1; i < right + 1; i++) {
-    if (comparator(array[i].first, key) == 1) {  // array[i] > key
-      // LOG_DEBUG("key: %ld - id: %d ", key.ToString(), i);
-      return array[i - 1].second;
+/*
+ * Insert the entry at index; a compressed page first widens its layout if the key needs it, unless it is the first
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertAt(int index, const KeyType &key, const ValueType &value) {
+  if (key_size_ != 0 && index > 0) {
+    int prefix_size;
+    int key_end;
+    WidenFor(key, &prefix_size, &key_end);
+    if (prefix_size != prefix_size_ || key_end != key_end_) {
+      std::vector<MappingType> items;
+      Decode(&items);
+      Encode(items, prefix_size, key_end, reinterpret_cast<const char *>(&key));
     }
   }
+  auto size = BPlusTreePage::GetSize();
+  memmove(SlotAt(index + 1), SlotAt(index), SlotAt(size) - SlotAt(index));
+  WriteEntry(index, key, value);
+  BPlusTreePage::IncreaseSize(1);
+}
+
+/*
+ * Remove the entry at index; the layout stays as it is
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAt(int index) {
+  auto size = BPlusTreePage::GetSize();
+  memmove(SlotAt(index), SlotAt(index + 1), SlotAt(size) - SlotAt(index + 1));
+  BPlusTreePage::IncreaseSize(-1);
+}
+
+/*
+ * Layout of a compressed page once it holds key as well; a page without keys but the first takes the layout of key
+ * alone
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::WidenFor(const KeyType &key, int *prefix_size, int *key_end) const {
+  const auto *bytes = reinterpret_cast<const char *>(&key);
+  int length = SignificantLength(bytes, sizeof(KeyType));
+  if (BPlusTreePage::GetSize() <= 1) {
+    *prefix_size = length;
+    *key_end = length;
+    return;
+  }
+  *prefix_size = CommonPrefixLength(data_, bytes, prefix_size_);
+  *key_end = std::max<int>(key_end_, length);
+}
 
-  // LOG_DEBUG("key: %ld - right id: %d ", key.ToString(), right);
-  return array[right].second;
+/*
+ * Narrowest layout that holds the keys of items, with or without the first; pages that are not compressed store
+ * whole keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::LayoutOf(const std::vector<MappingType> &items, bool with_first_key,
+                                              int *prefix_size, int *key_end) const {
+  *prefix_size = 0;
+  *key_end = key_size_ == 0 ? sizeof(KeyType) : 0;
+  size_t begin = with_first_key ? 0 : 1;
+  if (key_size_ == 0 || items.size() <= begin) {
+    return;
+  }
+  const auto *first = reinterpret_cast<const char *>(&items[begin].first);
+  *prefix_size = sizeof(KeyType);
+  for (size_t i = begin; i < items.size(); i++) {
+    const auto *bytes = reinterpret_cast<const char *>(&items[i].first);
+    *prefix_size = CommonPrefixLength(first, bytes, *prefix_size);
+    *key_end = std::max(*key_end, SignificantLength(bytes, sizeof(KeyType)));
+  }
+  *prefix_size = std::min(*prefix_size, *key_end);
+}
+
+/*
+ * Append the entries of the page to items
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Decode(std::vector<MappingType> *items) const {
+  Entries entries = GetEntries();
+  KeyType buf;
+  for (int i = 0; i < entries.size_; i++) {
+    items->emplace_back(entries.KeyAt(i, &buf), entries.ValueAt(i));
+  }
+}
+
+/*
+ * Replace the entries of the page with items, in the narrowest layout that holds their keys, with or without the
+ * first
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Encode(const std::vector<MappingType> &items, bool with_first_key) {
+  int prefix_size;
+  int key_end;
+  LayoutOf(items, with_first_key, &prefix_size, &key_end);
+  size_t first = with_first_key ? 0 : 1;
+  Encode(items, prefix_size, key_end,
+         items.size() <= first ? nullptr : reinterpret_cast<const char *>(&items[first].first));
+}
+
+/*
+ * Replace the entries of the page with items, in the given layout; all keys but maybe the first begin with the
+ * prefix_size bytes at prefix. A compressed page takes the max size of the layout.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Encode(const std::vector<MappingType> &items, int prefix_size, int key_end,
+                                            const char *prefix) {
+  prefix_size_ = prefix_size;
+  key_end_ = key_end;
+  if (prefix_size > 0) {
+    memmove(data_, prefix, prefix_size);
+  }
+  for (size_t i = 0; i < items.size(); i++) {
+    WriteEntry(i, items[i].first, items[i].second);
+  }
+  BPlusTreePage::SetSize(items.size());
+  if (key_size_ != 0) {
+    BPlusTreePage::SetMaxSize(CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), prefix_size, key_end));
+  }
+}
+
+/*****************************************************************************
+ * LOOKUP
+ *****************************************************************************/
+/*
+ * Find and return the child pointer(page_id) which points to the child page
+ * that contains input "key"
+ * Start the search from the second key(the first key should always be invalid)
+ */
+INDEX_TEMPLATE_ARGUMENTS
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const {
+  // this tree does not allow duplicates key
+  Entries entries = GetEntries();
+  return entries.ValueAt(entries.UpperBound(key, comparator) - 1);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::LookupBefore(const KeyType &key, const KeyComparator &comparator) const {
+  return GetEntries().LowerBound(key, comparator) - 1;
 }
 
 /*****************************************************************************
@@ -139,10 +427,16 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
                                                      const ValueType &new_value) {
   // root node should have 1 key 2 pointers - and the first key is invalid
-  array[0].second = old_value;
-  array[1].first = new_key;
-  array[1].second = new_value;
-  BPlusTreePage::SetSize(2);
+  Encode({{KeyType{}, old_value}, {new_key, new_value}});
+}
+
+/*
+ * Append new_key & new_value pair after the last pair; the first pair's key stays invalid
+ * NOTE: This method is only called by BPlusTreeBuilder, which adds the children of a node in order
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Append(const KeyType &new_key, const ValueType &new_value) {
+  InsertAt(BPlusTreePage::GetSize(), new_key, new_value);
 }
 /*
  * Insert new_key & new_value pair right after the pair with its value ==
@@ -152,16 +446,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value,
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value, const KeyType &new_key,
                                                     const ValueType &new_value) {
-  auto index = ValueIndex(old_value);
-  BPlusTreePage::IncreaseSize(1);
-
-  for (int i = BPlusTreePage::GetSize() - 1; i > index + 1; i--) {
-    array[i].first = array[i - 1].first;
-    array[i].second = array[i - 1].second;
-  }
-  array[index + 1].first = new_key;
-  array[index + 1].second = new_value;
-
+  InsertAt(ValueIndex(old_value) + 1, new_key, new_value);
   return BPlusTreePage::GetSize();
 }
 
@@ -170,43 +455,46 @@ int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value,
  *****************************************************************************/
 /*
  * Remove half of key & value pairs from this page to "recipient" page
+ * Both halves are stored in the narrowest layout that holds them; the recipient keeps its first key, which the tree
+ * moves up.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient,
                                                 BufferPoolManager *buffer_pool_manager) {
   // during split, right half need to be moved to a new page
   //
-  auto size = BPlusTreePage::GetSize();
-
-  int move_size = size - size / 2;
-  int start_index = size / 2;
+  std::vector<MappingType> items;
+  Decode(&items);
+  int start_index = items.size() / 2;
 
   // move half to; assume recipient is a new page
-  recipient->CopyNFrom(&array[start_index], move_size, buffer_pool_manager);
+  recipient->CopyNFrom(std::vector<MappingType>(items.begin() + start_index, items.end()), buffer_pool_manager);
 
   // update self
-  BPlusTreePage::SetSize(size / 2);
+  items.resize(start_index);
+  Encode(items);
 }
 
-/* Copy entries into me, starting from {items} and copy {size} entries.
+/* Copy entries into me, all of {items}.
  * Since it is an internal page, for all entries (pages) moved, their parents page now changes to me.
  * So I need to 'adopt' them by changing their parent page id, which needs to be persisted with BufferPoolManger
+ * B-link trees do not keep parent page ids and pass no BufferPoolManager.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager) {
-  for (int i = 0; i < size; i++) {
-    array[i] = *(items + i);  // copy
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(const std::vector<MappingType> &items,
+                                               BufferPoolManager *buffer_pool_manager) {
+  // copy; the first key is what the tree moves up, so it must be stored too
+  Encode(items, true);
+  if (buffer_pool_manager == nullptr) {
+    return;
+  }
 
+  for (const auto &item : items) {
     // adopt
-    auto page_id = array[i].second;
-    auto *child_page = buffer_pool_manager->FetchPage(page_id);
-    BPlusTreePage *b_plus_child_page = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
-    b_plus_child_page->SetParentPageId(BPlusTreePage::GetPageId());
-    buffer_pool_manager->UnpinPage(b_plus_child_page->GetPageId(), true);  // mark dirty
+    auto page_id = item.second;
+    BasicPageGuard child_guard = buffer_pool_manager->FetchPageBasic(page_id);
+    child_guard.AsMut<BPlusTreePage>()->SetParentPageId(BPlusTreePage::GetPageId());  // mark dirty
   }
-
-  // update self (because copy all N)
-  BPlusTreePage::SetSize(size);
 }
 
 /*****************************************************************************
@@ -223,14 +511,8 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
     LOG_ERROR("internal Page Remove");
   }
 
-  auto size = BPlusTreePage::GetSize();
-  for (int i = index; i < size - 1; i++) {
-    array[i].first = array[i + 1].first;
-    array[i].second = array[i + 1].second;
-  }
-
   // update self
-  BPlusTreePage::IncreaseSize(-1);
+  RemoveAt(index);
 }
 
 /*
@@ -240,7 +522,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
 INDEX_TEMPLATE_ARGUMENTS
 ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() {
   // with assumption that there is the only ONE key val pair
-  auto val = array[0].second;
+  auto val = ValueAt(0);
 
   BPlusTreePage::SetSize(0);
   return val;
@@ -261,23 +543,22 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient,
   // move to next page
   // recipient left, me right
   //
-  auto start_index = recipient->GetSize();
-  auto my_size = BPlusTreePage::GetSize();
-  recipient->IncreaseSize(my_size);
-
-  for (int i = 0; i < my_size; i++) {
-    recipient->array[i + start_index] = array[i];
-
+  recipient->SetNextPageId(next_page_id_);
+  recipient->SetHighKey(high_key_);
+  std::vector<MappingType> items;
+  recipient->Decode(&items);
+  auto start_index = items.size();
+  Decode(&items);
+  items[start_index].first = middle_key;  // that was my dummy key
+  recipient->Encode(items);
+
+  for (size_t i = start_index; i < items.size(); i++) {
     // adopt
-    auto page_id = array[i].second;
-    auto *child_page = buffer_pool_manager->FetchPage(page_id);
-    BPlusTreePage *b_plus_child_page = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
-    b_plus_child_page->SetParentPageId(recipient->GetPageId());
-    buffer_pool_manager->UnpinPage(b_plus_child_page->GetPageId(), true);  // mark dirty
+    auto page_id = items[i].second;
+    BasicPageGuard child_guard = buffer_pool_manager->FetchPageBasic(page_id);
+    child_guard.AsMut<BPlusTreePage>()->SetParentPageId(recipient->GetPageId());  // mark dirty
   }
 
-  recipient->SetKeyAt(start_index, middle_key);  // that was my dummy key
-
   BPlusTreePage::SetSize(0);
 }
 
@@ -295,15 +576,9 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient,
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                                                       BufferPoolManager *buffer_pool_manager) {
-  recipient->CopyLastFrom(array[0], buffer_pool_manager);
-  recipient->SetKeyAt(recipient->GetSize() - 1,
-                      middle_key);  // it was using my dummy key, so after move it needs upadte
-
-  for (int i = 0; i < BPlusTreePage::GetSize() - 1; i++) {
-    array[i].first = array[i + 1].first;
-    array[i].second = array[i + 1].second;
-  }
-  BPlusTreePage::IncreaseSize(-1);
+  // it was using my dummy key, so it moves with the middle key
+  recipient->CopyLastFrom({middle_key, ValueAt(0)}, buffer_pool_manager);
+  RemoveAt(0);
 }
 
 /* Append an entry at the end.
@@ -312,16 +587,12 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *rec
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
-  auto size = BPlusTreePage::GetSize();
-  BPlusTreePage::IncreaseSize(1);
-  array[size] = pair;
+  InsertAt(BPlusTreePage::GetSize(), pair.first, pair.second);
 
   // adopt
-  auto page_id = array[size].second;
-  auto *child_page = buffer_pool_manager->FetchPage(page_id);
-  BPlusTreePage *b_plus_child_page = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
-  b_plus_child_page->SetParentPageId(BPlusTreePage::GetPageId());
-  buffer_pool_manager->UnpinPage(b_plus_child_page->GetPageId(), true);  // mark dirty
+  auto page_id = pair.second;
+  BasicPageGuard child_guard = buffer_pool_manager->FetchPageBasic(page_id);
+  child_guard.AsMut<BPlusTreePage>()->SetParentPageId(BPlusTreePage::GetPageId());  // mark dirty
 }
 
 /*
@@ -334,7 +605,8 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, Buffe
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                                                        BufferPoolManager *buffer_pool_manager) {
-  recipient->CopyFirstFrom(array[BPlusTreePage::GetSize() - 1], buffer_pool_manager);
+  recipient->CopyFirstFrom({KeyAt(BPlusTreePage::GetSize() - 1), ValueAt(BPlusTreePage::GetSize() - 1)},
+                           buffer_pool_manager);
   recipient->SetKeyAt(1, middle_key);  // that was its dummy key, so it should be set to have meaningful value
   BPlusTreePage::IncreaseSize(-1);
 }
@@ -345,22 +617,13 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *re
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
-  auto size = BPlusTreePage::GetSize();
-  BPlusTreePage::IncreaseSize(1);
-
   // this assume the insert key < original key[0]
-  for (int i = size; i > 0; i--) {
-    array[i].first = array[i - 1].first;
-    array[i].second = array[i - 1].second;
-  }
-  array[0] = pair;
+  InsertAt(0, pair.first, pair.second);
 
   // adopt
-  auto page_id = array[0].second;
-  auto *child_page = buffer_pool_manager->FetchPage(page_id);
-  BPlusTreePage *b_plus_child_page = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
-  b_plus_child_page->SetParentPageId(BPlusTreePage::GetPageId());
-  buffer_pool_manager->UnpinPage(b_plus_child_page->GetPageId(), true);  // mark dirty
+  auto page_id = pair.second;
+  BasicPageGuard child_guard = buffer_pool_manager->FetchPageBasic(page_id);
+  child_guard.AsMut<BPlusTreePage>()->SetParentPageId(BPlusTreePage::GetPageId());  // mark dirty
 }
 
 // valuetype for internalNode should be page id_t
@@ -9,6 +9,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "common/exception.h"
@@ -26,15 +28,20 @@ namespace bustub {
  * Init method after creating a new leaf page
  * Including set page type, set current size to zero, set page id/parent id, set
  * next page id and set max size
+ * A compressed page starts out without a layout, and its max size follows the layout.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size, int key_size) {
   BPlusTreePage::SetPageType(IndexPageType::LEAF_PAGE);
   BPlusTreePage::SetPageId(page_id);
   BPlusTreePage::SetParentPageId(parent_id);
   BPlusTreePage::SetSize(0);
-  BPlusTreePage::SetMaxSize(max_size);
   next_page_id_ = INVALID_PAGE_ID;
+  key_size_ = key_size;
+  prefix_size_ = 0;
+  key_end_ = key_size == 0 ? sizeof(KeyType) : 0;
+  BPlusTreePage::SetMaxSize(key_size == 0 ? max_size
+                                          : CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), 0, 0));
 }
 
 /**
@@ -47,17 +54,27 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
 
 /**
- * Helper method to find the first index i so that array[i].first >= key
+ * Helper methods to set/get the high key, the lowest key of the next page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::GetHighKey() const { return high_key_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetHighKey(const KeyType &high_key) { high_key_ = high_key; }
+
+/**
+ * Helper method to get the key size of a compressed page, 0 if the page is not compressed
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::GetKeySize() const { return key_size_; }
+
+/**
+ * Helper method to find the first index i so that array[i].first >= key, or the size of the page if there is none
  * NOTE: This method is only used when generating index iterator
  **/
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const {
-  for (int i = 0; i < BPlusTreePage::GetSize(); i++) {
-    if (comparator(array[i].first, key) != -1) {
-      return i;
-    }
-  }
-  return -1;  // XXX??
+  return GetEntries().LowerBound(key, comparator);
 }
 
 /*
@@ -66,8 +83,8 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator
  */
 INDEX_TEMPLATE_ARGUMENTS
 KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
-  // replace with your own code
-  return array[index].first;
+  KeyType buf;
+  return GetEntries().KeyAt(index, &buf);
 }
 
 /*
@@ -75,56 +92,279 @@ KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
-  // replace with your own code
-  return array[index];
+MappingType B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) const {
+  Entries entries = GetEntries();
+  KeyType buf;
+  return {entries.KeyAt(index, &buf), entries.ValueAt(index)};
+}
+
+/*
+ * Helper methods to check whether a key fits, so that the tree can split first if it does not
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::HasRoomFor(const KeyType &key) const {
+  return key_size_ == 0 || BPlusTreePage::GetSize() + 1 < GetMaxSizeFor(key);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::GetMaxSizeFor(const KeyType &key) const {
+  if (key_size_ == 0) {
+    return BPlusTreePage::GetMaxSize();
+  }
+  int prefix_size;
+  int key_end;
+  WidenFor(key, &prefix_size, &key_end);
+  return CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), prefix_size, key_end);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::GetMaxSizeForAnyKey() const {
+  if (key_size_ == 0) {
+    return BPlusTreePage::GetMaxSize();
+  }
+  return std::min(BPlusTreePage::GetMaxSize(),
+                  CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), 0, key_size_));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::CanMerge(const BPlusTreeLeafPage *right) const {
+  int size = BPlusTreePage::GetSize() + right->GetSize();
+  if (key_size_ == 0) {
+    return size < BPlusTreePage::GetMaxSize();
+  }
+  std::vector<MappingType> items;
+  Decode(&items);
+  right->Decode(&items);
+  int prefix_size;
+  int key_end;
+  LayoutOf(items, &prefix_size, &key_end);
+  return size < CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), prefix_size, key_end);
 }
 
 /*****************************************************************************
- * INSERTION
+ * LAYOUT
  *****************************************************************************/
 /*
- * Insert key & value pair into leaf page ordered by key
- * @return  page size after insertion
+ * The layout fields are read once, and clamped so that fields that come from different writes still describe
+ * entries within the page
  */
 INDEX_TEMPLATE_ARGUMENTS
-int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator) {
-  int left = 0;
-  int right = BPlusTreePage::GetSize() - 1;
-  int mid;
-  int keyidx = 0;
+typename B_PLUS_TREE_LEAF_PAGE_TYPE::Entries B_PLUS_TREE_LEAF_PAGE_TYPE::GetEntries() const {
+  Entries entries;
+  entries.key_end_ = key_end_;
+  entries.prefix_size_ = std::min<int>(prefix_size_, entries.key_end_);
+  entries.slot_size_ = entries.key_end_ - entries.prefix_size_ + sizeof(ValueType);
+  entries.prefix_ = data_;
+  entries.slots_ = data_ + entries.prefix_size_;
+  entries.size_ = std::clamp(BPlusTreePage::GetSize(), 0, (DataSize() - entries.prefix_size_) / entries.slot_size_);
+  return entries;
+}
 
-  while (left + 1 < right) {
-    mid = (left + right) / 2;
-    if (comparator(array[mid].first, key) == 1) {  // array[mid] > key
-      right = mid;
-    } else if (comparator(array[mid].first, key) == -1) {
-      left = mid;
-    } else {
-      throw Exception(ExceptionType::INVALID, "leaf page insert");
-    }
+INDEX_TEMPLATE_ARGUMENTS
+const KeyType &B_PLUS_TREE_LEAF_PAGE_TYPE::Entries::KeyAt(int index, KeyType *buf) const {
+  const char *slot = slots_ + index * slot_size_;
+  if (prefix_size_ == 0 && key_end_ == static_cast<int>(sizeof(KeyType))) {
+    return *reinterpret_cast<const KeyType *>(slot);
   }
+  auto *key = reinterpret_cast<char *>(buf);
+  memcpy(key, prefix_, prefix_size_);
+  memcpy(key + prefix_size_, slot, key_end_ - prefix_size_);
+  memset(key + key_end_, 0, sizeof(KeyType) - key_end_);
+  return *buf;
+}
 
-  keyidx = left;
-  for (int i = left; i < right + 1; i++) {
-    if (comparator(array[i].first, key) == -1) {  // array[mid] > key
-      keyidx++;
+INDEX_TEMPLATE_ARGUMENTS
+ValueType B_PLUS_TREE_LEAF_PAGE_TYPE::Entries::ValueAt(int index) const {
+  ValueType value;
+  memcpy(&value, slots_ + index * slot_size_ + key_end_ - prefix_size_, sizeof(ValueType));
+  return value;
+}
+
+// the prefixes decide most comparisons; only ties go through the typed comparison of the keys
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::Entries::CompareAt(int index, const KeyType &key, uint64_t key_prefix,
+                                                   const KeyComparator &comparator) const {
+  KeyType buf;
+  const KeyType &entry_key = KeyAt(index, &buf);
+  int cmp = comparator.ComparePrefixes(comparator.KeyPrefix(entry_key), key_prefix);
+  return cmp != KeyComparator::PREFIX_TIE ? cmp : comparator(entry_key, key);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::Entries::LowerBound(const KeyType &key, const KeyComparator &comparator) const {
+  uint64_t key_prefix = comparator.KeyPrefix(key);
+  int left = 0;
+  int right = size_;
+  while (left < right) {
+    int mid = (left + right) / 2;
+    if (CompareAt(mid, key, key_prefix, comparator) < 0) {
+      left = mid + 1;
     } else {
-      break;
+      right = mid;
     }
   }
+  return left;
+}
+
+// bytes after the high key, which hold the prefix and the entries
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::DataSize() const {
+  return PageSizeOf(BPlusTreePage::GetPageId()) - LEAF_PAGE_HEADER_SIZE - static_cast<int>(sizeof(KeyType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_LEAF_PAGE_TYPE::SlotAt(int index) {
+  return data_ + prefix_size_ + index * (key_end_ - prefix_size_ + sizeof(ValueType));
+}
 
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::WriteEntry(int index, const KeyType &key, const ValueType &value) {
+  char *slot = SlotAt(index);
+  memcpy(slot, reinterpret_cast<const char *>(&key) + prefix_size_, key_end_ - prefix_size_);
+  memcpy(slot + key_end_ - prefix_size_, &value, sizeof(ValueType));
+}
+
+/*
+ * Insert the entry at index; a compressed page first widens its layout if the key needs it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::InsertAt(int index, const KeyType &key, const ValueType &value) {
+  if (key_size_ != 0) {
+    int prefix_size;
+    int key_end;
+    WidenFor(key, &prefix_size, &key_end);
+    if (prefix_size != prefix_size_ || key_end != key_end_) {
+      std::vector<MappingType> items;
+      Decode(&items);
+      Encode(items, prefix_size, key_end, reinterpret_cast<const char *>(&key));
+    }
+  }
+  auto size = BPlusTreePage::GetSize();
+  memmove(SlotAt(index + 1), SlotAt(index), SlotAt(size) - SlotAt(index));
+  WriteEntry(index, key, value);
   BPlusTreePage::IncreaseSize(1);
+}
+
+/*
+ * Remove the entry at index; the layout stays as it is
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAt(int index) {
+  auto size = BPlusTreePage::GetSize();
+  memmove(SlotAt(index), SlotAt(index + 1), SlotAt(size) - SlotAt(index + 1));
+  BPlusTreePage::IncreaseSize(-1);
+}
+
+/*
+ * Layout of a compressed page once it holds key as well: the prefix is cut to what key shares of it, and the entries
+ * reach up to the end of key if it is longer. A page without entries takes the layout of key alone.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::WidenFor(const KeyType &key, int *prefix_size, int *key_end) const {
+  const auto *bytes = reinterpret_cast<const char *>(&key);
+  int length = SignificantLength(bytes, sizeof(KeyType));
+  if (BPlusTreePage::GetSize() == 0) {
+    *prefix_size = length;
+    *key_end = length;
+    return;
+  }
+  *prefix_size = CommonPrefixLength(data_, bytes, prefix_size_);
+  *key_end = std::max<int>(key_end_, length);
+}
+
+/*
+ * Narrowest layout that holds the keys of items; pages that are not compressed store whole keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::LayoutOf(const std::vector<MappingType> &items, int *prefix_size,
+                                          int *key_end) const {
+  *prefix_size = 0;
+  *key_end = key_size_ == 0 ? sizeof(KeyType) : 0;
+  if (key_size_ == 0 || items.empty()) {
+    return;
+  }
+  const auto *first = reinterpret_cast<const char *>(&items[0].first);
+  *prefix_size = sizeof(KeyType);
+  for (const auto &item : items) {
+    const auto *bytes = reinterpret_cast<const char *>(&item.first);
+    *prefix_size = CommonPrefixLength(first, bytes, *prefix_size);
+    *key_end = std::max(*key_end, SignificantLength(bytes, sizeof(KeyType)));
+  }
+  *prefix_size = std::min(*prefix_size, *key_end);
+}
+
+/*
+ * Append the entries of the page to items
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Decode(std::vector<MappingType> *items) const {
+  Entries entries = GetEntries();
+  KeyType buf;
+  for (int i = 0; i < entries.size_; i++) {
+    items->emplace_back(entries.KeyAt(i, &buf), entries.ValueAt(i));
+  }
+}
+
+/*
+ * Replace the entries of the page with items, in the narrowest layout that holds them
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Encode(const std::vector<MappingType> &items) {
+  int prefix_size;
+  int key_end;
+  LayoutOf(items, &prefix_size, &key_end);
+  Encode(items, prefix_size, key_end, items.empty() ? nullptr : reinterpret_cast<const char *>(&items[0].first));
+}
+
+/*
+ * Replace the entries of the page with items, in the given layout; all keys begin with the prefix_size bytes at
+ * prefix. A compressed page takes the max size of the layout.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Encode(const std::vector<MappingType> &items, int prefix_size, int key_end,
+                                        const char *prefix) {
+  prefix_size_ = prefix_size;
+  key_end_ = key_end;
+  if (prefix_size > 0) {
+    memmove(data_, prefix, prefix_size);
+  }
+  for (size_t i = 0; i < items.size(); i++) {
+    WriteEntry(i, items[i].first, items[i].second);
+  }
+  BPlusTreePage::SetSize(items.size());
+  if (key_size_ != 0) {
+    BPlusTreePage::SetMaxSize(CompressedMaxSize(DataSize(), key_size_, sizeof(ValueType), prefix_size, key_end));
+  }
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Append key & value pair after the last pair; the caller adds keys in increasing order
+ * NOTE: This method is only called by BPlusTreeBuilder
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Append(const KeyType &key, const ValueType &value) {
+  InsertAt(BPlusTreePage::GetSize(), key, value);
+}
+
+/*
+ * Insert key & value pair into leaf page ordered by key
+ * @return  page size after insertion
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator) {
+  Entries entries = GetEntries();
+  int keyidx = entries.LowerBound(key, comparator);
 
   /**
   NOTE: unique key
   **/
-  for (int i = BPlusTreePage::GetSize() - 1; i > keyidx; i--) {
-    array[i].first = array[i - 1].first;
-    array[i].second = array[i - 1].second;
+  if (keyidx < entries.size_ && entries.CompareAt(keyidx, key, comparator.KeyPrefix(key), comparator) == 0) {
+    throw Exception(ExceptionType::INVALID, "leaf page insert");
   }
-  array[keyidx].first = key;
-  array[keyidx].second = value;
+  InsertAt(keyidx, key, value);
 
   // LOG_DEBUG("key: %ld - val: %d - insert index: %d - page_id: %d", key.ToString(), value.GetSlotNum(), keyidx,
   // GetPageId());
@@ -137,35 +377,22 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &valu
  *****************************************************************************/
 /*
  * Remove half of key & value pairs from this page to "recipient" page
+ * Both halves are stored in the narrowest layout that holds them.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {
   // during split, right half need to be moved to a new page
   //
-  auto size = BPlusTreePage::GetSize();
-
-  int move_size = size - size / 2;
-  int start_index = size / 2;
-
-  // LOG_DEBUG("key: %ld, val: %d", array[0].first.ToString(), array[0].second.GetSlotNum());
-  // LOG_DEBUG("key: %ld, val: %d", array[start_index].first.ToString(), array[start_index].second.GetSlotNum());
+  std::vector<MappingType> items;
+  Decode(&items);
+  int start_index = items.size() / 2;
 
   // move half to; assume recipient is a new page
-  recipient->CopyNFrom(&array[start_index], move_size);
+  recipient->Encode(std::vector<MappingType>(items.begin() + start_index, items.end()));
 
   // update self
-  BPlusTreePage::SetSize(size / 2);
-}
-
-/*
- * Copy starting from items, and copy {size} number of elements into me.
- */
-INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {
-  for (int i = 0; i < size; i++) {
-    array[i] = *(items + i);  // copy
-  }
-  BPlusTreePage::SetSize(size);  // update self (because copy all N)
+  items.resize(start_index);
+  Encode(items);
 }
 
 /*****************************************************************************
@@ -178,27 +405,11 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const {
-  int left = 0;
-  int right = BPlusTreePage::GetSize() - 1;
-  int mid;
-
-  while (left + 1 < right) {
-    mid = (left + right) / 2;
-    if (comparator(array[mid].first, key) == 1) {  // array[mid] > key
-      right = mid;
-    } else if (comparator(array[mid].first, key) == -1) {
-      left = mid;
-    } else {
-      *value = array[mid].second;
-      return true;
-    }
-  }
-
-  for (int i = left; i < right + 1; i++) {
-    if (comparator(array[i].first, key) == 0) {  // array[mid] > key
-      *value = array[i].second;
-      return true;
-    }
+  Entries entries = GetEntries();
+  int index = entries.LowerBound(key, comparator);
+  if (index < entries.size_ && entries.CompareAt(index, key, comparator.KeyPrefix(key), comparator) == 0) {
+    *value = entries.ValueAt(index);
+    return true;
   }
   return false;
 }
@@ -217,46 +428,10 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const
   /**
   NOTE: assume the keys are unique
   **/
-
-  int left = 0;
-  int right = BPlusTreePage::GetSize() - 1;
-  int mid;
-  bool found = false;
-  int id;
-
-  while (left + 1 < right) {
-    mid = (left + right) / 2;
-    if (comparator(array[mid].first, key) == 1) {  // array[mid] > key
-      right = mid;
-    } else if (comparator(array[mid].first, key) == -1) {
-      left = mid;
-    } else {
-      id = mid;
-      found = true;
-      break;
-    }
-  }
-
-  if (!found) {
-    for (int i = left; i < right + 1; i++) {
-      if (comparator(array[i].first, key) == 0) {  // array[mid] > key
-        id = i;
-        found = true;
-        break;
-      }
-    }
-  }
-
-  auto size = BPlusTreePage::GetSize();
-
-  if (found) {
-    for (int i = id; i < size - 1; i++) {
-      array[i].first = array[i + 1].first;
-      array[i].second = array[i + 1].second;
-    }
-
-    // update self
-    BPlusTreePage::IncreaseSize(-1);
+  Entries entries = GetEntries();
+  int index = entries.LowerBound(key, comparator);
+  if (index < entries.size_ && entries.CompareAt(index, key, comparator.KeyPrefix(key), comparator) == 0) {
+    RemoveAt(index);
   }
   return BPlusTreePage::GetSize();
 }
@@ -272,14 +447,12 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
   // because update next page id - so recipient left, me right
   recipient->SetNextPageId(GetNextPageId());
+  recipient->SetHighKey(high_key_);
 
-  auto start_index = recipient->GetSize();
-  auto my_size = BPlusTreePage::GetSize();
-  recipient->IncreaseSize(my_size);
-
-  for (int i = 0; i < my_size; i++) {
-    recipient->array[i + start_index] = array[i];
-  }
+  std::vector<MappingType> items;
+  recipient->Decode(&items);
+  Decode(&items);
+  recipient->Encode(items);
 
   BPlusTreePage::SetSize(0);
 }
@@ -292,13 +465,8 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {
-  recipient->CopyLastFrom(array[0]);
-
-  for (int i = 0; i < BPlusTreePage::GetSize() - 1; i++) {
-    array[i].first = array[i + 1].first;
-    array[i].second = array[i + 1].second;
-  }
-  BPlusTreePage::IncreaseSize(-1);
+  recipient->CopyLastFrom(GetItem(0));
+  RemoveAt(0);
 }
 
 /*
@@ -306,8 +474,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient)
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
-  array[BPlusTreePage::GetSize()] = item;
-  BPlusTreePage::IncreaseSize(1);
+  InsertAt(BPlusTreePage::GetSize(), item.first, item.second);
 }
 
 /*
@@ -315,7 +482,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {
-  recipient->CopyFirstFrom(array[BPlusTreePage::GetSize() - 1]);
+  recipient->CopyFirstFrom(GetItem(BPlusTreePage::GetSize() - 1));
   BPlusTreePage::IncreaseSize(-1);
 }
 
@@ -324,15 +491,8 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient)
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {
-  auto size = BPlusTreePage::GetSize();
-
   // this assume the insert key < original key[0]
-  for (int i = size; i > 0; i--) {
-    array[i].first = array[i - 1].first;
-    array[i].second = array[i - 1].second;
-  }
-  array[0] = item;
-  BPlusTreePage::IncreaseSize(1);
+  InsertAt(0, item.first, item.second);
 }
 
 template class BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
@@ -9,6 +9,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+
 #include "storage/page/b_plus_tree_page.h"
 #include "common/config.h"
 
@@ -68,4 +70,35 @@ void BPlusTreePage::SetPageId(page_id_t page_id) { page_id_ = page_id; }
  */
 void BPlusTreePage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
 
+/*
+ * Helper methods for the compressed page layout
+ */
+int BPlusTreePage::SignificantLength(const char *key, int key_size) {
+  while (key_size > 0 && key[key_size - 1] == 0) {
+    key_size--;
+  }
+  return key_size;
+}
+
+int BPlusTreePage::CommonPrefixLength(const char *lhs, const char *rhs, int length) {
+  int i = 0;
+  while (i < length && lhs[i] == rhs[i]) {
+    i++;
+  }
+  return i;
+}
+
+/*
+ * Max size of a compressed page with data_size bytes for its entries, whose keys have no nonzero byte past key_size,
+ * when it stores the bytes [prefix_size, key_end) of each key.
+ * Narrow entries let a page hold more of them, but a key that needs wider entries may come along when the page is
+ * full. Splitting the page then must leave room for the key in one half, even at the widest layout; so the max size
+ * is capped at twice what fits at the widest layout, less what keeps the halves below their max size.
+ */
+int BPlusTreePage::CompressedMaxSize(int data_size, int key_size, int value_size, int prefix_size, int key_end) {
+  int widest = data_size / (key_size + value_size);
+  int fit = (data_size - prefix_size) / (key_end - prefix_size + value_size);
+  return std::min(fit, 2 * widest - 4);
+}
+
 }  // namespace bustub
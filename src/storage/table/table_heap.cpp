@@ -10,7 +10,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
+#include <numeric>
+#include <utility>
 
 #include "common/logger.h"
 #include "storage/table/table_heap.h"
@@ -25,66 +28,64 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
       first_page_id_(first_page_id) {}
 
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
+                     Transaction *txn, PageSizeClass page_size_class)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager) {
   // Initialize the first table page.
-  auto first_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_));
-  BUSTUB_ASSERT(first_page != nullptr, "Couldn't create a page for the table heap.");
-  first_page->WLatch();
-  first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
-  first_page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(first_page_id_, true);
+  auto first_page_guard = buffer_pool_manager_->NewPageGuarded(&first_page_id_, page_size_class);
+  BUSTUB_ASSERT(first_page_guard.IsValid(), "Couldn't create a page for the table heap.");
+  first_page_guard.UpgradeWrite().AsPage<TablePage>()->Init(first_page_id_, PageSizeOf(first_page_id_), INVALID_LSN,
+                                                             log_manager_, txn);
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) {  // larger than one page size
+  // every page of the table has the size of the first one
+  if (tuple.size_ + 32 > static_cast<uint32_t>(PageSizeOf(first_page_id_))) {  // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
 
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
-  if (cur_page == nullptr) {
+  auto cur_page_guard = buffer_pool_manager_->FetchPageWrite(first_page_id_);
+  if (!cur_page_guard.IsValid()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  auto cur_page = cur_page_guard.AsPage<TablePage>();
 
-  cur_page->WLatch();
   // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
-  // INVARIANT: cur_page is WLatched if you leave the loop normally.
+  // The guard releases whichever page we are on when we leave, normally or not.
   while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
     auto next_page_id = cur_page->GetNextPageId();
     // If the next page is a valid page,
     if (next_page_id != INVALID_PAGE_ID) {
-      // Unlatch and unpin the current page.
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
-      // And repeat the process with the next page.
-      cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
-      cur_page->WLatch();
+      // Release the current page and repeat the process with the next page.
+      cur_page_guard.Drop();
+      cur_page_guard = buffer_pool_manager_->FetchPageWrite(next_page_id);
+      if (!cur_page_guard.IsValid()) {
+        txn->SetState(TransactionState::ABORTED);
+        return false;
+      }
+      cur_page = cur_page_guard.AsPage<TablePage>();
     } else {
       // Otherwise we have run out of valid pages. We need to create a new page.
-      auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id));
+      auto new_page_guard = buffer_pool_manager_->NewPageGuarded(&next_page_id, GetPageSizeClass(first_page_id_));
       // If we could not create a new page,
-      if (new_page == nullptr) {
+      if (!new_page_guard.IsValid()) {
         // Then life sucks and we abort the transaction.
-        cur_page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
         txn->SetState(TransactionState::ABORTED);
         return false;
       }
       // Otherwise we were able to create a new page. We initialize it now.
-      new_page->WLatch();
+      auto new_page_write_guard = new_page_guard.UpgradeWrite();
+      auto new_page = new_page_write_guard.AsPage<TablePage>();
       cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
+      cur_page_guard.SetDirty();
+      new_page->Init(next_page_id, PageSizeOf(next_page_id), cur_page->GetTablePageId(), log_manager_, txn);
+      cur_page_guard = std::move(new_page_write_guard);
       cur_page = new_page;
     }
   }
-  // This line has caused most of us to double-take and "whoa double unlatch".
-  // We are not, in fact, double unlatching. See the invariant above.
-  cur_page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
+  cur_page_guard.SetDirty();
+  cur_page_guard.Drop();
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
   return true;
@@ -93,17 +94,16 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   // TODO(Amadou): remove empty page
   // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  auto page_guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
   // If the page could not be found, then abort the transaction.
-  if (page == nullptr) {
+  if (!page_guard.IsValid()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
   // Otherwise, mark the tuple as deleted.
-  page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+  page_guard.AsPage<TablePage>()->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  page_guard.SetDirty();
+  page_guard.Drop();
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
   return true;
@@ -111,18 +111,20 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
 
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  auto page_guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
   // If the page could not be found, then abort the transaction.
-  if (page == nullptr) {
+  if (!page_guard.IsValid()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
   // Update the tuple; but first save the old value for rollbacks.
   Tuple old_tuple;
-  page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
+  bool is_updated =
+      page_guard.AsPage<TablePage>()->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  if (is_updated) {
+    page_guard.SetDirty();
+  }
+  page_guard.Drop();
   // Update the transaction's write set.
   if (is_updated && txn->GetState() != TransactionState::ABORTED) {
     txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
@@ -132,41 +134,77 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
 
 void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
-  BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  auto page_guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+  BUSTUB_ASSERT(page_guard.IsValid(), "Couldn't find a page containing that RID.");
   // Delete the tuple from the page.
-  page->WLatch();
-  page->ApplyDelete(rid, txn, log_manager_);
+  page_guard.AsPage<TablePage>()->ApplyDelete(rid, txn, log_manager_);
+  page_guard.SetDirty();
   lock_manager_->Unlock(txn, rid);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
 }
 
 void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
-  BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  auto page_guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+  BUSTUB_ASSERT(page_guard.IsValid(), "Couldn't find a page containing that RID.");
   // Rollback the delete.
-  page->WLatch();
-  page->RollbackDelete(rid, txn, log_manager_);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+  page_guard.AsPage<TablePage>()->RollbackDelete(rid, txn, log_manager_);
+  page_guard.SetDirty();
 }
 
 bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
   // Find the page which contains the tuple.
-  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  auto page_guard = buffer_pool_manager_->FetchPageRead(rid.GetPageId());
   // If the page could not be found, then abort the transaction.
-  if (page == nullptr) {
+  if (!page_guard.IsValid()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
   // Read the tuple from the page.
-  page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
-  page->RUnlatch();
-  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
-  return res;
+  return page_guard.AsPage<TablePage>()->GetTuple(rid, tuple, txn, lock_manager_);
+}
+
+bool TableHeap::GetTuples(const std::vector<RID> &rids, std::vector<Tuple> *tuples, Transaction *txn) {
+  std::vector<size_t> order(rids.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return rids[lhs].GetPageId() != rids[rhs].GetPageId() ? rids[lhs].GetPageId() < rids[rhs].GetPageId()
+                                                          : rids[lhs].GetSlotNum() < rids[rhs].GetSlotNum();
+  });
+  std::vector<page_id_t> page_ids;
+  for (size_t i : order) {
+    if (page_ids.empty() || page_ids.back() != rids[i].GetPageId()) {
+      page_ids.push_back(rids[i].GetPageId());
+    }
+  }
+  tuples->resize(rids.size());
+  if (page_ids.empty()) {
+    return true;
+  }
+
+  // a window that is large relative to the pool evicts prefetched pages before they are read, as in table scans
+  size_t read_ahead =
+      std::min<size_t>(table_scan_read_ahead, buffer_pool_manager_->GetPoolSize(GetPageSizeClass(page_ids[0])) / 4);
+  for (size_t i = 1; i <= read_ahead && i < page_ids.size(); i++) {
+    buffer_pool_manager_->PrefetchPages(page_ids[i], 1);
+  }
+  size_t next = 0;
+  for (size_t page = 0; page < page_ids.size(); page++) {
+    if (read_ahead > 0 && page + read_ahead < page_ids.size() && page > 0) {
+      buffer_pool_manager_->PrefetchPages(page_ids[page + read_ahead], 1);
+    }
+    auto page_guard = buffer_pool_manager_->FetchPageRead(page_ids[page]);
+    if (!page_guard.IsValid()) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    auto *table_page = page_guard.AsPage<TablePage>();
+    for (; next < order.size() && rids[order[next]].GetPageId() == page_ids[page]; next++) {
+      if (!table_page->GetTuple(rids[order[next]], &(*tuples)[order[next]], txn, lock_manager_)) {
+        return false;
+      }
+    }
+  }
+  return true;
 }
 
 TableIterator TableHeap::Begin(Transaction *txn) {
@@ -174,14 +212,16 @@ TableIterator TableHeap::Begin(Transaction *txn) {
   // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
   RID rid;
   auto page_id = first_page_id_;
+  size_t read_ahead =
+      std::min<size_t>(table_scan_read_ahead, buffer_pool_manager_->GetPoolSize(GetPageSizeClass(page_id)) / 4);
+  if (read_ahead > 0) {
+    buffer_pool_manager_->PrefetchPages(NextPageId(first_page_id_), read_ahead);
+  }
   while (page_id != INVALID_PAGE_ID) {
-    auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
-    page->RLatch();
+    auto page_guard = buffer_pool_manager_->FetchPageRead(page_id);
+    auto page = page_guard.AsPage<TablePage>();
     // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
-    page->RUnlatch();
-    buffer_pool_manager_->UnpinPage(page_id, false);
-    if (found_tuple) {
+    if (page->GetFirstTupleRid(&rid)) {
       break;
     }
     page_id = page->GetNextPageId();
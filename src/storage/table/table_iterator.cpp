@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
 
 #include "common/logger.h"
@@ -36,19 +37,30 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  auto cur_page_guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId());
+  assert(cur_page_guard.IsValid());  // all pages are pinned
+  auto cur_page = cur_page_guard.AsPage<TablePage>();
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      page_id_t next_page_id = cur_page->GetNextPageId();
+      // a window that is large relative to the pool evicts prefetched pages before the scan gets to them
+      size_t read_ahead =
+          std::min<size_t>(table_scan_read_ahead, buffer_pool_manager->GetPoolSize(GetPageSizeClass(next_page_id)) / 4);
+      if (read_ahead > 0) {
+        // tables grow by allocating pages in order, so the chain is usually sequential: keep the window topped up
+        // with one page per step, and restart a full window after a jump
+        if (next_page_id == NextPageId(cur_page->GetTablePageId())) {
+          buffer_pool_manager->PrefetchPages(NextPageId(next_page_id, static_cast<page_id_t>(read_ahead)), 1);
+        } else {
+          buffer_pool_manager->PrefetchPages(NextPageId(next_page_id), read_ahead);
+        }
+      }
+      // the assignment releases the current page once the next one is latched
+      cur_page_guard = buffer_pool_manager->FetchPageRead(next_page_id);
+      cur_page = cur_page_guard.AsPage<TablePage>();
       if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
         break;
       }
@@ -57,11 +69,9 @@ TableIterator &TableIterator::operator++() {
   tuple_->rid_ = next_tuple_rid;
 
   if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+    // the page is latched already, so read the tuple off it instead of fetching it once more
+    cur_page->GetTuple(tuple_->rid_, tuple_, txn_, table_heap_->lock_manager_);
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
   return *this;
 }
 
@@ -0,0 +1,506 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager_benchmark_test.cpp
+//
+// Identification: test/buffer/buffer_pool_manager_benchmark_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+namespace {
+
+const size_t kPoolSize = 64;
+const size_t kWorkingSet = 128;
+const size_t kOpsPerThread = 2000;
+
+/** @return printable name of a replacement policy */
+const char *ReplacerName(ReplacerType replacer_type) {
+  switch (replacer_type) {
+    case ReplacerType::CLOCK:
+      return "clock";
+    case ReplacerType::LRU_K:
+      return "lru-k";
+    default:
+      return "lru";
+  }
+}
+
+/**
+ * Every thread fetches pages from a skewed distribution over the working set (80% of the accesses go to the
+ * hottest 20% of the pages), writes to one in four of them and unpins. Prints throughput and hit rate.
+ */
+void RunFetchUnpinWorkload(size_t num_instances, size_t num_threads, ReplacerType replacer_type) {
+  const std::string db_name = "bpm_bench.db";
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(num_instances, kPoolSize / num_instances, disk_manager, nullptr, replacer_type);
+
+  // populate the working set on disk
+  for (size_t i = 0; i < kWorkingSet; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+
+  const int reads_before = disk_manager->GetNumReads();
+  std::vector<size_t> failed(num_threads, 0);
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid, &failed] {
+      std::mt19937 rng(static_cast<uint32_t>(tid) + 1);
+      std::uniform_int_distribution<size_t> pct(0, 99);
+      std::uniform_int_distribution<size_t> hot(0, kWorkingSet / 5 - 1);
+      std::uniform_int_distribution<size_t> cold(kWorkingSet / 5, kWorkingSet - 1);
+      for (size_t op = 0; op < kOpsPerThread; ++op) {
+        auto page_id = static_cast<page_id_t>(pct(rng) < 80 ? hot(rng) : cold(rng));
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          failed[tid]++;
+          continue;
+        }
+        bool dirty = (op % 4 == 0);
+        if (dirty) {
+          page->WLatch();
+          page->GetData()[PAGE_SIZE - 1] = static_cast<char>(op);
+          page->WUnlatch();
+        }
+        bpm->UnpinPage(page_id, dirty);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  size_t total_failed = 0;
+  for (auto f : failed) {
+    total_failed += f;
+  }
+  const size_t total_ops = num_threads * kOpsPerThread;
+  const size_t misses = disk_manager->GetNumReads() - reads_before;
+  printf("%-5s instances=%2zu threads=%2zu  %10.0f ops/s  hit rate %5.1f%%  (failed fetches %zu)\n",
+         ReplacerName(replacer_type), num_instances, num_threads, total_ops / elapsed,
+         100.0 * (total_ops - total_failed - misses) / total_ops, total_failed);
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bpm_bench.log");
+  remove("bpm_bench.fsm");
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * Every page of the working set is resident, so every FetchPage is a hit. Each thread times its own FetchPage +
+ * UnpinPage pairs; prints latency percentiles over all threads.
+ */
+void RunHitLatencyWorkload(size_t num_threads, ReplacerType replacer_type) {
+  const std::string db_name = "bpm_bench.db";
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(kPoolSize, disk_manager, nullptr, replacer_type);
+
+  for (size_t i = 0; i < kPoolSize; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, false);
+  }
+
+  std::vector<std::vector<int64_t>> latencies(num_threads);
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid, &latencies] {
+      std::mt19937 rng(static_cast<uint32_t>(tid) + 1);
+      std::uniform_int_distribution<page_id_t> dist(0, kPoolSize - 1);
+      auto &samples = latencies[tid];
+      samples.reserve(kOpsPerThread * 5);
+      for (size_t op = 0; op < kOpsPerThread * 5; ++op) {
+        auto page_id = dist(rng);
+        auto start = std::chrono::steady_clock::now();
+        auto *page = bpm->FetchPage(page_id);
+        bpm->UnpinPage(page_id, false);
+        auto end = std::chrono::steady_clock::now();
+        ASSERT_NE(nullptr, page);
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<int64_t> all;
+  for (auto &samples : latencies) {
+    all.insert(all.end(), samples.begin(), samples.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto percentile = [&all](double p) { return all[static_cast<size_t>(p * (all.size() - 1))]; };
+  printf("%-5s threads=%2zu  hit latency ns: p50 %6ld  p90 %6ld  p99 %6ld  p99.9 %7ld\n",
+         ReplacerName(replacer_type), num_threads, percentile(0.5), percentile(0.9),
+         percentile(0.99), percentile(0.999));
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bpm_bench.log");
+  remove("bpm_bench.fsm");
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * Point lookups on a small hot set (think B+ tree inner pages) interleaved with a sequential scan over a table that
+ * is many times the size of the pool. Prints the hit ratio of the lookups and of all accesses.
+ */
+void RunScanResistanceWorkload(ReplacerType replacer_type) {
+  const std::string db_name = "bpm_bench.db";
+  const size_t hot_pages = kPoolSize * 3 / 4;
+  const size_t table_pages = kPoolSize * 8;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(kPoolSize, disk_manager, nullptr, replacer_type);
+
+  for (size_t i = 0; i < hot_pages + table_pages; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<page_id_t> hot(0, hot_pages - 1);
+  auto access = [bpm, disk_manager](page_id_t page_id) {
+    int reads = disk_manager->GetNumReads();
+    auto *page = bpm->FetchPage(page_id);
+    EXPECT_NE(nullptr, page);
+    bpm->UnpinPage(page_id, false);
+    return disk_manager->GetNumReads() == reads;
+  };
+
+  // warm up the hot set, then run three scans with one point lookup per scanned page
+  for (int round = 0; round < 4; ++round) {
+    for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(hot_pages); ++page_id) {
+      access(page_id);
+    }
+  }
+  size_t lookups = 0;
+  size_t lookup_hits = 0;
+  size_t scans = 0;
+  size_t scan_hits = 0;
+  for (int round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < table_pages; ++i) {
+      scan_hits += access(static_cast<page_id_t>(hot_pages + i)) ? 1 : 0;
+      scans++;
+      lookup_hits += access(hot(rng)) ? 1 : 0;
+      lookups++;
+    }
+  }
+  printf("%-5s point lookup hit ratio %5.1f%%  overall hit ratio %5.1f%%\n", ReplacerName(replacer_type),
+         100.0 * lookup_hits / lookups, 100.0 * (lookup_hits + scan_hits) / (lookups + scans));
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bpm_bench.log");
+  remove("bpm_bench.fsm");
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * Threads fetch uniformly from a working set four times the pool and dirty half of the pages they touch, so most
+ * misses evict a dirty page. Prints throughput and who wrote the dirty victims back, with and without the flusher.
+ */
+void RunWriteBackWorkload(bool flush_thread) {
+  const std::string db_name = "bpm_bench.db";
+  const size_t num_threads = 4;
+  const size_t working_set = kPoolSize * 4;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(4, kPoolSize / 4, disk_manager);
+
+  for (size_t i = 0; i < working_set; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, false);
+  }
+  bpm->FlushAllPages();
+  const uint64_t foreground_before = bpm->GetNumForegroundWrites();
+
+  if (flush_thread) {
+    bpm->RunFlushThread();
+  }
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid, working_set] {
+      std::mt19937 rng(static_cast<uint32_t>(tid) + 1);
+      std::uniform_int_distribution<page_id_t> dist(0, working_set - 1);
+      for (size_t op = 0; op < kOpsPerThread; ++op) {
+        auto page_id = dist(rng);
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        bool dirty = (op % 2 == 0);
+        if (dirty) {
+          page->WLatch();
+          page->GetData()[0] = static_cast<char>(op);
+          page->WUnlatch();
+        }
+        bpm->UnpinPage(page_id, dirty);
+        // leave the flusher some room, as a real query would between page accesses
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double dirty_ratio = bpm->GetDirtyRatio();
+  bpm->StopFlushThread();
+
+  printf("flusher %-3s  %9.0f ops/s  foreground writes %5lu  background writes %5lu (%8.0f pages/s)  dirty %4.1f%%\n",
+         flush_thread ? "on" : "off", num_threads * kOpsPerThread / elapsed,
+         bpm->GetNumForegroundWrites() - foreground_before, bpm->GetNumBackgroundWrites(),
+         bpm->GetBackgroundWriteThroughput(), 100.0 * dirty_ratio);
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bpm_bench.log");
+  remove("bpm_bench.fsm");
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * Every thread fetches uniformly random pages from a file sixteen times the size of the pool, so almost every fetch
+ * misses, evicts and reads. Prints throughput.
+ */
+void RunRandomMissWorkload(size_t num_threads) {
+  const std::string db_name = "bpm_bench.db";
+  const size_t file_pages = kPoolSize * 16;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(kPoolSize, disk_manager);
+
+  for (size_t i = 0; i < file_pages; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+
+  const int reads_before = disk_manager->GetNumReads();
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid, file_pages] {
+      std::mt19937 rng(static_cast<uint32_t>(tid) + 1);
+      std::uniform_int_distribution<page_id_t> dist(0, file_pages - 1);
+      for (size_t op = 0; op < kOpsPerThread; ++op) {
+        auto page_id = dist(rng);
+        if (bpm->FetchPage(page_id) != nullptr) {
+          bpm->UnpinPage(page_id, false);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("threads=%2zu  %9.0f fetches/s  %9.0f reads/s\n", num_threads, num_threads * kOpsPerThread / elapsed,
+         (disk_manager->GetNumReads() - reads_before) / elapsed);
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bpm_bench.log");
+  remove("bpm_bench.fsm");
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * Dirties a 64 MB pool spread over four instances in random frame order and flushes it, either the way FlushAllPages
+ * used to (one write per frame, in frame order) or through FlushAllPages. Prints the time each took, including fsync.
+ */
+void RunFlushAllWorkload(bool vectored) {
+  const std::string db_name = "bpm_bench.db";
+  const size_t flush_pool_size = 16384;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(4, flush_pool_size / 4, disk_manager);
+
+  // fill the file with twice the pool, then update the first half in random order, so that the frames hold the dirty
+  // pages in no particular order, as they would after random updates
+  for (size_t i = 0; i < flush_pool_size * 2; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+  bpm->FlushAllPages();
+  std::vector<page_id_t> page_ids(flush_pool_size);
+  for (size_t i = 0; i < flush_pool_size; ++i) {
+    page_ids[i] = static_cast<page_id_t>(i);
+  }
+  std::shuffle(page_ids.begin(), page_ids.end(), std::mt19937(42));
+  for (page_id_t page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    page->GetData()[0] = static_cast<char>(page_id);
+    bpm->UnpinPage(page_id, true);
+  }
+
+  const int write_calls_before = disk_manager->GetNumWriteCalls();
+  auto start = std::chrono::steady_clock::now();
+  if (vectored) {
+    bpm->FlushAllPages();
+  } else {
+    Page *pages = bpm->GetPages();
+    for (size_t i = 0; i < flush_pool_size; ++i) {
+      disk_manager->WritePage(pages[i].GetPageId(), pages[i].GetData());
+    }
+    // fsync through any descriptor of the file syncs all of it
+    int fd = open(db_name.c_str(), O_RDWR);
+    fsync(fd);
+    close(fd);
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%-28s %6zu MB in %8.1f ms  write calls %6d\n", vectored ? "FlushAllPages" : "WritePage per frame + fsync",
+         flush_pool_size * PAGE_SIZE >> 20, elapsed * 1e3, disk_manager->GetNumWriteCalls() - write_calls_before);
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bpm_bench.log");
+  remove("bpm_bench.fsm");
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * Keeps a fixed number of live pages while deleting a random quarter of them and allocating replacements, round
+ * after round, the way a table or index under constant insert/delete churn does. Prints how many pages were ever
+ * allocated against how many pages the file spans, which is what deleted pages not being reused would cost.
+ */
+void RunDeleteChurnWorkload() {
+  const std::string db_name = "bpm_bench.db";
+  const size_t live_pages = 1024;
+  const size_t rounds = 32;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(4, kPoolSize / 4, disk_manager);
+
+  std::vector<page_id_t> live;
+  size_t num_allocated = 0;
+  auto allocate = [&] {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    page->GetData()[0] = 1;
+    bpm->UnpinPage(page_id, true);
+    live.push_back(page_id);
+    num_allocated++;
+  };
+  for (size_t i = 0; i < live_pages; ++i) {
+    allocate();
+  }
+  std::mt19937 rng(42);
+  for (size_t round = 0; round < rounds; ++round) {
+    std::shuffle(live.begin(), live.end(), rng);
+    for (size_t i = 0; i < live_pages / 4; ++i) {
+      EXPECT_TRUE(bpm->DeletePage(live.back()));
+      live.pop_back();
+    }
+    for (size_t i = 0; i < live_pages / 4; ++i) {
+      allocate();
+    }
+  }
+  bpm->FlushAllPages();
+
+  printf("live pages %zu  pages allocated %zu  file pages %zu  free pages %zu\n", live.size(), num_allocated,
+         disk_manager->GetNumDiskPages(), disk_manager->GetNumFreePages());
+  // every page id the file spans is either live or waiting in the free-space map
+  EXPECT_EQ(live_pages, disk_manager->GetNumDiskPages());
+
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("bpm_bench.log");
+  remove("bpm_bench.fsm");
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, ShardedFetchUnpinTest) {
+  for (auto replacer_type : {ReplacerType::LRU, ReplacerType::CLOCK, ReplacerType::LRU_K}) {
+    for (size_t num_instances : {1, 4, 16}) {
+      for (size_t num_threads : {1, 2, 4, 8, 16, 32}) {
+        RunFetchUnpinWorkload(num_instances, num_threads, replacer_type);
+      }
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, HitLatencyTest) {
+  for (auto replacer_type : {ReplacerType::LRU, ReplacerType::CLOCK, ReplacerType::LRU_K}) {
+    for (size_t num_threads : {1, 4, 16}) {
+      RunHitLatencyWorkload(num_threads, replacer_type);
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, RandomMissTest) {
+  for (size_t num_threads : {1, 4, 16, 32}) {
+    RunRandomMissWorkload(num_threads);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, BackgroundFlushTest) {
+  auto interval = page_flush_interval;
+  page_flush_interval = std::chrono::milliseconds(1);
+  RunWriteBackWorkload(false);
+  RunWriteBackWorkload(true);
+  page_flush_interval = interval;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, ScanResistanceTest) {
+  for (auto replacer_type : {ReplacerType::LRU, ReplacerType::CLOCK, ReplacerType::LRU_K}) {
+    RunScanResistanceWorkload(replacer_type);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, FlushAllTest) {
+  RunFlushAllWorkload(false);
+  RunFlushAllWorkload(true);
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerBenchmarkTest, DeleteChurnTest) { RunDeleteChurnWorkload(); }
+
+}  // namespace bustub
@@ -11,9 +11,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager.h"
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "gtest/gtest.h"
 
 namespace bustub {
@@ -141,4 +146,341 @@ TEST(BufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ClockReplacerTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager, nullptr, ReplacerType::CLOCK);
+
+  // Scenario: fill the pool, then unpin everything.
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  for (page_id_t i = 0; i < static_cast<page_id_t>(buffer_pool_size); ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(i, true));
+  }
+
+  // Scenario: the clock evicts every unpinned page in turn to make room for new ones.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  }
+
+  // Scenario: evicted dirty pages were written back.
+  for (page_id_t i = 0; i < static_cast<page_id_t>(buffer_pool_size); ++i) {
+    auto *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(i)).c_str()));
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, FlushThreadTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  // Scenario: fill the pool with dirty, unpinned pages.
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+  EXPECT_DOUBLE_EQ(1.0, bpm->GetDirtyRatio());
+
+  // Scenario: the flush thread cleans the pages closest to eviction.
+  bpm->RunFlushThread();
+  for (int i = 0; i < 100 && bpm->GetNumBackgroundWrites() < buffer_pool_size / 4; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  bpm->StopFlushThread();
+  EXPECT_GE(bpm->GetNumBackgroundWrites(), buffer_pool_size / 4);
+  EXPECT_GT(bpm->GetBackgroundWriteThroughput(), 0.0);
+  EXPECT_LT(bpm->GetDirtyRatio(), 1.0);
+
+  // Scenario: a miss that evicts one of those pages does not have to write it back.
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(0, bpm->GetNumForegroundWrites());
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+
+  // Scenario: the evicted page was written back by the flush thread.
+  auto *page0 = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, page0);
+  EXPECT_EQ(0, strcmp(page0->GetData(), "page 0"));
+  EXPECT_EQ(true, bpm->UnpinPage(0, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ConcurrentMissTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const size_t num_pages = 32;
+  const size_t num_threads = 8;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < num_pages; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: threads missing on the same cold page share one read of it.
+  for (page_id_t target = 0; target < 8; ++target) {
+    int reads_before = disk_manager->GetNumReads();
+    std::atomic<size_t> fetched{0};
+    std::vector<std::thread> threads;
+    for (size_t tid = 0; tid < num_threads; ++tid) {
+      threads.emplace_back([bpm, target, &fetched] {
+        auto *page = bpm->FetchPage(target);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(target)).c_str()));
+        // hold the pin until every thread has fetched, so the page cannot be evicted and read again
+        fetched++;
+        while (fetched < num_threads) {
+          std::this_thread::yield();
+        }
+        EXPECT_EQ(true, bpm->UnpinPage(target, false));
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(1, disk_manager->GetNumReads() - reads_before);
+  }
+
+  // Scenario: threads missing on different pages read each of them back intact, while evicting dirty pages.
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid] {
+      for (size_t i = 0; i < 200; ++i) {
+        auto page_id = static_cast<page_id_t>((tid * 7 + i * 13) % num_pages);
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(page_id)).c_str()));
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, i % 3 == 0));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, ParallelInstanceTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 4;
+  const size_t instance_size = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(num_instances, instance_size, disk_manager);
+  EXPECT_EQ(num_instances, bpm->GetNumInstances());
+  EXPECT_EQ(num_instances * instance_size, bpm->GetPoolSize());
+
+  // Scenario: sequentially allocated pages spread over all instances, so the whole pool can be filled.
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < num_instances * instance_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(static_cast<page_id_t>(i), page_id_temp);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+
+  // Scenario: a page lives in instance (page_id % num_instances) and therefore in that instance's slice of frames.
+  for (page_id_t i = 0; i < static_cast<page_id_t>(num_instances * instance_size); ++i) {
+    auto *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    size_t frame = page - bpm->GetPages();
+    EXPECT_EQ(static_cast<size_t>(i) % num_instances, frame / instance_size);
+    EXPECT_EQ(true, bpm->UnpinPage(i, false));
+  }
+
+  // Scenario: when the instance a fresh page id maps to is full, NewPage moves on to the next instance.
+  for (page_id_t i = 0; i < static_cast<page_id_t>(num_instances * instance_size); ++i) {
+    if (i % num_instances == 1) {
+      EXPECT_EQ(true, bpm->UnpinPage(i, true));
+    }
+  }
+  page_id_t last_page_id = INVALID_PAGE_ID;
+  for (size_t i = 0; i < instance_size; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(&last_page_id));
+    EXPECT_EQ(1, last_page_id % static_cast<page_id_t>(num_instances));
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+
+  // Scenario: evicted pages are written back and can be read again once a frame of their instance frees up.
+  EXPECT_EQ(nullptr, bpm->FetchPage(1));
+  EXPECT_EQ(true, bpm->UnpinPage(last_page_id, false));
+  auto *page1 = bpm->FetchPage(1);
+  ASSERT_NE(nullptr, page1);
+  EXPECT_EQ(0, strcmp(page1->GetData(), "page 1"));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(2, buffer_pool_size / 2, disk_manager);
+
+  // Scenario: write out twice as many pages as fit, so that the first half is no longer resident.
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size * 2; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: prefetching pages past the end of the file is a no-op.
+  bpm->PrefetchPages(buffer_pool_size * 2, 4);
+
+  // Scenario: prefetch the first half and wait until the prefetch thread has read it.
+  const int reads_before = disk_manager->GetNumReads();
+  bpm->PrefetchPages(0, buffer_pool_size);
+  for (int i = 0; i < 100 && bpm->GetNumPrefetches() < buffer_pool_size; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(buffer_pool_size, bpm->GetNumPrefetches());
+  EXPECT_EQ(reads_before + static_cast<int>(buffer_pool_size), disk_manager->GetNumReads());
+
+  // Scenario: the prefetched pages are hits with the right contents, and none of them were left pinned.
+  char expected[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(reads_before + static_cast<int>(buffer_pool_size), disk_manager->GetNumReads());
+
+  // Scenario: prefetching resident pages queues nothing.
+  bpm->PrefetchPages(0, buffer_pool_size);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(buffer_pool_size, bpm->GetNumPrefetches());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, PageSizeClassTest) {
+  const std::string db_name = "test.db";
+  const size_t num_instances = 2;
+  const std::array<size_t, NUM_PAGE_SIZE_CLASSES> pool_sizes{4, 2, 2};
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(num_instances, pool_sizes, disk_manager);
+  EXPECT_EQ(8U, bpm->GetPoolSize());
+  EXPECT_EQ(4U, bpm->GetPoolSize(PageSizeClass::PAGE_64K));
+  EXPECT_EQ(static_cast<size_t>(PageSizeOfClass(PageSizeClass::PAGE_16K)),
+            bpm->GetFrameArray(PageSizeClass::PAGE_16K)->GetFrameSize());
+
+  // Scenario: each size class has frames of its own size, and pages of different sizes share the file.
+  page_id_t page_id_4k;
+  auto *page_4k = bpm->NewPage(&page_id_4k);
+  ASSERT_NE(nullptr, page_4k);
+  EXPECT_EQ(PAGE_SIZE, page_4k->GetSize());
+  std::vector<page_id_t> page_ids_64k;
+  for (int i = 0; i < 8; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id, PageSizeClass::PAGE_64K);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(PageSizeClass::PAGE_64K, GetPageSizeClass(page_id));
+    EXPECT_EQ(MAX_PAGE_SIZE, page->GetSize());
+    page->GetData()[0] = static_cast<char>(i);
+    page->GetData()[MAX_PAGE_SIZE - 1] = static_cast<char>(i);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    page_ids_64k.push_back(page_id);
+  }
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_4k, false));
+
+  // Scenario: the large pages were evicted through their own frames and read back whole.
+  for (int i = 0; i < 8; ++i) {
+    auto *page = bpm->FetchPage(page_ids_64k[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(static_cast<char>(i), page->GetData()[0]);
+    EXPECT_EQ(static_cast<char>(i), page->GetData()[MAX_PAGE_SIZE - 1]);
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids_64k[i], false));
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: filling the frames of one class leaves the others alone.
+  std::vector<page_id_t> page_ids_16k(4);
+  for (auto &page_id : page_ids_16k) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id, PageSizeClass::PAGE_16K));
+  }
+  page_id_t page_id_temp;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp, PageSizeClass::PAGE_16K));
+  EXPECT_NE(nullptr, bpm->FetchPage(page_id_4k));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_4k, false));
+  for (auto page_id : page_ids_16k) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  delete bpm;
+
+  // Scenario: a pool without frames of a class can neither create nor fetch pages of it.
+  bpm = new BufferPoolManager(4, disk_manager);
+  EXPECT_EQ(0U, bpm->GetPoolSize(PageSizeClass::PAGE_64K));
+  EXPECT_EQ(nullptr, bpm->GetFrameArray(PageSizeClass::PAGE_64K));
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp, PageSizeClass::PAGE_64K));
+  EXPECT_EQ(nullptr, bpm->FetchPage(page_ids_64k[0]));
+  EXPECT_EQ(false, bpm->UnpinPage(page_ids_64k[0], false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
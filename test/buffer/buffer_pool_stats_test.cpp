@@ -0,0 +1,152 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats_test.cpp
+//
+// Identification: test/buffer/buffer_pool_stats_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/buffer_pool_stats.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, HistogramTest) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0U, histogram.Snapshot().Count());
+  EXPECT_EQ(0U, histogram.Snapshot().QuantileNs(0.5));
+
+  // 90 fast samples in [64, 128) ns and 10 slow ones in [2^20, 2^21) ns
+  for (int i = 0; i < 90; i++) {
+    histogram.Record(100);
+  }
+  for (int i = 0; i < 10; i++) {
+    histogram.Record(1500000);
+  }
+  histogram.Record(0);
+  auto snapshot = histogram.Snapshot();
+  EXPECT_EQ(101U, snapshot.Count());
+  EXPECT_EQ(90U * 100 + 10U * 1500000, snapshot.sum_ns_);
+  EXPECT_EQ(127U, snapshot.QuantileNs(0.5));
+  EXPECT_EQ((1U << 21) - 1, snapshot.QuantileNs(0.99));
+  EXPECT_EQ(0U, snapshot.QuantileNs(0.001));
+
+  // a latency beyond the last bucket lands in it
+  histogram.Record(~uint64_t{0} >> 1);
+  EXPECT_EQ(1U, histogram.Snapshot().buckets_[LATENCY_HISTOGRAM_BUCKETS - 1]);
+
+  auto delta = histogram.Snapshot().Since(snapshot);
+  EXPECT_EQ(1U, delta.Count());
+  snapshot.Merge(delta);
+  EXPECT_EQ(102U, snapshot.Count());
+
+  histogram.Reset();
+  EXPECT_EQ(0U, histogram.Snapshot().Count());
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, CounterTest) {
+  if (!BPM_STATS_ENABLED) {
+    GTEST_SKIP() << "buffer pool statistics are compiled out";
+  }
+  remove("test.db");
+  remove("test.fsm");
+  const size_t num_instances = 2;
+  const size_t pool_size = 4;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManager(num_instances, pool_size, disk_manager);
+
+  // 16 new pages through 8 frames: the second half evicts the first, which was dirty
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 16; i++) {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    page->GetData()[0] = static_cast<char>(i);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    page_ids.push_back(page_id);
+  }
+  auto stats = bpm->GetStats();
+  EXPECT_EQ(16U, stats.new_pages_);
+  EXPECT_EQ(8U, stats.evictions_);
+  EXPECT_EQ(8U, stats.dirty_evictions_);
+  EXPECT_EQ(8U, stats.write_io_.Count());
+  EXPECT_EQ(0U, stats.fetch_hits_ + stats.fetch_misses_);
+
+  // the last 8 pages are resident, the first 8 have to be read back
+  auto before = bpm->GetStats();
+  for (int i = 15; i >= 0; i--) {
+    Page *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(static_cast<char>(i), page->GetData()[0]);
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+  auto delta = bpm->GetStats().Since(before);
+  EXPECT_EQ(8U, delta.fetch_hits_);
+  EXPECT_EQ(8U, delta.fetch_misses_);
+  EXPECT_EQ(8U, delta.read_io_.Count());
+  EXPECT_DOUBLE_EQ(0.5, delta.HitRatio());
+  EXPECT_EQ(8U, delta.evictions_);
+  EXPECT_EQ(8U, delta.dirty_evictions_);
+  EXPECT_GT(delta.latch_wait_.Count(), 0U);
+
+  // the pool's numbers are the sum of its instances'
+  auto instance_hits = bpm->GetInstanceStats(0).fetch_hits_ + bpm->GetInstanceStats(1).fetch_hits_;
+  EXPECT_EQ(bpm->GetStats().fetch_hits_, instance_hits);
+
+  // flushes count the pages written; FlushAllPages writes every resident page
+  before = bpm->GetStats();
+  EXPECT_TRUE(bpm->FlushPage(page_ids[0]));
+  bpm->FlushAllPages();
+  delta = bpm->GetStats().Since(before);
+  EXPECT_EQ(1U + num_instances * pool_size, delta.flushes_);
+  EXPECT_EQ(2U, delta.write_io_.Count());
+
+  EXPECT_NE(std::string::npos, delta.ToString().find("flushes 9"));
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.fsm");
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolStatsTest, LoggerTest) {
+  remove("test.db");
+  remove("test.fsm");
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManager(4, disk_manager);
+  auto interval = bpm_stats_log_interval;
+  bpm_stats_log_interval = std::chrono::milliseconds(5);
+
+  bpm->RunStatsLogger();
+  bpm->RunStatsLogger();  // already running
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  bpm->UnpinPage(page_id, true);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  bpm->StopStatsLogger();
+  bpm->StopStatsLogger();  // already stopped
+
+  // the destructor stops a logger that is still running
+  bpm->RunStatsLogger();
+  bpm_stats_log_interval = interval;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.fsm");
+}
+
+}  // namespace bustub
@@ -19,7 +19,7 @@
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
   // Scenario: unpin six elements, i.e. add them to the replacer.
@@ -50,6 +50,13 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
   clock_replacer.Unpin(4);
 
+  // Scenario: peeking lists unreferenced frames before referenced ones and does not move the hand.
+  frame_id_t next[3];
+  ASSERT_EQ(3, clock_replacer.Peek(next, 3));
+  EXPECT_EQ(5, next[0]);
+  EXPECT_EQ(6, next[1]);
+  EXPECT_EQ(4, next[2]);
+
   // Scenario: continue looking for victims. We expect these victims.
   clock_replacer.Victim(&value);
   EXPECT_EQ(5, value);
@@ -57,6 +64,43 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   EXPECT_EQ(6, value);
   clock_replacer.Victim(&value);
   EXPECT_EQ(4, value);
+  EXPECT_EQ(0, clock_replacer.Size());
+  EXPECT_FALSE(clock_replacer.Victim(&value));
+}
+
+TEST(ClockReplacerTest, ConcurrencyTest) {
+  const int num_frames = 64;
+  ClockReplacer clock_replacer(num_frames);
+  for (int i = 0; i < num_frames; i++) {
+    clock_replacer.Unpin(i);
+  }
+
+  // Scenario: concurrent victims never hand out the same frame twice.
+  std::vector<std::vector<int>> victims(4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&clock_replacer, &victims, t] {
+      int value;
+      while (clock_replacer.Victim(&value)) {
+        victims[t].push_back(value);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<bool> seen(num_frames, false);
+  size_t total = 0;
+  for (auto &list : victims) {
+    for (auto frame_id : list) {
+      EXPECT_FALSE(seen[frame_id]);
+      seen[frame_id] = true;
+      total++;
+    }
+  }
+  EXPECT_EQ(num_frames, total);
+  EXPECT_EQ(0, clock_replacer.Size());
 }
 
 }  // namespace bustub
@@ -0,0 +1,166 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_array_test.cpp
+//
+// Identification: test/buffer/frame_array_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/frame_array.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+namespace {
+
+/** @return printable name of a kind of pages */
+const char *PageSizeName(FramePageSize page_size) {
+  switch (page_size) {
+    case FramePageSize::TRANSPARENT_HUGE:
+      return "thp";
+    case FramePageSize::HUGE_2MB:
+      return "2MB";
+    case FramePageSize::HUGE_1GB:
+      return "1GB";
+    default:
+      return "4KB";
+  }
+}
+
+/** @return printable name of a NUMA placement */
+const char *NumaPolicyName(FrameNumaPolicy numa_policy) {
+  switch (numa_policy) {
+    case FrameNumaPolicy::INTERLEAVE:
+      return "interleave";
+    case FrameNumaPolicy::BIND:
+      return "bind";
+    default:
+      return "local";
+  }
+}
+
+/**
+ * Maps a 288 MB frame array with the given pages and placement, then reads and increments one word at a random
+ * offset of a random frame, over and over, which makes every access a likely TLB miss on base pages. Prints the time
+ * to map and first touch the frames and the random touch throughput.
+ */
+void RunPageTouchWorkload(FramePageSize page_size, FrameNumaPolicy numa_policy) {
+  const size_t num_frames = 65536;
+  const size_t num_touches = size_t{1} << 22;
+
+  auto start = std::chrono::steady_clock::now();
+  FrameArray frames(num_frames, 4, page_size, numa_policy);
+  auto map_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  Page *pages = frames.GetPages();
+  std::mt19937_64 rng(42);
+  uint64_t sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_touches; ++i) {
+    uint64_t r = rng();
+    auto *word = reinterpret_cast<uint64_t *>(pages[r % num_frames].GetData()) + (r >> 32) % (PAGE_SIZE / 8);
+    sum += (*word)++;
+  }
+  auto touch_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("requested %-3s %-10s  got %-3s %-10s  map + first touch %7.1f ms  random touches %6.1f M/s  (%lu)\n",
+         PageSizeName(page_size), NumaPolicyName(numa_policy), PageSizeName(frames.GetPageSize()),
+         NumaPolicyName(frames.GetNumaPolicy()), map_elapsed * 1e3, num_touches / touch_elapsed / 1e6, sum);
+}
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(FrameArrayTest, FallbackTest) {
+  // large enough for a huge page; huge pages that are not reserved make the mapping fall back to smaller ones
+  const size_t num_frames = 600;
+  for (auto page_size :
+       {FramePageSize::DEFAULT, FramePageSize::TRANSPARENT_HUGE, FramePageSize::HUGE_2MB, FramePageSize::HUGE_1GB}) {
+    for (auto numa_policy : {FrameNumaPolicy::LOCAL, FrameNumaPolicy::INTERLEAVE, FrameNumaPolicy::BIND}) {
+      FrameArray frames(num_frames, 4, page_size, numa_policy);
+      EXPECT_EQ(num_frames, frames.GetNumFrames());
+      EXPECT_LE(static_cast<int>(frames.GetPageSize()), static_cast<int>(page_size));
+      if (numa_policy == FrameNumaPolicy::LOCAL) {
+        EXPECT_EQ(FrameNumaPolicy::LOCAL, frames.GetNumaPolicy());
+      }
+
+      // the frames are constructed, zeroed and aligned for direct I/O
+      Page *pages = frames.GetPages();
+      char zeroes[PAGE_SIZE] = {0};
+      for (size_t i = 0; i < num_frames; ++i) {
+        ASSERT_EQ(0, reinterpret_cast<uintptr_t>(pages[i].GetData()) % DIRECT_IO_ALIGNMENT);
+        ASSERT_EQ(0, memcmp(pages[i].GetData(), zeroes, PAGE_SIZE));
+        ASSERT_EQ(INVALID_PAGE_ID, pages[i].GetPageId());
+        pages[i].WLatch();
+        pages[i].GetData()[PAGE_SIZE - 1] = 1;
+        pages[i].WUnlatch();
+      }
+    }
+  }
+
+  // an empty array still maps
+  FrameArray frames(0, 1);
+  EXPECT_EQ(0, frames.GetNumFrames());
+}
+
+// NOLINTNEXTLINE
+TEST(FrameArrayTest, BufferPoolTest) {
+  const std::string db_name = "test.db";
+  auto page_size = frame_page_size.load();
+  auto numa_policy = frame_numa_policy.load();
+  frame_page_size = FramePageSize::TRANSPARENT_HUGE;
+  frame_numa_policy = FrameNumaPolicy::BIND;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManager(4, 256, disk_manager);
+  EXPECT_EQ(FramePageSize::TRANSPARENT_HUGE, bpm->GetFrameArray()->GetPageSize());
+  EXPECT_EQ(1024, bpm->GetFrameArray()->GetNumFrames());
+
+  for (size_t i = 0; i < 2048; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  for (page_id_t page_id = 0; page_id < 2048; ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(page_id)).c_str()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  frame_page_size = page_size;
+  frame_numa_policy = numa_policy;
+  disk_manager->ShutDown();
+  remove(db_name.c_str());
+  remove("test.log");
+  remove("test.fsm");
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(FrameArrayTest, PageTouchBenchmarkTest) {
+  for (auto page_size :
+       {FramePageSize::DEFAULT, FramePageSize::TRANSPARENT_HUGE, FramePageSize::HUGE_2MB, FramePageSize::HUGE_1GB}) {
+    for (auto numa_policy : {FrameNumaPolicy::LOCAL, FrameNumaPolicy::INTERLEAVE, FrameNumaPolicy::BIND}) {
+      RunPageTouchWorkload(page_size, numa_policy);
+    }
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,88 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+
+  // Scenario: frames 1-5 are used once, frame 1 a second time; frame 6 is used twice.
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Unpin(3);
+  lru_k_replacer.Unpin(4);
+  lru_k_replacer.Unpin(5);
+  lru_k_replacer.Unpin(6);
+  lru_k_replacer.Pin(6);
+  lru_k_replacer.Unpin(6);
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Unpin(1);
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: frames with a single access go first, in order of that access.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+
+  // Scenario: pinned frames are not victimized; 3 is already gone, so pinning it has no effect.
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Pin(4);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+
+  // Scenario: peeking shows the eviction order without changing it.
+  frame_id_t next[4];
+  ASSERT_EQ(3, lru_k_replacer.Peek(next, 4));
+  EXPECT_EQ(5, next[0]);
+  EXPECT_EQ(1, next[1]);
+  EXPECT_EQ(6, next[2]);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+
+  // Scenario: 4 comes back with two accesses. 5 still has a single access and goes first, then the frames with two
+  // accesses in order of their second-to-last access.
+  lru_k_replacer.Unpin(4);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  EXPECT_EQ(0, lru_k_replacer.Size());
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+
+  // Scenario: a victimized frame starts over with an empty history.
+  lru_k_replacer.Unpin(6);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+
+  // Scenario: a removed frame is neither evictable nor remembered.
+  lru_k_replacer.Remove(2);
+  EXPECT_EQ(0, lru_k_replacer.Size());
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Unpin(5);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+}
+
+}  // namespace bustub
@@ -0,0 +1,199 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard_test.cpp
+//
+// Identification: test/buffer/page_guard_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/page/page_guard.h"
+
+namespace bustub {
+
+class PageGuardTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    remove("test.fsm");
+    disk_manager_ = new DiskManager("test.db");
+    bpm_ = new BufferPoolManager(buffer_pool_size_, disk_manager_);
+  }
+
+  void TearDown() override {
+    disk_manager_->ShutDown();
+    delete disk_manager_;
+    delete bpm_;
+    remove("test.db");
+    remove("test.fsm");
+  }
+
+  /** Creates a page and returns its frame with only the test's own pin on it. */
+  Page *NewPinnedPage(page_id_t *page_id) {
+    Page *page = bpm_->NewPage(page_id);
+    EXPECT_NE(nullptr, page);
+    EXPECT_TRUE(bpm_->UnpinPage(*page_id, true));
+    return bpm_->FetchPage(*page_id);
+  }
+
+  const size_t buffer_pool_size_ = 5;
+  DiskManager *disk_manager_;
+  BufferPoolManager *bpm_;
+};
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, UnpinOnScopeExitTest) {
+  page_id_t page_id;
+  Page *page = NewPinnedPage(&page_id);
+  {
+    auto guard = bpm_->FetchPageBasic(page_id);
+    EXPECT_EQ(2, page->GetPinCount());
+    EXPECT_EQ(page_id, guard.PageId());
+    {
+      auto read_guard = bpm_->FetchPageRead(page_id);
+      EXPECT_EQ(3, page->GetPinCount());
+    }
+    EXPECT_EQ(2, page->GetPinCount());
+    {
+      auto write_guard = bpm_->FetchPageWrite(page_id);
+      EXPECT_EQ(3, page->GetPinCount());
+    }
+    EXPECT_EQ(2, page->GetPinCount());
+  }
+  EXPECT_EQ(1, page->GetPinCount());
+
+  // an invalid guard owns nothing
+  BasicPageGuard empty;
+  EXPECT_FALSE(empty.IsValid());
+  empty.Drop();
+  EXPECT_TRUE(bpm_->UnpinPage(page_id, false));
+}
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, MoveAndDropTest) {
+  page_id_t page_id;
+  Page *page = NewPinnedPage(&page_id);
+
+  auto guard = bpm_->FetchPageRead(page_id);
+  ReadPageGuard moved(std::move(guard));
+  EXPECT_EQ(2, page->GetPinCount());
+  EXPECT_FALSE(guard.IsValid());  // NOLINT
+  EXPECT_TRUE(moved.IsValid());
+
+  // assigning over a valid guard releases what it held first
+  moved = bpm_->FetchPageRead(page_id);
+  EXPECT_EQ(2, page->GetPinCount());
+
+  // dropping twice, or dropping a moved-from guard, does not unpin again
+  moved.Drop();
+  moved.Drop();
+  guard.Drop();  // NOLINT
+  EXPECT_EQ(1, page->GetPinCount());
+
+  // the read latch is gone, so the page can be write latched from this thread
+  auto write_guard = bpm_->FetchPageWrite(page_id);
+  EXPECT_TRUE(write_guard.IsValid());
+  write_guard.Drop();
+  EXPECT_TRUE(bpm_->UnpinPage(page_id, false));
+}
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, UpgradeTest) {
+  page_id_t page_id;
+  Page *page = NewPinnedPage(&page_id);
+
+  auto basic_guard = bpm_->FetchPageBasic(page_id);
+  auto write_guard = basic_guard.UpgradeWrite();
+  EXPECT_FALSE(basic_guard.IsValid());  // NOLINT
+  EXPECT_EQ(2, page->GetPinCount());
+  std::strcpy(write_guard.GetDataMut(), "upgraded");  // NOLINT
+  write_guard.Drop();
+  EXPECT_EQ(1, page->GetPinCount());
+
+  auto read_guard = bpm_->FetchPageBasic(page_id).UpgradeRead();
+  EXPECT_EQ(2, page->GetPinCount());
+  EXPECT_STREQ("upgraded", read_guard.GetData());
+  read_guard.Drop();
+  EXPECT_EQ(1, page->GetPinCount());
+  EXPECT_TRUE(bpm_->UnpinPage(page_id, false));
+}
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, DirtyFlagTest) {
+  page_id_t page_id;
+  Page *page = NewPinnedPage(&page_id);
+  bpm_->FlushPage(page_id);
+  EXPECT_FALSE(page->IsDirty());
+
+  // reading through a guard leaves the page clean
+  {
+    auto guard = bpm_->FetchPageWrite(page_id);
+    EXPECT_EQ(0, guard.As<char>()[0]);
+  }
+  EXPECT_FALSE(page->IsDirty());
+
+  // asking for a mutable view marks it dirty
+  {
+    auto guard = bpm_->FetchPageWrite(page_id);
+    *guard.AsMut<char>() = 'x';
+  }
+  EXPECT_TRUE(page->IsDirty());
+  EXPECT_TRUE(bpm_->UnpinPage(page_id, false));
+
+  // a new page is unpinned dirty, so it reaches disk even if nothing was written to it
+  page_id_t new_page_id;
+  {
+    auto guard = bpm_->NewPageGuarded(&new_page_id);
+    ASSERT_TRUE(guard.IsValid());
+    EXPECT_EQ(new_page_id, guard.PageId());
+  }
+  Page *new_page = bpm_->FetchPage(new_page_id);
+  EXPECT_TRUE(new_page->IsDirty());
+  EXPECT_EQ(1, new_page->GetPinCount());
+  EXPECT_TRUE(bpm_->UnpinPage(new_page_id, false));
+}
+
+// NOLINTNEXTLINE
+TEST_F(PageGuardTest, ReleaseOnExceptionTest) {
+  page_id_t page_id;
+  Page *page = NewPinnedPage(&page_id);
+
+  auto fail_while_latched = [&]() {
+    auto guard = bpm_->FetchPageWrite(page_id);
+    *guard.AsMut<char>() = 'y';
+    throw std::runtime_error("failed while holding the page");
+  };
+  EXPECT_THROW(fail_while_latched(), std::runtime_error);
+  EXPECT_EQ(1, page->GetPinCount());
+  EXPECT_TRUE(page->IsDirty());
+
+  auto guard = bpm_->FetchPageRead(page_id);
+  EXPECT_EQ('y', guard.GetData()[0]);
+  guard.Drop();
+  EXPECT_TRUE(bpm_->UnpinPage(page_id, false));
+
+  // with every frame held by guards, a failed fetch gives an invalid guard rather than throwing
+  std::vector<BasicPageGuard> guards;
+  page_id_t temp_page_id;
+  for (size_t i = 0; i < buffer_pool_size_; ++i) {
+    guards.push_back(bpm_->NewPageGuarded(&temp_page_id));
+    EXPECT_TRUE(guards.back().IsValid());
+  }
+  EXPECT_FALSE(bpm_->NewPageGuarded(&temp_page_id).IsValid());
+  guards.clear();
+  EXPECT_TRUE(bpm_->NewPageGuarded(&temp_page_id).IsValid());
+}
+
+}  // namespace bustub
@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table_test.cpp
+//
+// Identification: test/buffer/page_table_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/page_table.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(PageTableTest, SampleTest) {
+  const size_t num_frames = 64;
+  PageTable table(num_frames);
+
+  // strided page ids, as seen by one instance of a partitioned pool
+  for (size_t i = 0; i < num_frames; i++) {
+    table.Insert(static_cast<page_id_t>(i * 16 + 3), static_cast<frame_id_t>(i));
+  }
+  EXPECT_EQ(num_frames, table.Size());
+
+  frame_id_t frame_id;
+  for (size_t i = 0; i < num_frames; i++) {
+    ASSERT_TRUE(table.Find(static_cast<page_id_t>(i * 16 + 3), &frame_id));
+    EXPECT_EQ(static_cast<frame_id_t>(i), frame_id);
+  }
+  EXPECT_FALSE(table.Find(4, &frame_id));
+
+  // erasing must keep every other entry of a probe run reachable
+  for (size_t i = 0; i < num_frames; i += 2) {
+    EXPECT_TRUE(table.Erase(static_cast<page_id_t>(i * 16 + 3)));
+  }
+  EXPECT_FALSE(table.Erase(3));
+  EXPECT_EQ(num_frames / 2, table.Size());
+  for (size_t i = 0; i < num_frames; i++) {
+    bool found = table.Find(static_cast<page_id_t>(i * 16 + 3), &frame_id);
+    EXPECT_EQ(i % 2 == 1, found);
+    if (found) {
+      EXPECT_EQ(static_cast<frame_id_t>(i), frame_id);
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(PageTableTest, ConcurrentReadTest) {
+  const size_t num_frames = 32;
+  PageTable table(num_frames);
+  for (size_t i = 0; i < num_frames / 2; i++) {
+    table.Insert(static_cast<page_id_t>(i), static_cast<frame_id_t>(i));
+  }
+
+  // one writer churns the upper half while readers check that a hit never returns a wrong frame
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&table, &done] {
+      frame_id_t frame_id;
+      while (!done) {
+        for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(num_frames); page_id++) {
+          if (table.Find(page_id, &frame_id)) {
+            EXPECT_EQ(page_id, frame_id);
+          }
+        }
+      }
+    });
+  }
+  for (int round = 0; round < 1000; round++) {
+    for (size_t i = num_frames / 2; i < num_frames; i++) {
+      table.Insert(static_cast<page_id_t>(i), static_cast<frame_id_t>(i));
+    }
+    for (size_t i = num_frames / 2; i < num_frames; i++) {
+      table.Erase(static_cast<page_id_t>(i));
+    }
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(num_frames / 2, table.Size());
+}
+
+}  // namespace bustub
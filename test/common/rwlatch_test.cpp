@@ -10,6 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -18,6 +21,7 @@
 
 namespace bustub {
 
+template <class Latch>
 class Counter {
  public:
   Counter() = default;
@@ -36,13 +40,13 @@ class Counter {
 
  private:
   int count_{0};
-  ReaderWriterLatch mutex{};
+  Latch mutex{};
 };
 
 // NOLINTNEXTLINE
 TEST(RWLatchTest, BasicTest) {
   int num_threads = 100;
-  Counter counter{};
+  Counter<ReaderWriterLatch> counter{};
   counter.Add(5);
   std::vector<std::thread> threads;
   for (int tid = 0; tid < num_threads; tid++) {
@@ -57,4 +61,113 @@ TEST(RWLatchTest, BasicTest) {
   }
   EXPECT_EQ(counter.Read(), 55);
 }
+
+// NOLINTNEXTLINE
+TEST(RWLatchTest, ExclusionTest) {
+  ReaderWriterLatch latch;
+  std::atomic<int> readers{0};
+  std::atomic<int> writers{0};
+  std::atomic<int> violations{0};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 8; tid++) {
+    threads.emplace_back([&, tid]() {
+      for (int i = 0; i < 2000; i++) {
+        if ((tid + i) % 4 == 0) {
+          latch.WLock();
+          if (writers++ != 0 || readers != 0) {
+            violations++;
+          }
+          std::this_thread::yield();
+          writers--;
+          latch.WUnlock();
+        } else {
+          latch.RLock();
+          readers++;
+          if (writers != 0) {
+            violations++;
+          }
+          readers--;
+          latch.RUnlock();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, violations);
+}
+
+// NOLINTNEXTLINE
+TEST(RWLatchTest, WriterPreferenceTest) {
+  ReaderWriterLatch latch;
+  latch.RLock();
+
+  // a writer waits for the reader, long enough to go to sleep
+  std::atomic<bool> writer_done{false};
+  std::thread writer([&]() {
+    latch.WLock();
+    writer_done = true;
+    latch.WUnlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(writer_done);
+
+  // a new reader queues behind the waiting writer instead of joining the reader that holds the latch
+  std::atomic<bool> reader_done{false};
+  std::atomic<bool> writer_went_first{false};
+  std::thread reader([&]() {
+    latch.RLock();
+    writer_went_first = writer_done.load();
+    reader_done = true;
+    latch.RUnlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(reader_done);
+
+  latch.RUnlock();
+  writer.join();
+  reader.join();
+  EXPECT_TRUE(writer_went_first);
+}
+
+/** Runs num_threads threads that together do total_ops operations on a counter, one in write_every of them a write. */
+template <class Latch>
+double RunContention(int num_threads, int write_every, int total_ops) {
+  Counter<Latch> counter;
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < total_ops / num_threads; i++) {
+        if (write_every != 0 && i % write_every == 0) {
+          counter.Add(1);
+        } else {
+          counter.Read();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  int writes_per_thread = write_every == 0 ? 0 : (total_ops / num_threads + write_every - 1) / write_every;
+  EXPECT_EQ(num_threads * writes_per_thread, counter.Read());
+  return total_ops / elapsed;
+}
+
+// NOLINTNEXTLINE
+TEST(RWLatchTest, ContentionBenchmark) {
+  const int total_ops = 400000;
+  for (int write_every : {0, 10, 2}) {
+    for (int num_threads : {1, 2, 4, 8}) {
+      double mutex_ops = RunContention<MutexReaderWriterLatch>(num_threads, write_every, total_ops);
+      double spin_ops = RunContention<ReaderWriterLatch>(num_threads, write_every, total_ops);
+      printf("%3d%% writes, %d threads: mutex latch %10.0f ops/s, spinning latch %10.0f ops/s\n",
+             write_every == 0 ? 0 : 100 / write_every, num_threads, mutex_ops, spin_ops);
+    }
+  }
+}
+
 }  // namespace bustub
@@ -10,9 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <random>
 #include <string>
 #include <unordered_set>
 #include <utility>
@@ -22,6 +26,7 @@
 #include "execution/plans/delete_plan.h"
 #include "execution/plans/index_scan_plan.h"
 #include "execution/plans/limit_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/table_generator.h"
@@ -87,6 +92,7 @@ class ExecutorTest : public ::testing::Test {
   TransactionManager *GetTxnManager() { return txn_mgr_.get(); }
   Catalog *GetCatalog() { return catalog_.get(); }
   BufferPoolManager *GetBPM() { return bpm_.get(); }
+  DiskManager *GetDiskManager() { return disk_manager_.get(); }
   LockManager *GetLockManager() { return lock_manager_.get(); }
 
   // The below helper functions are useful for testing.
@@ -630,4 +636,171 @@ TEST_F(ExecutorTest, SimpleIndexScanTest) {
   ASSERT_EQ(result_set.size(), 500);
 }
 
+TEST_F(ExecutorTest, RangeIndexScanTest) {
+  // SELECT colA, colB FROM test_1 WHERE colA >= 100 AND colA < 200 AND colB < 5, forwards and backwards
+
+  // Construct query plan
+  TableMetadata *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  Schema &schema = table_info->schema_;
+  auto *colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto *colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto *const5 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(5));
+  auto *predicate = MakeComparisonExpression(colB, const5, ComparisonType::LessThan);
+  auto *out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+
+  // index
+  std::vector<Column> keys;
+  keys.emplace_back("colA", TypeId::INTEGER);
+  Schema key_schema(keys);
+  const int index_size = 8;
+  auto *idx_info =
+      GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<index_size>, RID, GenericComparator<index_size>>(
+          GetTxn(), "k1", "test_1", schema, key_schema, {0}, 1);
+
+  for (bool reverse : {false, true}) {
+    IndexScanPlanNode plan{out_schema,
+                           predicate,
+                           idx_info->index_oid_,
+                           {ValueFactory::GetIntegerValue(100)},
+                           {ValueFactory::GetIntegerValue(200)},
+                           reverse};
+    std::vector<Tuple> result_set;
+    GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+
+    // Verify: the keys of the range in order, those of them whose colB passes the predicate
+    ASSERT_FALSE(result_set.empty());
+    int32_t last = reverse ? 200 : 99;
+    for (const auto &tuple : result_set) {
+      auto col_a = tuple.GetValue(out_schema, out_schema->GetColIdx("colA")).GetAs<int32_t>();
+      ASSERT_TRUE(reverse ? col_a < last : col_a > last);
+      ASSERT_TRUE(col_a >= 100 && col_a < 200);
+      ASSERT_TRUE(tuple.GetValue(out_schema, out_schema->GetColIdx("colB")).GetAs<int32_t>() < 5);
+      last = col_a;
+    }
+  }
+
+  // an open range in reverse returns every key, from the last one down
+  IndexScanPlanNode plan{out_schema, nullptr, idx_info->index_oid_, {}, {}, true};
+  std::vector<Tuple> result_set;
+  GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(TEST1_SIZE, result_set.size());
+  ASSERT_EQ(TEST1_SIZE - 1, result_set[0].GetValue(out_schema, out_schema->GetColIdx("colA")).GetAs<int32_t>());
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, NestedIndexJoinTest) {
+  // SELECT test_1.colA, test_1.colB, test_3.col1, test_3.col3 FROM test_1 JOIN test_3 ON test_1.colA = test_3.col1,
+  // with the index on test_3.col1 probed for one row of test_1 at a time or for batches of them
+  TableMetadata *outer_info = GetCatalog()->GetTable("test_1");
+  auto *colA = MakeColumnValueExpression(outer_info->schema_, 0, "colA");
+  auto *colB = MakeColumnValueExpression(outer_info->schema_, 0, "colB");
+  auto *outer_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+  SeqScanPlanNode scan_plan{outer_schema, nullptr, outer_info->oid_};
+
+  TableMetadata *inner_info = GetCatalog()->GetTable("test_3");
+  auto *col1 = MakeColumnValueExpression(inner_info->schema_, 1, "col1");
+  auto *col3 = MakeColumnValueExpression(inner_info->schema_, 1, "col3");
+  auto *inner_schema = MakeOutputSchema({{"col1", col1}, {"col3", col3}});
+  std::vector<Column> keys;
+  keys.emplace_back("col1", TypeId::INTEGER);
+  Schema key_schema(keys);
+  GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(GetTxn(), "t3_col1", "test_3",
+                                                                        inner_info->schema_, key_schema, {0}, 8);
+  auto *out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}, {"col1", col1}, {"col3", col3}});
+
+  std::vector<std::vector<int64_t>> expected;
+  for (size_t batch_size : {0, 1, 16, 256}) {
+    NestedIndexJoinPlanNode join_plan{out_schema, {&scan_plan}, nullptr, inner_info->oid_, "t3_col1", outer_schema,
+                                      inner_schema, batch_size};
+    std::vector<Tuple> result_set;
+    GetExecutionEngine()->Execute(&join_plan, &result_set, GetTxn(), GetExecutorContext());
+
+    // every row of test_3 matches one of test_1, in the order of test_1
+    std::vector<std::vector<int64_t>> result;
+    for (const auto &tuple : result_set) {
+      result.push_back(
+          {tuple.GetValue(out_schema, 0).GetAs<int32_t>(), tuple.GetValue(out_schema, 1).GetAs<int32_t>(),
+           tuple.GetValue(out_schema, 2).GetAs<int32_t>(), tuple.GetValue(out_schema, 3).GetAs<int64_t>()});
+      ASSERT_EQ(result.back()[0], result.back()[2]);
+    }
+    ASSERT_EQ(TEST2_SIZE, result.size());
+    if (batch_size == 0) {
+      expected = result;
+    } else {
+      ASSERT_EQ(expected, result);
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, BatchedIndexScanTest) {
+  // SELECT a, b FROM wide WHERE a % 3 = 0 ... over a table many times the size of the buffer pool, whose keys are in
+  // no order in the table, so that reading rows in key order jumps from page to page
+  const int64_t num_rows = 4000;
+  std::vector<Column> columns;
+  columns.emplace_back("a", TypeId::BIGINT);
+  columns.emplace_back("b", TypeId::VARCHAR, 400);
+  Schema schema(columns);
+  TableMetadata *table_info = GetCatalog()->CreateTable(GetTxn(), "wide", schema);
+  std::vector<int64_t> keys(num_rows);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  const std::string padding(390, 'x');
+  for (int64_t key : keys) {
+    Tuple tuple({ValueFactory::GetBigIntValue(key), ValueFactory::GetVarcharValue(padding)}, &schema);
+    RID rid;
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, GetTxn()));
+  }
+
+  std::vector<Column> key_columns;
+  key_columns.emplace_back("a", TypeId::BIGINT);
+  Schema key_schema(key_columns);
+  auto *idx_info = GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "wide_a", "wide", table_info->schema_, key_schema, {0}, 8);
+  GetBPM()->FlushAllPages();
+
+  auto *col_a = MakeColumnValueExpression(table_info->schema_, 0, "a");
+  auto *col_b = MakeColumnValueExpression(table_info->schema_, 0, "b");
+  auto *out_schema = MakeOutputSchema({{"a", col_a}, {"b", col_b}});
+  auto *predicate = MakeComparisonExpression(col_a, MakeConstantValueExpression(ValueFactory::GetBigIntValue(3000)),
+                                             ComparisonType::LessThan);
+
+  // the pool holds a small part of the table, so that each scan starts on an all but cold pool; fetching one rid at a
+  // time reads a page for nearly every row, while a batch reads each of its pages once
+  std::vector<int64_t> expected;
+  int unbatched_reads = 0;
+  for (size_t batch_size : {0, 16, 256, 4096}) {
+    IndexScanPlanNode plan{out_schema, predicate, idx_info->index_oid_, {}, {}, false, batch_size};
+    int reads = GetDiskManager()->GetNumReads();
+    uint64_t prefetches = GetBPM()->GetNumPrefetches();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Tuple> result_set;
+    GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    reads = GetDiskManager()->GetNumReads() - reads;
+    printf("rid batch size %4zu: %d pages read, %lu of them prefetched, %.1f ms\n", batch_size, reads,
+           static_cast<unsigned long>(GetBPM()->GetNumPrefetches() - prefetches), elapsed);  // NOLINT
+
+    // the same rows in key order in every mode
+    std::vector<int64_t> result;
+    for (const auto &tuple : result_set) {
+      result.push_back(tuple.GetValue(out_schema, out_schema->GetColIdx("a")).GetAs<int64_t>());
+      ASSERT_EQ(padding, tuple.GetValue(out_schema, out_schema->GetColIdx("b")).ToString());
+    }
+    if (batch_size == 0) {
+      ASSERT_EQ(3000, result.size());
+      for (int64_t i = 0; i < 3000; i++) {
+        ASSERT_EQ(i, result[i]);
+      }
+      expected = result;
+      unbatched_reads = reads;
+    } else {
+      ASSERT_EQ(expected, result);
+    }
+    if (batch_size == 4096) {
+      EXPECT_LT(reads * 4, unbatched_reads);
+    }
+  }
+}
+
 }  // namespace bustub
@@ -0,0 +1,214 @@
+/**
+ * b_plus_tree_bulk_load_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/b_plus_tree_builder.h"
+
+namespace bustub {
+
+using LeafPage = BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
+
+// walk the leaves left to right; returns their number and checks that the keys are 0, 1, 2, ...
+int CheckLeaves(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree, BufferPoolManager *bpm, int64_t num_keys,
+                int min_size) {
+  GenericKey<8> index_key;
+  BasicPageGuard leaf_guard = tree->FindLeafPage(index_key, true);
+  int num_leaves = 0;
+  int64_t next_key = 0;
+  while (leaf_guard.IsValid()) {
+    const auto *leaf = leaf_guard.As<LeafPage>();
+    num_leaves++;
+    if (!leaf->IsRootPage()) {
+      EXPECT_GE(leaf->GetSize(), min_size);
+    }
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      EXPECT_EQ(next_key++, leaf->KeyAt(i).ToString());
+    }
+    page_id_t next_page_id = leaf->GetNextPageId();
+    leaf_guard = next_page_id == INVALID_PAGE_ID ? BasicPageGuard() : bpm->FetchPageBasic(next_page_id);
+  }
+  EXPECT_EQ(num_keys, next_key);
+  return num_leaves;
+}
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  std::mt19937 rng(15445);
+
+  // small nodes and odd key counts, so that the rightmost pages of the levels need fixing up
+  for (int64_t num_keys : {1, 2, 3, 7, 30, 101, 2000}) {
+    for (double fill_factor : {0.5, 0.8, 1.0}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+      page_id_t page_id;
+      bpm->NewPage(&page_id);
+      BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+
+      std::vector<int64_t> keys(num_keys);
+      for (int64_t key = 0; key < num_keys; key++) {
+        keys[key] = key;
+      }
+      std::shuffle(keys.begin(), keys.end(), rng);
+
+      // a sort buffer of 16 entries spills runs to disk; of duplicate keys the first added is loaded
+      BPlusTreeBuilder<GenericKey<8>, RID, GenericComparator<8>> builder(&tree, fill_factor,
+                                                                         16 * sizeof(std::pair<GenericKey<8>, RID>));
+      GenericKey<8> index_key;
+      for (auto key : keys) {
+        index_key.SetFromInteger(key);
+        builder.Add(index_key, RID(0, key));
+      }
+      for (int64_t key = 0; key < num_keys; key += 3) {
+        index_key.SetFromInteger(key);
+        builder.Add(index_key, RID(1, key));
+      }
+      EXPECT_EQ(num_keys > 16, builder.GetNumRuns() > 1);
+      EXPECT_EQ(num_keys, builder.Finish());
+
+      CheckLeaves(&tree, bpm, num_keys, 2);
+      std::vector<RID> rids;
+      for (int64_t key = 0; key < num_keys; key++) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(tree.GetValue(index_key, &rids));
+        ASSERT_EQ(1, rids.size());
+        EXPECT_EQ(RID(0, key), rids[0]);
+      }
+      int64_t current_key = 0;
+      for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+        EXPECT_EQ(current_key++, (*iterator).first.ToString());
+      }
+      EXPECT_EQ(num_keys, current_key);
+
+      // the loaded tree takes inserts and removes like any other, down to the last key
+      for (int64_t key = num_keys; key < num_keys + 50; key++) {
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(tree.Insert(index_key, RID(0, key)));
+      }
+      std::shuffle(keys.begin(), keys.end(), rng);
+      for (auto key : keys) {
+        index_key.SetFromInteger(key);
+        tree.Remove(index_key);
+      }
+      for (int64_t key = num_keys; key < num_keys + 50; key++) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(tree.GetValue(index_key, &rids));
+        index_key.SetFromInteger(key);
+        tree.Remove(index_key);
+      }
+      EXPECT_TRUE(tree.IsEmpty());
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete disk_manager;
+      delete bpm;
+      remove("test.db");
+      remove("test.log");
+      remove("test.fsm");
+    }
+  }
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, BulkLoadFillFactorTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const int64_t num_keys = 100000;
+  const int leaf_max_size =
+      (PAGE_SIZE - LEAF_PAGE_HEADER_SIZE - sizeof(GenericKey<8>)) / sizeof(std::pair<GenericKey<8>, RID>);
+
+  std::vector<int> num_leaves;
+  for (double fill_factor : {1.0, 0.5}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+
+    BPlusTreeBuilder<GenericKey<8>, RID, GenericComparator<8>> builder(&tree, fill_factor);
+    GenericKey<8> index_key;
+    for (int64_t key = 0; key < num_keys; key++) {
+      index_key.SetFromInteger(key);
+      builder.Add(index_key, RID(0, key));
+    }
+    EXPECT_EQ(num_keys, builder.Finish());
+    num_leaves.push_back(CheckLeaves(&tree, bpm, num_keys, (leaf_max_size + 1) / 2));
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+
+  // full leaves hold one entry less than a leaf splits at, and the last leaf takes the rest; of half full leaves, the
+  // last is merged into the one before
+  EXPECT_EQ((num_keys + leaf_max_size - 2) / (leaf_max_size - 1), num_leaves[0]);
+  EXPECT_EQ(num_keys / ((leaf_max_size + 1) / 2), num_leaves[1]);
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, BulkLoadBenchmark) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const int64_t num_keys = 100000;
+  std::vector<int64_t> keys(num_keys);
+  for (int64_t key = 0; key < num_keys; key++) {
+    keys[key] = key;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+
+  for (bool bulk_load : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+
+    auto start = std::chrono::steady_clock::now();
+    GenericKey<8> index_key;
+    if (bulk_load) {
+      BPlusTreeBuilder<GenericKey<8>, RID, GenericComparator<8>> builder(&tree);
+      for (auto key : keys) {
+        index_key.SetFromInteger(key);
+        builder.Add(index_key, RID(0, key));
+      }
+      builder.Finish();
+    } else {
+      for (auto key : keys) {
+        index_key.SetFromInteger(key);
+        tree.Insert(index_key, RID(0, key));
+      }
+    }
+    bpm->FlushAllPages();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%s %ld keys: %6.3f s, %d pages written\n", bulk_load ? "bulk load" : "insert   ", num_keys, elapsed,
+           disk_manager->GetNumWrites());
+
+    std::vector<RID> rids;
+    index_key.SetFromInteger(num_keys / 2);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  delete key_schema;
+}
+
+}  // namespace bustub
@@ -0,0 +1,281 @@
+/**
+ * b_plus_tree_compression_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <map>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/b_plus_tree_builder.h"
+#include "storage/table/tuple.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+using WideKey = GenericKey<64>;
+using WideComparator = GenericComparator<64>;
+using WideTree = BPlusTree<WideKey, RID, WideComparator>;
+
+// a composite key (tenant, group, id, tag), where most keys share their tenant and have no tag
+WideKey MakeKey(const Schema *key_schema, int64_t key) {
+  int64_t tenant = key % 16 == 0 ? 2 : 1;
+  int64_t tag = key % 7 == 0 ? key : 0;
+  Tuple tuple({ValueFactory::GetBigIntValue(tenant), ValueFactory::GetBigIntValue(key / 100),
+               ValueFactory::GetBigIntValue(key), ValueFactory::GetBigIntValue(tag)},
+              key_schema);
+  WideKey index_key;
+  index_key.SetFromKey(tuple);
+  return index_key;
+}
+
+// expected: the key each id maps to, in key order
+void CheckTree(WideTree *tree, Schema *key_schema, const std::map<int64_t, int64_t> &expected, int64_t num_ids) {
+  WideComparator comparator(key_schema);
+  std::vector<std::pair<WideKey, int64_t>> keys;
+  for (const auto &[id, value] : expected) {
+    keys.emplace_back(MakeKey(key_schema, id), value);
+  }
+  std::sort(keys.begin(), keys.end(),
+            [&](const auto &lhs, const auto &rhs) { return comparator(lhs.first, rhs.first) < 0; });
+  size_t i = 0;
+  for (auto iterator = tree->begin(); iterator != tree->end(); ++iterator) {
+    ASSERT_LT(i, keys.size());
+    EXPECT_EQ(0, comparator((*iterator).first, keys[i].first));
+    EXPECT_EQ(keys[i].second, (*iterator).second.GetSlotNum());
+    i++;
+  }
+  EXPECT_EQ(keys.size(), i);
+
+  std::vector<RID> rids;
+  for (int64_t id = 0; id < num_ids; id++) {
+    rids.clear();
+    EXPECT_EQ(expected.count(id) == 1, tree->GetValue(MakeKey(key_schema, id), &rids));
+  }
+}
+
+TEST(BPlusTreeTests, CompressionTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint,b bigint,c bigint,d bigint");
+  WideComparator comparator(key_schema);
+  const int64_t num_ids = 20000;
+  const BTreeLatchProtocol latch_protocol = btree_latch_protocol;
+
+  for (auto protocol : {BTreeLatchProtocol::CRABBING, BTreeLatchProtocol::BLINK}) {
+    btree_latch_protocol = protocol;
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    WideTree tree("foo_pk", bpm, comparator, PageSizeClass::PAGE_4K, BTreePageLayout::COMPRESSED,
+                  key_schema->GetLength());
+
+    std::vector<int64_t> ids(num_ids);
+    for (int64_t id = 0; id < num_ids; id++) {
+      ids[id] = id;
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(15445));
+    std::map<int64_t, int64_t> expected;
+    for (auto id : ids) {
+      EXPECT_TRUE(tree.Insert(MakeKey(key_schema, id), RID(0, id)));
+      expected[id] = id;
+    }
+    EXPECT_FALSE(tree.Insert(MakeKey(key_schema, ids[0]), RID(0, 0)));
+    CheckTree(&tree, key_schema, expected, num_ids);
+
+    // remove most keys, so that pages merge and rebalance, and put some back with other values
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(15645));
+    for (int64_t i = 0; i < num_ids * 3 / 4; i++) {
+      tree.Remove(MakeKey(key_schema, ids[i]));
+      expected.erase(ids[i]);
+    }
+    for (int64_t i = 0; i < num_ids / 4; i++) {
+      EXPECT_TRUE(tree.Insert(MakeKey(key_schema, ids[i]), RID(0, ids[i] + 1)));
+      expected[ids[i]] = ids[i] + 1;
+    }
+    CheckTree(&tree, key_schema, expected, num_ids);
+
+    // a key with a nonzero byte past the key size does not fit
+    WideKey wide_key;
+    wide_key.data_[key_schema->GetLength()] = 1;
+    EXPECT_THROW(tree.Insert(wide_key, RID(0, 0)), Exception);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  btree_latch_protocol = latch_protocol;
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, CompressionConcurrentTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint,b bigint,c bigint,d bigint");
+  WideComparator comparator(key_schema);
+  const int64_t num_ids = 20000;
+  const int num_threads = 4;
+  const BTreeLatchProtocol latch_protocol = btree_latch_protocol;
+
+  for (auto protocol : {BTreeLatchProtocol::CRABBING, BTreeLatchProtocol::BLINK}) {
+    btree_latch_protocol = protocol;
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    WideTree tree("foo_pk", bpm, comparator, PageSizeClass::PAGE_4K, BTreePageLayout::COMPRESSED,
+                  key_schema->GetLength());
+
+    // each thread inserts every num_threads-th id, then removes half of them
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t] {
+        for (int64_t id = t; id < num_ids; id += num_threads) {
+          tree.Insert(MakeKey(key_schema, id), RID(0, id));
+        }
+        for (int64_t id = t; id < num_ids; id += 2 * num_threads) {
+          tree.Remove(MakeKey(key_schema, id));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::map<int64_t, int64_t> expected;
+    for (int64_t id = 0; id < num_ids; id++) {
+      if (id % (2 * num_threads) >= num_threads) {
+        expected[id] = id;
+      }
+    }
+    CheckTree(&tree, key_schema, expected, num_ids);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  btree_latch_protocol = latch_protocol;
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, CompressionBulkLoadTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint,b bigint,c bigint,d bigint");
+  WideComparator comparator(key_schema);
+
+  for (int64_t num_ids : {1, 300, 20000}) {
+    for (double fill_factor : {0.5, 1.0}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+      page_id_t page_id;
+      bpm->NewPage(&page_id);
+      WideTree tree("foo_pk", bpm, comparator, PageSizeClass::PAGE_4K, BTreePageLayout::COMPRESSED,
+                    key_schema->GetLength());
+
+      BPlusTreeBuilder<WideKey, RID, WideComparator> builder(&tree, fill_factor);
+      std::map<int64_t, int64_t> expected;
+      for (int64_t id = 0; id < num_ids; id++) {
+        builder.Add(MakeKey(key_schema, id), RID(0, id));
+        expected[id] = id;
+      }
+      EXPECT_EQ(num_ids, builder.Finish());
+      CheckTree(&tree, key_schema, expected, num_ids);
+
+      // the loaded tree takes inserts and removes like any other
+      for (int64_t id = num_ids; id < num_ids + 500; id++) {
+        EXPECT_TRUE(tree.Insert(MakeKey(key_schema, id), RID(0, id)));
+        expected[id] = id;
+      }
+      for (int64_t id = 0; id < num_ids; id += 2) {
+        tree.Remove(MakeKey(key_schema, id));
+        expected.erase(id);
+      }
+      CheckTree(&tree, key_schema, expected, num_ids + 500);
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete disk_manager;
+      delete bpm;
+      remove("test.db");
+      remove("test.log");
+      remove("test.fsm");
+    }
+  }
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, CompressionBenchmark) {
+  Schema *key_schema = ParseCreateStatement("a bigint,b bigint,c bigint,d bigint");
+  WideComparator comparator(key_schema);
+  const int64_t num_ids = 100000;
+  std::vector<int64_t> ids(num_ids);
+  for (int64_t id = 0; id < num_ids; id++) {
+    ids[id] = id;
+  }
+  std::shuffle(ids.begin(), ids.end(), std::mt19937(15445));
+
+  std::vector<int> num_leaves;
+  for (auto layout : {BTreePageLayout::PLAIN, BTreePageLayout::COMPRESSED}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(64, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    WideTree tree("foo_pk", bpm, comparator, PageSizeClass::PAGE_4K, layout, key_schema->GetLength());
+
+    BPlusTreeBuilder<WideKey, RID, WideComparator> builder(&tree, 1.0);
+    for (int64_t id = 0; id < num_ids; id++) {
+      builder.Add(MakeKey(key_schema, id), RID(0, id));
+    }
+    builder.Finish();
+    for (int64_t id = num_ids; id < num_ids * 3 / 2; id++) {
+      tree.Insert(MakeKey(key_schema, id), RID(0, id));
+    }
+
+    // count the leaves, and the levels above the leftmost one
+    int leaves = 0;
+    int height = 1;
+    BasicPageGuard leaf_guard = tree.FindLeafPage(WideKey(), true);
+    for (page_id_t parent_id = leaf_guard.As<BPlusTreePage>()->GetParentPageId(); parent_id != INVALID_PAGE_ID;
+         height++) {
+      BasicPageGuard parent_guard = bpm->FetchPageBasic(parent_id);
+      parent_id = parent_guard.As<BPlusTreePage>()->GetParentPageId();
+    }
+    while (leaf_guard.IsValid()) {
+      leaves++;
+      page_id_t next_page_id = leaf_guard.As<BPlusTreeLeafPage<WideKey, RID, WideComparator>>()->GetNextPageId();
+      leaf_guard = next_page_id == INVALID_PAGE_ID ? BasicPageGuard() : bpm->FetchPageBasic(next_page_id);
+    }
+    num_leaves.push_back(leaves);
+
+    bpm->FlushAllPages();
+    int reads = disk_manager->GetNumReads();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<RID> rids;
+    for (auto id : ids) {
+      tree.GetValue(MakeKey(key_schema, id), &rids);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_ids, rids.size());
+    printf("%s: %d leaves, height %d, %ld lookups %6.3f s, %d pages read\n",
+           layout == BTreePageLayout::PLAIN ? "plain     " : "compressed", leaves, height, num_ids, elapsed,
+           disk_manager->GetNumReads() - reads);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  EXPECT_LT(num_leaves[1] * 2, num_leaves[0]);
+  delete key_schema;
+}
+
+}  // namespace bustub
@@ -2,9 +2,12 @@
  * b_plus_tree_test.cpp
  */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
+#include <random>
 #include <thread>                   // NOLINT
 #include "b_plus_tree_test_util.h"  // NOLINT
 
@@ -331,6 +334,454 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   remove("test.log");
 }
 
+TEST(BPlusTreeConcurrentTest, OptimisticReadTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(256, disk_manager);
+  // small nodes, so that the writers split and merge pages all the time
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // the even keys stay in the tree, the odd ones come and go
+  const int64_t num_keys = 1000;
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 0; key < num_keys; key++) {
+    (key % 2 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  std::atomic<bool> done{false};
+  std::atomic<int> misses{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 2; i++) {
+    readers.emplace_back([&]() {
+      GenericKey<8> index_key;
+      std::vector<RID> rids;
+      while (!done) {
+        for (auto key : stable_keys) {
+          rids.clear();
+          index_key.SetFromInteger(key);
+          if (!tree.GetValue(index_key, &rids) || rids[0].GetSlotNum() != key) {
+            misses++;
+          }
+        }
+      }
+    });
+  }
+  for (int round = 0; round < 3; round++) {
+    LaunchParallelTest(2, InsertHelperSplit, &tree, churn_keys, 2);
+    LaunchParallelTest(2, DeleteHelperSplit, &tree, churn_keys, 2);
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, misses);
+
+  // a scan that starts with an optimistic descent sees every remaining key
+  int64_t size = 0;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ(stable_keys[size], (*iterator).second.GetSlotNum());
+    size = size + 1;
+  }
+  EXPECT_EQ(static_cast<int64_t>(stable_keys.size()), size);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, ReadHeavyBenchmark) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(4, 256, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 20000;
+  std::vector<int64_t> keys(num_keys);
+  for (int64_t key = 0; key < num_keys; key++) {
+    keys[key] = key;
+  }
+  InsertHelper(&tree, keys);
+
+  // 95% point lookups, 5% inserts of fresh keys, the same total work split over more and more threads
+  const bool optimistic_reads = btree_optimistic_reads;
+  const int total_ops = 40000;
+  std::atomic<int64_t> next_key{num_keys};
+  for (bool optimistic : {false, true}) {
+    btree_optimistic_reads = optimistic;
+    for (int num_threads : {1, 2, 4, 8}) {
+      std::atomic<int> misses{0};
+      auto start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+        std::mt19937_64 rng(thread_itr);
+        GenericKey<8> index_key;
+        std::vector<RID> rids;
+        for (int i = 0; i < total_ops / num_threads; i++) {
+          if (i % 20 == 0) {
+            int64_t key = next_key++;
+            index_key.SetFromInteger(key);
+            tree.Insert(index_key, RID(key), nullptr);
+          } else {
+            rids.clear();
+            index_key.SetFromInteger(static_cast<int64_t>(rng() % num_keys));
+            if (!tree.GetValue(index_key, &rids)) {
+              misses++;
+            }
+          }
+        }
+      });
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      EXPECT_EQ(0, misses);
+      printf("%s reads, %d threads: %8.0f ops/s\n", optimistic ? "optimistic" : "latched   ", num_threads,
+             total_ops / elapsed);
+    }
+  }
+  btree_optimistic_reads = optimistic_reads;
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, OptimisticWriteTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(256, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 16, 16);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 4000;
+  std::vector<int64_t> keys(num_keys);
+  for (int64_t key = 0; key < num_keys; key++) {
+    keys[key] = key;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  LaunchParallelTest(4, InsertHelperSplit, &tree, keys, 4);
+  // duplicates are turned away by the optimistic descent as well
+  LaunchParallelTest(2, InsertHelper, &tree, std::vector<int64_t>(keys.begin(), keys.begin() + 100));
+
+  // only the inserts into leaves about to split, and the first ones while the root was a leaf, restart
+  uint64_t optimistic_writes = tree.GetOptimisticWrites();
+  uint64_t write_restarts = tree.GetWriteRestarts();
+  EXPECT_EQ(num_keys + 200, optimistic_writes + write_restarts);
+  EXPECT_GT(optimistic_writes, 4 * write_restarts);
+
+  std::vector<RID> rids;
+  GenericKey<8> index_key;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+  }
+
+  // remove every other key, then the rest; removes of missing keys stay optimistic
+  std::vector<int64_t> even_keys;
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 0; key < num_keys; key++) {
+    (key % 2 == 0 ? even_keys : odd_keys).push_back(key);
+  }
+  LaunchParallelTest(4, DeleteHelperSplit, &tree, even_keys, 4);
+  int64_t size = 0;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ(odd_keys[size], (*iterator).second.GetSlotNum());
+    size = size + 1;
+  }
+  EXPECT_EQ(static_cast<int64_t>(odd_keys.size()), size);
+  LaunchParallelTest(4, DeleteHelperSplit, &tree, keys, 4);
+  EXPECT_TRUE(tree.IsEmpty());
+  EXPECT_EQ(num_keys + 200 + num_keys / 2 + num_keys, tree.GetOptimisticWrites() + tree.GetWriteRestarts());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, WriteHeavyBenchmark) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  // inserts and removes of random keys, the same total work split over more and more threads
+  const bool optimistic_writes = btree_optimistic_writes;
+  const int64_t num_keys = 20000;
+  const int total_ops = 40000;
+  for (bool optimistic : {false, true}) {
+    btree_optimistic_writes = optimistic;
+    for (int num_threads : {1, 2, 4, 8}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManager(4, 256, disk_manager);
+      BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+
+      // create and fetch header_page
+      page_id_t page_id;
+      auto header_page = bpm->NewPage(&page_id);
+      (void)header_page;
+
+      std::vector<int64_t> keys(num_keys);
+      for (int64_t key = 0; key < num_keys; key++) {
+        keys[key] = key;
+      }
+      InsertHelper(&tree, keys);
+      uint64_t base_writes = tree.GetOptimisticWrites();
+      uint64_t base_restarts = tree.GetWriteRestarts();
+
+      auto start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+        std::mt19937_64 rng(thread_itr);
+        GenericKey<8> index_key;
+        for (int i = 0; i < total_ops / num_threads; i++) {
+          int64_t key = static_cast<int64_t>(rng() % (2 * num_keys));
+          index_key.SetFromInteger(key);
+          if (i % 2 == 0) {
+            tree.Insert(index_key, RID(key), nullptr);
+          } else {
+            tree.Remove(index_key, nullptr);
+          }
+        }
+      });
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      uint64_t restarts = tree.GetWriteRestarts() - base_restarts;
+      uint64_t writes = tree.GetOptimisticWrites() - base_writes + restarts;
+      printf("%s writes, %d threads: %8.0f ops/s, %5.2f%% restarted\n", optimistic ? "optimistic " : "pessimistic",
+             num_threads, total_ops / elapsed, writes == 0 ? 0.0 : 100.0 * restarts / writes);
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete disk_manager;
+      delete bpm;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+  btree_optimistic_writes = optimistic_writes;
+
+  delete key_schema;
+}
+
+TEST(BPlusTreeConcurrentTest, BLinkInsertTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(256, disk_manager);
+  // small nodes, so that splits run up to a new root while other threads descend
+  const BTreeLatchProtocol latch_protocol = btree_latch_protocol;
+  btree_latch_protocol = BTreeLatchProtocol::BLINK;
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+  btree_latch_protocol = latch_protocol;
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 5000;
+  std::vector<int64_t> keys(num_keys);
+  for (int64_t key = 0; key < num_keys; key++) {
+    keys[key] = key;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  LaunchParallelTest(4, InsertHelperSplit, &tree, keys, 4);
+
+  std::vector<RID> rids;
+  GenericKey<8> index_key;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    ASSERT_EQ(1, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+  int64_t current_key = 0;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ(current_key++, (*iterator).second.GetSlotNum());
+  }
+  EXPECT_EQ(num_keys, current_key);
+
+  // removes only empty out leaves; the keys can come back
+  LaunchParallelTest(4, DeleteHelperSplit, &tree, keys, 4);
+  EXPECT_TRUE(tree.begin() == tree.end());
+  LaunchParallelTest(4, InsertHelperSplit, &tree, keys, 4);
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.GetValue(index_key, &rids));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, BLinkMixTest) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(256, disk_manager);
+  const BTreeLatchProtocol latch_protocol = btree_latch_protocol;
+  btree_latch_protocol = BTreeLatchProtocol::BLINK;
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+  btree_latch_protocol = latch_protocol;
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // readers look up the even keys while writers split the pages under them with the odd ones
+  const int64_t num_keys = 4000;
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 0; key < num_keys; key++) {
+    (key % 2 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  std::atomic<bool> done{false};
+  std::atomic<int> misses{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 2; i++) {
+    readers.emplace_back([&]() {
+      GenericKey<8> index_key;
+      std::vector<RID> rids;
+      while (!done) {
+        for (auto key : stable_keys) {
+          rids.clear();
+          index_key.SetFromInteger(key);
+          if (!tree.GetValue(index_key, &rids) || rids[0].GetSlotNum() != key) {
+            misses++;
+          }
+        }
+      }
+    });
+  }
+  for (int round = 0; round < 3; round++) {
+    LaunchParallelTest(2, InsertHelperSplit, &tree, churn_keys, 2);
+    LaunchParallelTest(2, DeleteHelperSplit, &tree, churn_keys, 2);
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, misses);
+
+  int64_t size = 0;
+  for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+    EXPECT_EQ(stable_keys[size], (*iterator).second.GetSlotNum());
+    size = size + 1;
+  }
+  EXPECT_EQ(static_cast<int64_t>(stable_keys.size()), size);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeConcurrentTest, BLinkBenchmark) {
+  // create KeyComparator and index schema
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  // half inserts of fresh keys, half point lookups, the same total work split over more and more threads
+  const BTreeLatchProtocol latch_protocol = btree_latch_protocol;
+  const int64_t num_keys = 20000;
+  const int total_ops = 40000;
+  for (BTreeLatchProtocol protocol : {BTreeLatchProtocol::CRABBING, BTreeLatchProtocol::BLINK}) {
+    for (int num_threads : {1, 2, 4, 8}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManager(4, 256, disk_manager);
+      btree_latch_protocol = protocol;
+      BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+      btree_latch_protocol = latch_protocol;
+
+      // create and fetch header_page
+      page_id_t page_id;
+      auto header_page = bpm->NewPage(&page_id);
+      (void)header_page;
+
+      std::vector<int64_t> keys(num_keys);
+      for (int64_t key = 0; key < num_keys; key++) {
+        keys[key] = 2 * key;
+      }
+      InsertHelper(&tree, keys);
+
+      std::atomic<int> misses{0};
+      auto start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+        std::mt19937_64 rng(thread_itr);
+        GenericKey<8> index_key;
+        std::vector<RID> rids;
+        for (int i = 0; i < total_ops / num_threads; i++) {
+          int64_t key = 2 * static_cast<int64_t>(rng() % num_keys);
+          if (i % 2 == 0) {
+            index_key.SetFromInteger(key + 1);
+            tree.Insert(index_key, RID(key + 1), nullptr);
+          } else {
+            rids.clear();
+            index_key.SetFromInteger(key);
+            if (!tree.GetValue(index_key, &rids)) {
+              misses++;
+            }
+          }
+        }
+      });
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      EXPECT_EQ(0, misses);
+      printf("%-8s %d threads: %8.0f ops/s\n", protocol == BTreeLatchProtocol::BLINK ? "b-link" : "crabbing",
+             num_threads, total_ops / elapsed);
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete disk_manager;
+      delete bpm;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+
+  delete key_schema;
+}
+
 // TEST(BPlusTreeConcurrentTest, MixTest2) {
 //   // create KeyComparator and index schema
 //   Schema *key_schema = ParseCreateStatement("a bigint");
@@ -0,0 +1,213 @@
+/**
+ * b_plus_tree_range_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+
+namespace bustub {
+
+using Tree = BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
+
+// scan [low, high) of tree, with either bound left out if it is negative, and check it against expected
+void CheckRange(Tree *tree, const std::set<int64_t> &expected, int64_t low, int64_t high, bool reverse) {
+  GenericKey<8> low_key;
+  GenericKey<8> high_key;
+  low_key.SetFromInteger(low);
+  high_key.SetFromInteger(high);
+  std::vector<int64_t> keys;
+  for (auto iterator = tree->Range(low < 0 ? nullptr : &low_key, high < 0 ? nullptr : &high_key, reverse);
+       iterator != tree->end(); ++iterator) {
+    keys.push_back((*iterator).first.ToString());
+    ASSERT_EQ(keys.back(), (*iterator).second.GetSlotNum());
+  }
+
+  std::vector<int64_t> expected_keys(expected.lower_bound(std::max<int64_t>(low, 0)),
+                                     high < 0 ? expected.end() : expected.lower_bound(std::max(low, high)));
+  if (reverse) {
+    std::reverse(expected_keys.begin(), expected_keys.end());
+  }
+  ASSERT_EQ(expected_keys, keys) << "[" << low << ", " << high << ")" << (reverse ? " reverse" : "");
+}
+
+TEST(BPlusTreeTests, RangeScanTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const BTreeLatchProtocol latch_protocol = btree_latch_protocol;
+  const int64_t num_keys = 2000;
+
+  for (auto protocol : {BTreeLatchProtocol::CRABBING, BTreeLatchProtocol::BLINK}) {
+    btree_latch_protocol = protocol;
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    Tree tree("foo_pk", bpm, comparator, 4, 5);
+
+    // an empty tree has no keys in any range
+    std::set<int64_t> expected;
+    CheckRange(&tree, expected, -1, -1, false);
+    CheckRange(&tree, expected, -1, -1, true);
+
+    // even keys, most of them removed again, so that leaves run empty or merge
+    std::vector<int64_t> keys;
+    for (int64_t key = 0; key < num_keys; key += 2) {
+      keys.push_back(key);
+    }
+    std::mt19937_64 rng(15445);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    GenericKey<8> index_key;
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, RID(0, key));
+      expected.insert(key);
+    }
+    for (size_t i = 0; i < keys.size() * 3 / 4; i++) {
+      index_key.SetFromInteger(keys[i]);
+      tree.Remove(index_key);
+      expected.erase(keys[i]);
+    }
+
+    for (bool reverse : {false, true}) {
+      CheckRange(&tree, expected, -1, -1, reverse);
+      for (int i = 0; i < 300; i++) {
+        // bounds on keys, between them, outside of all of them or left out
+        int64_t low = static_cast<int64_t>(rng() % (num_keys + 20)) - 10;
+        int64_t high = low + static_cast<int64_t>(rng() % (i < 150 ? 20 : num_keys));
+        CheckRange(&tree, expected, low, high, reverse);
+        CheckRange(&tree, expected, -1, high, reverse);
+        CheckRange(&tree, expected, low, -1, reverse);
+      }
+    }
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  btree_latch_protocol = latch_protocol;
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, RangeScanReadsTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+  Tree tree("foo_pk", bpm, comparator);
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < 50000; key++) {
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, RID(0, key));
+  }
+
+  // the tree has far more leaves than the pool has frames: a full scan reads them all, and leaves the middle of the
+  // tree out of the pool; a short range there reads the pages down to its leaf and at most one leaf past it
+  std::set<int64_t> expected;
+  for (int64_t key = 0; key < 50000; key++) {
+    expected.insert(key);
+  }
+  for (bool reverse : {false, true}) {
+    int reads = disk_manager->GetNumReads();
+    CheckRange(&tree, expected, -1, -1, reverse);
+    int scan_reads = disk_manager->GetNumReads() - reads;
+    reads = disk_manager->GetNumReads();
+    CheckRange(&tree, expected, 25000, 25100, reverse);
+    int range_reads = disk_manager->GetNumReads() - reads;
+    printf("%s: %d pages read for all keys, %d for 100 keys\n", reverse ? "reverse" : "forward", scan_reads,
+           range_reads);
+    EXPECT_GT(scan_reads, 100);
+    EXPECT_LE(range_reads, 8);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, RangeScanConcurrentTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const BTreeLatchProtocol latch_protocol = btree_latch_protocol;
+  const int64_t num_keys = 4000;
+
+  for (auto protocol : {BTreeLatchProtocol::CRABBING, BTreeLatchProtocol::BLINK}) {
+    btree_latch_protocol = protocol;
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    Tree tree("foo_pk", bpm, comparator, 4, 5);
+    std::set<int64_t> expected;
+    GenericKey<8> index_key;
+    for (int64_t key = 0; key < num_keys; key += 2) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, RID(0, key));
+      expected.insert(key);
+    }
+
+    // writers insert and remove odd keys while scans in either direction must see exactly the even ones
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; t++) {
+      threads.emplace_back([&, t] {
+        GenericKey<8> key;
+        for (int64_t odd = 1 + 2 * t; odd < num_keys; odd += 4) {
+          key.SetFromInteger(odd);
+          tree.Insert(key, RID(0, odd));
+        }
+        for (int64_t odd = 1 + 2 * t; odd < num_keys; odd += 4) {
+          key.SetFromInteger(odd);
+          tree.Remove(key);
+        }
+      });
+    }
+    for (int t = 0; t < 2; t++) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < 20; i++) {
+          std::vector<int64_t> keys;
+          for (auto iterator = tree.Range(nullptr, nullptr, t == 1); iterator != tree.end(); ++iterator) {
+            if ((*iterator).first.ToString() % 2 == 0) {
+              keys.push_back((*iterator).first.ToString());
+            }
+          }
+          if (t == 1) {
+            std::reverse(keys.begin(), keys.end());
+          }
+          EXPECT_EQ(std::vector<int64_t>(expected.begin(), expected.end()), keys);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    CheckRange(&tree, expected, -1, -1, true);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  btree_latch_protocol = latch_protocol;
+  delete key_schema;
+}
+
+}  // namespace bustub
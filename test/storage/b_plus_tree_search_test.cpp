@@ -0,0 +1,517 @@
+/**
+ * b_plus_tree_search_test.cpp
+ */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "b_plus_tree_test_util.h"  // NOLINT
+#include "buffer/buffer_pool_manager.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/table/tuple.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// a value of the column's type: small ones, so that keys tie on it, any in its range, or null
+Value RandomValue(TypeId type, std::mt19937_64 *rng) {
+  int64_t min;
+  int64_t max;
+  switch (type) {
+    case TypeId::TINYINT:
+      min = std::numeric_limits<int8_t>::min();
+      max = std::numeric_limits<int8_t>::max();
+      break;
+    case TypeId::SMALLINT:
+      min = std::numeric_limits<int16_t>::min();
+      max = std::numeric_limits<int16_t>::max();
+      break;
+    case TypeId::INTEGER:
+      min = std::numeric_limits<int32_t>::min();
+      max = std::numeric_limits<int32_t>::max();
+      break;
+    default:
+      min = std::numeric_limits<int64_t>::min();
+      max = std::numeric_limits<int64_t>::max();
+      break;
+  }
+  int choice = (*rng)() % 20;
+  if (choice == 0) {
+    return ValueFactory::GetNullValueByType(type);
+  }
+  // the minimum of each type stands for null
+  int64_t value = choice < 10 ? static_cast<int64_t>((*rng)() % 7) - 3
+                              : std::uniform_int_distribution<int64_t>(min + 1, max)(*rng);
+  switch (type) {
+    case TypeId::TINYINT:
+      return ValueFactory::GetTinyIntValue(value);
+    case TypeId::SMALLINT:
+      return ValueFactory::GetSmallIntValue(value);
+    case TypeId::INTEGER:
+      return ValueFactory::GetIntegerValue(value);
+    default:
+      return ValueFactory::GetBigIntValue(value);
+  }
+}
+
+TEST(BPlusTreeTests, KeyPrefixTest) {
+  std::mt19937_64 rng(15445);
+  for (std::string sql : {"a tinyint", "a smallint", "a integer", "a bigint", "a bigint,b integer",
+                          "a integer,b bigint", "a varchar(4),b bigint"}) {
+    Schema *key_schema = ParseCreateStatement(sql);
+    GenericComparator<32> comparator(key_schema);
+    std::vector<GenericKey<32>> keys(200);
+    for (auto &key : keys) {
+      std::vector<Value> values;
+      for (const auto &column : key_schema->GetColumns()) {
+        values.push_back(column.GetType() == TypeId::VARCHAR ? ValueFactory::GetVarcharValue(std::string("ab"))
+                                                              : RandomValue(column.GetType(), &rng));
+      }
+      key.SetFromKey(Tuple(values, key_schema));
+    }
+
+    // wherever the prefixes decide, they agree with the comparator
+    int decided = 0;
+    for (const auto &lhs : keys) {
+      for (const auto &rhs : keys) {
+        int cmp = comparator.ComparePrefixes(comparator.KeyPrefix(lhs), comparator.KeyPrefix(rhs));
+        if (cmp != GenericComparator<32>::PREFIX_TIE) {
+          ASSERT_EQ(comparator(lhs, rhs), cmp) << sql;
+          decided++;
+        }
+      }
+    }
+    // a varchar first column has no prefix
+    EXPECT_EQ(sql.find("varchar") != std::string::npos, decided == 0) << sql;
+    delete key_schema;
+  }
+
+  // comparators created with prefix search off have none
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  btree_key_prefix_search = false;
+  GenericComparator<8> comparator(key_schema);
+  btree_key_prefix_search = true;
+  GenericKey<8> key;
+  key.SetFromInteger(42);
+  EXPECT_EQ(0, comparator.KeyPrefix(key));
+  delete key_schema;
+}
+
+// a value of any key column type; varchars are short, with zero bytes, and not null
+Value RandomKeyValue(TypeId type, std::mt19937_64 *rng) {
+  bool null = (*rng)() % 20 == 0;
+  switch (type) {
+    case TypeId::BOOLEAN:
+      return null ? ValueFactory::GetNullValueByType(type) : ValueFactory::GetBooleanValue((*rng)() % 2 == 0);
+    case TypeId::DECIMAL: {
+      double choices[] = {-1e300, -2.5, -1.0, -0.0, 0.0, 1.0, 2.5, 1e300};
+      return null ? ValueFactory::GetNullValueByType(type)
+                  : ValueFactory::GetDecimalValue((*rng)() % 2 == 0 ? choices[(*rng)() % 8]
+                                                                   : std::normal_distribution<double>(0, 1e6)(*rng));
+    }
+    case TypeId::VARCHAR: {
+      std::string value((*rng)() % 4, 'a');
+      for (auto &c : value) {
+        c = "\0ab\xff"[(*rng)() % 4];
+      }
+      return ValueFactory::GetVarcharValue(value);
+    }
+    default:
+      return RandomValue(type, rng);
+  }
+}
+
+// how the columns of two keys compare, with nulls first
+int CompareValues(const std::vector<Value> &lhs, const std::vector<Value> &rhs) {
+  for (size_t i = 0; i < lhs.size(); i++) {
+    if (lhs[i].IsNull() || rhs[i].IsNull()) {
+      if (lhs[i].IsNull() != rhs[i].IsNull()) {
+        return lhs[i].IsNull() ? -1 : 1;
+      }
+    } else if (lhs[i].CompareLessThan(rhs[i]) == CmpBool::CmpTrue) {
+      return -1;
+    } else if (lhs[i].CompareGreaterThan(rhs[i]) == CmpBool::CmpTrue) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+TEST(BPlusTreeTests, NormalizedKeyTest) {
+  std::mt19937_64 rng(15445);
+  for (std::string sql : {"a tinyint,b smallint", "a integer,b bigint", "a boolean,b double", "a bigint",
+                          "a varchar(3),b integer", "a varchar(3),b varchar(3)"}) {
+    Schema *key_schema = ParseCreateStatement(sql);
+    GenericComparator<32> comparator(key_schema, KeyEncoding::NORMALIZED);
+    std::vector<std::vector<Value>> values(300);
+    std::vector<GenericKey<32>> keys(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+      for (const auto &column : key_schema->GetColumns()) {
+        values[i].push_back(RandomKeyValue(column.GetType(), &rng));
+      }
+      keys[i].SetFromKey(Tuple(values[i], key_schema), key_schema);
+    }
+
+    // the bytes sort as the values do, and so do the prefixes wherever they decide
+    for (size_t i = 0; i < keys.size(); i++) {
+      for (size_t j = 0; j < keys.size(); j++) {
+        int cmp = CompareValues(values[i], values[j]);
+        ASSERT_EQ(cmp, comparator(keys[i], keys[j])) << sql << " " << i << " " << j;
+        int prefix_cmp = comparator.ComparePrefixes(comparator.KeyPrefix(keys[i]), comparator.KeyPrefix(keys[j]));
+        if (prefix_cmp != GenericComparator<32>::PREFIX_TIE) {
+          ASSERT_EQ(cmp, prefix_cmp) << sql;
+        }
+      }
+    }
+    delete key_schema;
+  }
+
+  // integers are big-endian with the sign bit flipped, and null is all zeros
+  Schema *key_schema = ParseCreateStatement("a integer");
+  GenericKey<4> key;
+  key.SetFromKey(Tuple({ValueFactory::GetIntegerValue(-2)}, key_schema), key_schema);
+  EXPECT_EQ(0, memcmp(key.data_, "\x7f\xff\xff\xfe", 4));
+  key.SetFromKey(Tuple({ValueFactory::GetNullValueByType(TypeId::INTEGER)}, key_schema), key_schema);
+  EXPECT_EQ(0, memcmp(key.data_, "\0\0\0\0", 4));
+  delete key_schema;
+
+  // varchars have their zero bytes escaped and are cut off at the key size
+  key_schema = ParseCreateStatement("a varchar(8)");
+  key.SetFromKey(Tuple({ValueFactory::GetVarcharValue(std::string("a\0", 2))}, key_schema), key_schema);
+  EXPECT_EQ(0, memcmp(key.data_, "a\0\xff\0", 4));
+  GenericKey<4> other_key;
+  other_key.SetFromKey(Tuple({ValueFactory::GetVarcharValue(std::string("a\0\0", 3))}, key_schema), key_schema);
+  EXPECT_EQ(0, GenericComparator<4>(key_schema, KeyEncoding::NORMALIZED)(key, other_key));
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, PrefixSearchTest) {
+  // keys that differ only in their second column take the comparator
+  for (std::string sql : {"a bigint", "a integer,b integer"}) {
+    Schema *key_schema = ParseCreateStatement(sql);
+    GenericComparator<8> comparator(key_schema);
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+
+    // negative keys sort before positive ones, which their little-endian bytes do not
+    std::vector<int64_t> keys;
+    for (int64_t key = -5000; key < 5000; key++) {
+      keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+    auto make_key = [&](int64_t key) {
+      GenericKey<8> index_key;
+      if (key_schema->GetColumnCount() == 1) {
+        index_key.SetFromInteger(key);
+      } else {
+        index_key.SetFromKey(Tuple({ValueFactory::GetIntegerValue(static_cast<int32_t>(key / 100)),
+                                    ValueFactory::GetIntegerValue(static_cast<int32_t>(key % 100))},
+                                   key_schema));
+      }
+      return index_key;
+    };
+    for (auto key : keys) {
+      EXPECT_TRUE(tree.Insert(make_key(key), RID(0, key + 5000)));
+    }
+
+    int64_t slot = 0;
+    GenericKey<8> last_key;
+    for (auto iterator = tree.begin(); iterator != tree.end(); ++iterator) {
+      if (slot > 0) {
+        EXPECT_LT(comparator(last_key, (*iterator).first), 0);
+      }
+      last_key = (*iterator).first;
+      slot++;
+    }
+    EXPECT_EQ(keys.size(), slot);
+    std::vector<RID> rids;
+    for (auto key : keys) {
+      rids.clear();
+      EXPECT_TRUE(tree.GetValue(make_key(key), &rids));
+      ASSERT_EQ(1, rids.size());
+      EXPECT_EQ(key + 5000, rids[0].GetSlotNum());
+    }
+    rids.clear();
+    EXPECT_FALSE(tree.GetValue(make_key(5000), &rids));
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+    delete key_schema;
+  }
+}
+
+TEST(BPlusTreeTests, PrefixSearchBenchmark) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  const int64_t num_keys = 100000;
+  const int64_t num_lookups = 300000;
+  std::vector<int64_t> keys(num_lookups);
+  std::mt19937_64 rng(15445);
+  for (auto &key : keys) {
+    key = rng() % num_keys;
+  }
+
+  for (bool prefix_search : {false, true}) {
+    btree_key_prefix_search = prefix_search;
+    GenericComparator<8> comparator(key_schema);
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+    GenericKey<8> index_key;
+    for (int64_t key = 0; key < num_keys; key++) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, RID(0, key));
+    }
+
+    std::vector<RID> rids;
+    rids.reserve(num_lookups);
+    auto start = std::chrono::steady_clock::now();
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      tree.GetValue(index_key, &rids);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_lookups, rids.size());
+    printf("%s: %ld lookups %6.3f s, %.0f lookups/s\n", prefix_search ? "prefix search" : "comparator   ",
+           num_lookups, elapsed, num_lookups / elapsed);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  btree_key_prefix_search = true;
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, GetValuesTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  const BTreeLatchProtocol latch_protocol = btree_latch_protocol;
+  const int64_t num_keys = 4000;
+
+  for (auto protocol : {BTreeLatchProtocol::CRABBING, BTreeLatchProtocol::BLINK}) {
+    btree_latch_protocol = protocol;
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5);
+
+    // an empty tree has none of the keys
+    std::vector<GenericKey<8>> batch(3);
+    std::vector<std::vector<RID>> results;
+    EXPECT_EQ(0, tree.GetValues(batch, &results));
+    EXPECT_EQ(3, results.size());
+
+    GenericKey<8> index_key;
+    for (int64_t key = 0; key < num_keys; key += 2) {
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, RID(0, key));
+    }
+
+    // batches of even keys, which are in the tree, and odd ones, which are not: sorted, with repeats, or in any order,
+    // each close together or spread over the tree
+    std::mt19937_64 rng(15445);
+    for (int i = 0; i < 300; i++) {
+      std::vector<int64_t> keys(1 + rng() % 64);
+      int64_t span = i % 2 == 0 ? 50 : num_keys;
+      int64_t start = static_cast<int64_t>(rng() % num_keys);
+      for (auto &key : keys) {
+        key = (start + static_cast<int64_t>(rng() % span)) % (num_keys + 10);
+      }
+      if (i % 3 != 0) {
+        std::sort(keys.begin(), keys.end());
+      }
+      batch.resize(keys.size());
+      for (size_t j = 0; j < keys.size(); j++) {
+        batch[j].SetFromInteger(keys[j]);
+      }
+      results.clear();
+      size_t found = tree.GetValues(batch, &results);
+      ASSERT_EQ(keys.size(), results.size());
+      size_t expected_found = 0;
+      for (size_t j = 0; j < keys.size(); j++) {
+        if (keys[j] % 2 == 0 && keys[j] < num_keys) {
+          ASSERT_EQ(1, results[j].size()) << keys[j];
+          ASSERT_EQ(keys[j], results[j][0].GetSlotNum());
+          expected_found++;
+        } else {
+          ASSERT_TRUE(results[j].empty()) << keys[j];
+        }
+      }
+      ASSERT_EQ(expected_found, found);
+    }
+
+    // writers insert and remove odd keys, splitting and merging leaves, while batches of all keys find the even ones
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; t++) {
+      threads.emplace_back([&, t] {
+        GenericKey<8> key;
+        for (int64_t odd = 1 + 2 * t; odd < num_keys; odd += 4) {
+          key.SetFromInteger(odd);
+          tree.Insert(key, RID(0, odd));
+        }
+        for (int64_t odd = 1 + 2 * t; odd < num_keys; odd += 4) {
+          key.SetFromInteger(odd);
+          tree.Remove(key);
+        }
+      });
+    }
+    for (int t = 0; t < 2; t++) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < 20; i++) {
+          std::vector<GenericKey<8>> all_keys(num_keys);
+          for (int64_t key = 0; key < num_keys; key++) {
+            all_keys[key].SetFromInteger(key);
+          }
+          std::vector<std::vector<RID>> all_results;
+          tree.GetValues(all_keys, &all_results);
+          for (int64_t key = 0; key < num_keys; key += 2) {
+            EXPECT_EQ(1, all_results[key].size()) << key;
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  btree_latch_protocol = latch_protocol;
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, GetValuesBenchmark) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema, KeyEncoding::NORMALIZED);
+  const int64_t num_lookups = 300000;
+  auto make_key = [&](int64_t key) {
+    GenericKey<8> index_key;
+    index_key.SetFromKey(Tuple({ValueFactory::GetBigIntValue(key)}, key_schema), key_schema);
+    return index_key;
+  };
+
+  // random keys of a large tree, where few keys of a batch share a leaf, and of a small one, where many do
+  for (int64_t num_keys : {100000, 5000}) {
+    std::vector<GenericKey<8>> keys(num_lookups);
+    std::mt19937_64 rng(15445);
+    for (auto &key : keys) {
+      key = make_key(static_cast<int64_t>(rng() % num_keys));
+    }
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(1000, disk_manager);
+    page_id_t page_id;
+    bpm->NewPage(&page_id);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+    for (int64_t key = 0; key < num_keys; key++) {
+      tree.Insert(make_key(key), RID(0, key));
+    }
+
+    // looked up one GetValue at a time or in batches, which are sorted first as BPlusTreeIndex::ScanKeys sorts them
+    for (size_t batch_size : {0, 1, 16, 256}) {
+      size_t found = 0;
+      std::vector<GenericKey<8>> batch;
+      std::vector<std::vector<RID>> results;
+      std::vector<RID> rids;
+      auto start = std::chrono::steady_clock::now();
+      for (size_t first = 0; batch_size == 0 && first < keys.size(); first++) {
+        rids.clear();
+        found += tree.GetValue(keys[first], &rids) ? 1 : 0;
+      }
+      for (size_t first = 0; batch_size > 0 && first < keys.size(); first += batch_size) {
+        batch.assign(keys.begin() + first, keys.begin() + std::min(first + batch_size, keys.size()));
+        std::sort(batch.begin(), batch.end(),
+                  [&](const GenericKey<8> &lhs, const GenericKey<8> &rhs) { return comparator(lhs, rhs) < 0; });
+        for (auto &result : results) {
+          result.clear();
+        }
+        found += tree.GetValues(batch, &results);
+      }
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      EXPECT_EQ(num_lookups, found);
+      printf("%6ld keys, %s %4zu: %ld lookups %6.3f s, %.0f lookups/s\n", num_keys,
+             batch_size == 0 ? "GetValue        " : "GetValues, batch", batch_size, num_lookups, elapsed,
+             num_lookups / elapsed);
+    }
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+  }
+  delete key_schema;
+}
+
+TEST(BPlusTreeTests, ComparatorBenchmark) {
+  const int num_keys = 1024;
+  const int num_compares = 2000000;
+  std::mt19937_64 rng(15445);
+  btree_key_prefix_search = false;
+  for (std::string sql : {"a bigint", "a integer,b bigint", "a bigint,b bigint,c bigint,d bigint",
+                          "a varchar(8),b integer"}) {
+    Schema *key_schema = ParseCreateStatement(sql);
+    std::vector<Tuple> tuples;
+    for (int i = 0; i < num_keys; i++) {
+      std::vector<Value> values;
+      for (const auto &column : key_schema->GetColumns()) {
+        values.push_back(column.GetType() == TypeId::VARCHAR ? ValueFactory::GetVarcharValue(std::to_string(rng() % 4))
+                                                              : RandomValue(column.GetType(), &rng));
+      }
+      tuples.emplace_back(values, key_schema);
+    }
+
+    double elapsed[2];
+    for (auto encoding : {KeyEncoding::TUPLE, KeyEncoding::NORMALIZED}) {
+      GenericComparator<64> comparator(key_schema, encoding);
+      std::vector<GenericKey<64>> keys(num_keys);
+      for (int i = 0; i < num_keys; i++) {
+        if (encoding == KeyEncoding::TUPLE) {
+          keys[i].SetFromKey(tuples[i]);
+        } else {
+          keys[i].SetFromKey(tuples[i], key_schema);
+        }
+      }
+      int64_t less = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < num_compares; i++) {
+        less += comparator(keys[i % num_keys], keys[(i * 7 + 1) % num_keys]) < 0 ? 1 : 0;
+      }
+      elapsed[static_cast<int>(encoding)] =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      EXPECT_GT(less, 0);
+    }
+    printf("%-36s tuple %6.1f ns, normalized %6.1f ns per comparison\n", sql.c_str(),
+           elapsed[0] * 1e9 / num_compares, elapsed[1] * 1e9 / num_compares);
+    delete key_schema;
+  }
+  btree_key_prefix_search = true;
+}
+
+}  // namespace bustub
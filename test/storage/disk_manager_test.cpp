@@ -10,7 +10,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -24,12 +29,14 @@ class DiskManagerTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.fsm");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
     remove("test.log");
+    remove("test.fsm");
   };
 };
 
@@ -55,6 +62,149 @@ TEST_F(DiskManagerTest, ReadWritePageTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, WritePagesTest) {
+  // pages 0-2 and 5-6 as two runs, handed over out of order
+  const std::vector<page_id_t> page_ids{6, 1, 0, 5, 2};
+  std::vector<std::vector<char>> data(page_ids.size(), std::vector<char>(PAGE_SIZE));
+  std::vector<std::pair<page_id_t, const char *>> pages;
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    std::snprintf(data[i].data(), PAGE_SIZE, "page %d", page_ids[i]);
+    data[i][PAGE_SIZE - 1] = static_cast<char>(page_ids[i]);
+    pages.emplace_back(page_ids[i], data[i].data());
+  }
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  dm.WritePages(&pages);
+  EXPECT_EQ(5, dm.GetNumWrites());
+  EXPECT_EQ(2, dm.GetNumWriteCalls());
+  EXPECT_TRUE(std::is_sorted(pages.begin(), pages.end()));
+
+  char buf[PAGE_SIZE] = {0};
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    dm.ReadPage(page_ids[i], buf);
+    EXPECT_EQ(std::memcmp(buf, data[i].data(), PAGE_SIZE), 0);
+  }
+  // the gap between the runs was not written
+  dm.ReadPage(3, buf);
+  EXPECT_EQ(0, buf[0]);
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreeSpaceMapTest) {
+  std::string db_file("test.db");
+  char data[PAGE_SIZE] = {0};
+  {
+    auto dm = DiskManager(db_file);
+    for (page_id_t page_id = 0; page_id < 200; ++page_id) {
+      EXPECT_EQ(page_id, dm.AllocatePage());
+      dm.WritePage(page_id, data);
+    }
+
+    // freed pages come back lowest first, before the file grows
+    dm.DeallocatePage(150);
+    dm.DeallocatePage(3);
+    dm.DeallocatePage(70);
+    dm.DeallocatePage(3);    // double free is ignored
+    dm.DeallocatePage(500);  // never allocated
+    EXPECT_EQ(3U, dm.GetNumFreePages());
+    EXPECT_EQ(3, dm.AllocatePage());
+    EXPECT_EQ(70, dm.AllocatePage());
+    EXPECT_EQ(1U, dm.GetNumFreePages());
+
+    // nothing to truncate while the last page is in use
+    dm.DeallocatePage(198);
+    EXPECT_EQ(0U, dm.TruncateFreePages());
+    EXPECT_EQ(2U, dm.GetNumFreePages());
+    dm.ShutDown();
+  }
+
+  {
+    // the free-space map survives a restart, and new pages go after the end of the file
+    auto dm = DiskManager(db_file);
+    EXPECT_EQ(2U, dm.GetNumFreePages());
+    EXPECT_EQ(150, dm.AllocatePage());
+    EXPECT_EQ(198, dm.AllocatePage());
+    EXPECT_EQ(200, dm.AllocatePage());
+    dm.WritePage(200, data);
+
+    // the free pages at the end of the file are given back to the file system
+    for (page_id_t page_id = 180; page_id <= 200; ++page_id) {
+      dm.DeallocatePage(page_id);
+    }
+    dm.DeallocatePage(10);
+    EXPECT_EQ(22U, dm.GetNumFreePages());
+    EXPECT_EQ(21U, dm.TruncateFreePages());
+    EXPECT_EQ(180U, dm.GetNumDiskPages());
+    EXPECT_EQ(1U, dm.GetNumFreePages());
+    EXPECT_EQ(10, dm.AllocatePage());
+    EXPECT_EQ(180, dm.AllocatePage());
+    dm.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, PageSizeClassTest) {
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(0, dm.AllocatePage());
+  EXPECT_EQ(1, dm.AllocatePage());
+
+  // a larger page takes a run of slots aligned to its length; the slots skipped to align it are free
+  page_id_t page_16k = dm.AllocatePage(PageSizeClass::PAGE_16K);
+  EXPECT_EQ(PageSizeClass::PAGE_16K, GetPageSizeClass(page_16k));
+  EXPECT_EQ(4, GetPageSlot(page_16k));
+  EXPECT_EQ(PageSizeOfClass(PageSizeClass::PAGE_16K), PageSizeOf(page_16k));
+  EXPECT_EQ(2U, dm.GetNumFreePages());
+  page_id_t page_64k = dm.AllocatePage(PageSizeClass::PAGE_64K);
+  EXPECT_EQ(MakePageId(PageSizeClass::PAGE_64K, 16), page_64k);
+  EXPECT_EQ(10U, dm.GetNumFreePages());
+  EXPECT_EQ(MakePageId(PageSizeClass::PAGE_64K, 32), NextPageId(page_64k));
+
+  // small pages fill the gaps first
+  EXPECT_EQ(2, dm.AllocatePage());
+  EXPECT_EQ(3, dm.AllocatePage());
+  EXPECT_EQ(8U, dm.GetNumFreePages());
+
+  // pages of different sizes keep their contents apart
+  std::vector<char> data_16k(PageSizeOf(page_16k));
+  std::vector<char> data_64k(PageSizeOf(page_64k));
+  std::vector<char> buf(MAX_PAGE_SIZE);
+  for (size_t i = 0; i < data_16k.size(); ++i) {
+    data_16k[i] = static_cast<char>(i % 251);
+  }
+  for (size_t i = 0; i < data_64k.size(); ++i) {
+    data_64k[i] = static_cast<char>(i % 241);
+  }
+  dm.WritePage(page_16k, data_16k.data());
+  dm.WritePage(page_64k, data_64k.data());
+  EXPECT_EQ(32U, dm.GetNumDiskPages());
+  dm.ReadPage(page_16k, buf.data());
+  EXPECT_EQ(0, std::memcmp(buf.data(), data_16k.data(), data_16k.size()));
+  dm.ReadPage(page_64k, buf.data());
+  EXPECT_EQ(0, std::memcmp(buf.data(), data_64k.data(), data_64k.size()));
+
+  // WritePages coalesces adjacent pages of any size into one write
+  std::vector<std::pair<page_id_t, const char *>> pages{{page_16k, data_16k.data()}, {3, data_64k.data()}};
+  int write_calls = dm.GetNumWriteCalls();
+  dm.WritePages(&pages);
+  EXPECT_EQ(1, dm.GetNumWriteCalls() - write_calls);
+  dm.ReadPage(page_16k, buf.data());
+  EXPECT_EQ(0, std::memcmp(buf.data(), data_16k.data(), data_16k.size()));
+
+  // a freed large page is reused whole, and only by a page of a fitting size
+  dm.DeallocatePage(page_16k);
+  dm.DeallocatePage(page_16k + 1);  // not the start of a page
+  EXPECT_EQ(12U, dm.GetNumFreePages());
+  EXPECT_EQ(MakePageId(PageSizeClass::PAGE_64K, 32), dm.AllocatePage(PageSizeClass::PAGE_64K));
+  EXPECT_EQ(page_16k, dm.AllocatePage(PageSizeClass::PAGE_16K));
+  EXPECT_EQ(8, dm.AllocatePage());
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ReadWriteLogTest) {
   char buf[16] = {0};
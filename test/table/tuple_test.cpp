@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <iostream>
 #include <string>
@@ -21,6 +22,7 @@
 #include "logging/common.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 // NOLINTNEXTLINE
@@ -71,4 +73,108 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, TableScanReadAheadTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::BIGINT}, Column{"b", TypeId::VARCHAR, 200}}};
+  const int num_tuples = 4000;
+  const size_t read_ahead = table_scan_read_ahead;
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(32, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction);
+
+  // the table spans far more pages than the pool holds, so a scan has to read almost every page
+  for (int i = 0; i < num_tuples; ++i) {
+    Tuple tuple({ValueFactory::GetBigIntValue(i), ValueFactory::GetVarcharValue(std::string(150, 'x'))}, &schema);
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, transaction));
+  }
+  buffer_pool_manager->FlushAllPages();
+
+  for (size_t window : {static_cast<size_t>(0), static_cast<size_t>(8)}) {
+    table_scan_read_ahead = window;
+    const int reads_before = disk_manager->GetNumReads();
+    const uint64_t prefetches_before = buffer_pool_manager->GetNumPrefetches();
+    auto start = std::chrono::steady_clock::now();
+    int64_t expected = 0;
+    for (auto itr = table->Begin(transaction); itr != table->End(); ++itr) {
+      EXPECT_EQ(expected++, itr->GetValue(&schema, 0).GetAs<int64_t>());
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_tuples, expected);
+
+    const uint64_t prefetches = buffer_pool_manager->GetNumPrefetches() - prefetches_before;
+    if (window == 0) {
+      EXPECT_EQ(0, prefetches);
+    } else {
+      EXPECT_GT(prefetches, 0);
+    }
+    printf("read-ahead %zu  %8.3f ms  reads %5d  prefetched %5lu\n", window, elapsed * 1e3,
+           disk_manager->GetNumReads() - reads_before, prefetches);
+  }
+  table_scan_read_ahead = read_ahead;
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, LargePageTableHeapTest) {
+  Schema schema{std::vector<Column>{Column{"a", TypeId::BIGINT}, Column{"b", TypeId::VARCHAR, 20000}}};
+  const int num_tuples = 40;
+
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(1, {4, 0, 4}, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+
+  // a tuple larger than a 4K page only fits into a table of larger pages
+  Tuple large_tuple({ValueFactory::GetBigIntValue(0), ValueFactory::GetVarcharValue(std::string(20000, 'x'))},
+                    &schema);
+  RID rid;
+  auto *small_transaction = new Transaction(0);
+  auto *small_table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, small_transaction);
+  EXPECT_FALSE(small_table->InsertTuple(large_tuple, &rid, small_transaction));
+
+  // the table spans more 64K pages than the pool holds frames for
+  auto *transaction = new Transaction(1);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction, PageSizeClass::PAGE_64K);
+  for (int i = 0; i < num_tuples; ++i) {
+    Tuple tuple({ValueFactory::GetBigIntValue(i), ValueFactory::GetVarcharValue(std::string(20000, 'a' + i % 26))},
+                &schema);
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, transaction));
+    EXPECT_EQ(PageSizeClass::PAGE_64K, GetPageSizeClass(rid.GetPageId()));
+  }
+
+  int64_t expected = 0;
+  for (auto itr = table->Begin(transaction); itr != table->End(); ++itr) {
+    EXPECT_EQ(expected, itr->GetValue(&schema, 0).GetAs<int64_t>());
+    EXPECT_EQ(std::string(20000, 'a' + expected % 26), itr->GetValue(&schema, 1).ToString());
+    expected++;
+  }
+  EXPECT_EQ(num_tuples, expected);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete table;
+  delete small_table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+  delete small_transaction;
+}
+
 }  // namespace bustub